@@ -31,42 +31,25 @@ const msglib::Label Msg4 = 4;
 const msglib::Label Msg5 = 5;
 const msglib::Label Exit = 999;
 
-void displayMsg(const char *thread, msglib::Message &msg) {
-    switch (msg.m_label) {
-    case Msg1: {
-        try {
-            auto *m1 = msg.as<Message1>();
-            if (m1) {
-                spdlog::info("Thread {} got Msg1[ {} {} {} {} {} ]", thread, m1->a, m1->b, m1->c, m1->d, m1->e);
-            }
-        } catch (std::exception &e) {
-            spdlog::error("Thread {} exception {} getting Message1", thread, e.what());
-        }
-    } break;
-    case Msg2:
-        try {
-            auto *m2 = msg.as<Message2>();
-            if (m2) {
-                spdlog::info("Thread {} got Msg2[ {} ]", thread, m2->a);
-            }
-        } catch (std::exception &e) {
-            spdlog::error("Thread {} exception {} getting Message2", thread, e.what());
-        }
-        break;
-    case Msg3:
-        try {
-            auto *t = msg.as<Message3>();
-            if (t) {
-                spdlog::info("Thread {} got Msg3[ {} {} {} ]", thread, t->a, t->b, t->c);
-            }
-        } catch (std::exception &e) {
-            spdlog::error("Thread {} exception {} getting Message3", thread, e.what());
-        }
-        break;
-    default:
-        spdlog::info("Thread {} got Signal {}", thread, msg.m_label);
-        break;
-    }
+using MboxDispatcher =
+    msglib::Dispatcher<msglib::Handler<Msg1, Message1>, msglib::Handler<Msg2, Message2>, msglib::Handler<Msg3, Message3>>;
+
+// Display a received message, then release it
+void displayMsg(const char *thread, msglib::Mailbox &mbox, msglib::Message &msg) {
+    MboxDispatcher::Dispatch(mbox, msg,
+        msglib::Overloaded {
+            [thread](const Message1 &m1) {
+                spdlog::info("Thread {} got Msg1[ {} {} {} {} {} ]", thread, m1.a, m1.b, m1.c, m1.d, m1.e);
+            },
+            [thread](const Message2 &m2) { spdlog::info("Thread {} got Msg2[ {} ]", thread, m2.a); },
+            [thread](const Message3 &t) { spdlog::info("Thread {} got Msg3[ {} {} {} ]", thread, t.a, t.b, t.c); },
+            [thread](const msglib::Message &other) {
+                if (other.m_data == nullptr) {
+                    spdlog::info("Thread {} got Signal {}", thread, other.m_label);
+                } else {
+                    spdlog::error("Thread {} got unexpected message {} size {}", thread, other.m_label, other.m_size);
+                }
+            }});
 }
 
 void thread1(int inst) {
@@ -79,8 +62,7 @@ void thread1(int inst) {
         msglib::Message msg;
 
         mbox.Receive(msg);
-        msglib::MessageGuard guard(mbox, msg);
-        displayMsg("Thread1", msg);
+        displayMsg("Thread1", mbox, msg);
         if (msg.m_label == Exit) {
             break;
         }
@@ -100,8 +82,7 @@ void thread2(int inst) {
     while (true) {
         msglib::Message msg;
         mbox.Receive(msg);
-        msglib::MessageGuard guard(mbox, msg);
-        displayMsg("Thread2", msg);
+        displayMsg("Thread2", mbox, msg);
         if (msg.m_label == Exit) {
             break;
         }
@@ -122,8 +103,7 @@ void thread3(int inst) {
         msglib::Message msg;
 
         mbox.Receive(msg);
-        msglib::MessageGuard guard(mbox, msg);
-        displayMsg("Thread3", msg);
+        displayMsg("Thread3", mbox, msg);
         if (msg.m_label == Exit) {
             break;
         }
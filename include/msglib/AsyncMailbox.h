@@ -0,0 +1,431 @@
+#pragma once
+
+#include "Executor.h"
+
+#ifdef MSGLIB_HAS_COROUTINES
+
+#include "Mailbox.h"
+#include "detail/AsyncWaiter.h"
+#include "detail/MpmcQueue.h"
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <memory_resource>
+#include <mutex>
+#include <type_traits>
+
+namespace msglib {
+
+/**
+ * @brief AsyncMailbox is a mailbox for Task coroutines. Instead of blocking a thread,
+ *        `co_await AsyncReceive()` suspends the Task until a message arrives and
+ *        `co_await AsyncSend()` suspends it while a receiving AsyncMailbox's queue is full,
+ *        letting a few Executor threads multiplex thousands of mailboxes.
+ *
+ *        Each AsyncMailbox has a single consuming Task. Other threads can send to it with the
+ *        usual Mailbox methods.
+ */
+class AsyncMailbox : public MailboxBase {
+public:
+    /**
+     * @brief Default queue capacity
+     */
+    static constexpr size_t QUEUE_SIZE = 256;
+
+    /**
+     * @brief Awaiter returned by AsyncReceive(), yielding the received Message
+     */
+    class ReceiveAwaiter : public detail::AsyncWaiter {
+    public:
+        explicit ReceiveAwaiter(AsyncMailbox &mailbox) : m_mailbox(mailbox) {
+            m_wake = &ReceiveAwaiter::wake;
+        }
+
+        bool await_ready() {
+            m_received = m_mailbox.pop(m_msg);
+            return m_received;
+        }
+
+        template <class Promise>
+        bool await_suspend(std::coroutine_handle<Promise> handle) {
+            m_handle = handle;
+            m_executor = handle.promise().m_executor;
+            // Once suspendReceiver() has registered this waiter it may be resumed (and the
+            // coroutine destroyed) on another thread, so it mustn't be touched again
+            const bool suspended = m_mailbox.suspendReceiver(this, m_msg);
+            if (!suspended) {
+                m_received = true;
+            }
+            return suspended;
+        }
+
+        Message await_resume() {
+            if (!m_received) {
+                // Woken by deliver(); as the only consumer the message is still queued
+                m_mailbox.pop(m_msg);
+            }
+            return m_msg;
+        }
+
+    private:
+        static void wake(detail::AsyncWaiter *waiter) {
+            auto *self = static_cast<ReceiveAwaiter *>(waiter);
+            [[maybe_unused]] const bool posted = self->m_executor->Post(self->m_handle);
+            assert(posted && "Task woken while already queued");
+        }
+
+        AsyncMailbox &m_mailbox;
+        Message m_msg;
+        bool m_received = false;
+        std::coroutine_handle<> m_handle;
+        Executor *m_executor = nullptr;
+    };
+
+    /**
+     * @brief Awaiter returned by AsyncSend(), yielding true if the message was delivered to
+     *        every receiver
+     */
+    template <typename T>
+    class SendAwaiter : public detail::AsyncWaiter {
+    public:
+        SendAwaiter(Label label, const T &t) : m_label(label), m_value(t) {
+            m_wake = &SendAwaiter::wake;
+            m_cancel = &SendAwaiter::cancel;
+        }
+
+        bool await_ready() {
+            return false;
+        }
+
+        template <class Promise>
+        bool await_suspend(std::coroutine_handle<Promise> handle) {
+            m_handle = handle;
+            m_executor = handle.promise().m_executor;
+            // Once attempt() has registered this waiter it may be resumed on another thread
+            return !attempt();
+        }
+
+        bool await_resume() {
+            return m_result;
+        }
+
+    private:
+        /**
+         * @brief Pending bit for each broadcast receiver, one for the shared group and one for each
+         *        label range or mask subscription
+         */
+        static constexpr uint64_t SHARED_BIT = 1ULL << detail::MAX_RECEIVERS;
+        static constexpr size_t FIRST_SUBSCRIPTION = detail::MAX_RECEIVERS + 1;
+        static constexpr uint64_t ALL_RECEIVERS = (1ULL << (FIRST_SUBSCRIPTION + detail::MAX_SUBSCRIPTIONS)) - 1;
+
+        /**
+         * @brief Deliver to each receiver still pending
+         *
+         * @return true - finished
+         * @return false - waiting for space in a receiver's queue
+         */
+        bool attempt() {
+            auto &data = MailboxBase::s_mailboxData;
+            std::lock_guard<std::mutex> guard(data.GetMutex());
+            const auto &receivers = data.GetReceivers(m_label);
+            for (size_t i = 0; i < detail::MAX_RECEIVERS; i++) {
+                const uint64_t bit = 1ULL << i;
+                while ((m_pending & bit) != 0) {
+                    MailboxBase *receiver = receivers.m_receivers[i];
+                    if (receiver == nullptr) {
+                        m_pending &= ~bit;
+                        break;
+                    }
+                    if (!sendTo(receiver, bit)) {
+                        return false;
+                    }
+                }
+            }
+            for (size_t i = 0; i < detail::MAX_SUBSCRIPTIONS; i++) {
+                const uint64_t bit = 1ULL << (FIRST_SUBSCRIPTION + i);
+                while ((m_pending & bit) != 0) {
+                    MailboxBase *receiver = receivers.subscriber(data.GetSubscriptions(), i);
+                    if (receiver == nullptr) {
+                        m_pending &= ~bit;
+                        break;
+                    }
+                    if (!sendTo(receiver, bit)) {
+                        return false;
+                    }
+                }
+            }
+            while ((m_pending & SHARED_BIT) != 0) {
+                // Wait on the member which is next in turn if every member's queue is full
+                MailboxBase *receiver = receivers.nextShared();
+                if (receiver == nullptr) {
+                    m_pending &= ~SHARED_BIT;
+                    break;
+                }
+                if (!sendTo(receiver, SHARED_BIT, &receivers)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Try to deliver a copy of the message to a receiver (or to the shared group),
+         *        clearing its pending bit unless it has to be retried
+         *
+         * @return false - waiting for space in the receiver's queue
+         */
+        bool sendTo(MailboxBase *receiver, uint64_t bit, const detail::Receivers *shared = nullptr) {
+            auto &data = MailboxBase::s_mailboxData;
+            Message msg;
+            const ByteSpan segment(reinterpret_cast<const std::byte *>(&m_value), sizeof(T));
+            if (!data.allocateMessage(m_label, &segment, 1, sizeof(T), msg)) {
+                m_result = false;
+                m_pending &= ~bit;
+                return true;
+            }
+            const bool delivered = (shared != nullptr)
+                ? shared->deliverShared([&msg](MailboxBase *member) { return member->deliver(msg); })
+                : receiver->deliver(msg);
+            if (delivered) {
+                m_pending &= ~bit;
+                return true;
+            }
+            data.releaseMessage(msg);
+            m_waiting = bit;
+            const auto wait = receiver->waitForSpace(this);
+            if (wait == detail::SpaceWait::WAITING) {
+                return false;
+            }
+            if (wait == detail::SpaceWait::UNSUPPORTED) {
+                // No backpressure for other mailbox types, so behave like SendMessage()
+                m_result = false;
+                m_pending &= ~bit;
+            }
+            return true;
+        }
+
+        static void wake(detail::AsyncWaiter *waiter) {
+            auto *self = static_cast<SendAwaiter *>(waiter);
+            if (self->attempt()) {
+                [[maybe_unused]] const bool posted = self->m_executor->Post(self->m_handle);
+                assert(posted && "Task woken while already queued");
+            }
+        }
+
+        /**
+         * @brief Give up on the receiver being waited on, which is being destroyed, and carry on
+         *        with the rest
+         */
+        static void cancel(detail::AsyncWaiter *waiter) {
+            auto *self = static_cast<SendAwaiter *>(waiter);
+            self->m_result = false;
+            self->m_pending &= ~self->m_waiting;
+            wake(waiter);
+        }
+
+        Label m_label;
+        T m_value;
+        uint64_t m_pending = ALL_RECEIVERS;
+        uint64_t m_waiting = 0;
+        bool m_result = true;
+        std::coroutine_handle<> m_handle;
+        Executor *m_executor = nullptr;
+    };
+
+    /**
+     * @brief Construct a new AsyncMailbox object
+     */
+    AsyncMailbox() : AsyncMailbox(QUEUE_SIZE) {
+    }
+
+    /**
+     * @brief Construct a new AsyncMailbox with a specific queue capacity
+     *
+     * @param queueSize - queue capacity
+     */
+    explicit AsyncMailbox(size_t queueSize)
+        : m_storage(queueSize), m_bytes(m_storage.data(), m_storage.size()), m_queue(queueSize, &m_bytes) {
+    }
+
+    AsyncMailbox(const AsyncMailbox &) = delete;
+    AsyncMailbox(AsyncMailbox &&) = delete;
+    AsyncMailbox &operator=(const AsyncMailbox &) = delete;
+    AsyncMailbox &operator=(AsyncMailbox &&) = delete;
+
+    /**
+     * @brief Destroy the AsyncMailbox object, releasing any messages which were never received.
+     *        Tasks suspended in AsyncSend() waiting for space in this queue are resumed with a
+     *        result of false. Unregister its labels first, so that nothing is still being
+     *        delivered to it.
+     */
+    ~AsyncMailbox() override {
+        Message msg;
+        while (m_queue.tryPop(msg)) {
+            ReleaseMessage(msg);
+        }
+        detail::AsyncWaiter *waiters = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            waiters = std::exchange(m_spaceWaiters, nullptr);
+        }
+        while (waiters != nullptr) {
+            detail::AsyncWaiter *next = waiters->m_next;
+            waiters->m_cancel(waiters);
+            waiters = next;
+        }
+    }
+
+    /**
+     * @brief Receive the next message, suspending the calling Task until one arrives.
+     *        Usage: `Message msg = co_await mbox.AsyncReceive();`
+     */
+    ReceiveAwaiter AsyncReceive() {
+        return ReceiveAwaiter(*this);
+    }
+
+    /**
+     * @brief Send a message to each receiver of a label (and one member of its shared group),
+     *        suspending the calling Task while a receiving AsyncMailbox's queue is full.
+     *        Receivers of other mailbox types are sent to as with SendMessage(). Usage: `bool sent = co_await mbox.AsyncSend(label, t);`
+     *
+     * @tparam T - a trivially copyable type
+     * @param label - the message label
+     * @param t - an instance, which is copied into the awaiter
+     */
+    template <typename T>
+    SendAwaiter<T> AsyncSend(Label label, const T &t) {
+        static_assert(std::is_trivially_copyable_v<T>, "AsyncSend requires trivially copyable types");
+        return SendAwaiter<T>(label, t);
+    }
+
+    /**
+     * @brief Receive a signal/message if one is available without waiting
+     */
+    bool TryReceive(Message &msg) {
+        return pop(msg);
+    }
+
+protected:
+    bool deliver(const Message &msg) override {
+        if (!m_queue.tryPush(msg)) {
+            return false;
+        }
+        Tracer::Record(TraceEvent::ENQUEUE, msg.m_label, TraceId());
+        detail::AsyncWaiter *receiver = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            receiver = std::exchange(m_receiver, nullptr);
+        }
+        if (receiver != nullptr) {
+            receiver->m_wake(receiver);
+        }
+        return true;
+    }
+
+    detail::SpaceWait waitForSpace(detail::AsyncWaiter *waiter) override {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_hasSpaceWaiters.store(true);
+        // Pairs with the fence in pop() so that either pop() sees the waiter or this sees the space
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_queue.size() < m_queue.capacity()) {
+            m_hasSpaceWaiters.store(m_spaceWaiters != nullptr);
+            return detail::SpaceWait::AVAILABLE;
+        }
+        waiter->m_next = m_spaceWaiters;
+        m_spaceWaiters = waiter;
+        return detail::SpaceWait::WAITING;
+    }
+
+private:
+    /**
+     * @brief Pop a message, waking any senders waiting for space
+     */
+    bool pop(Message &msg) {
+        if (!m_queue.tryPop(msg)) {
+            return false;
+        }
+        popped(msg);
+        return true;
+    }
+
+    /**
+     * @brief Wake senders waiting for space after a message has been popped
+     */
+    void popped(const Message &msg) {
+        Tracer::Record(TraceEvent::RECEIVE, msg.m_label, TraceId());
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_hasSpaceWaiters.load(std::memory_order_relaxed)) {
+            return;
+        }
+        detail::AsyncWaiter *waiters = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            waiters = std::exchange(m_spaceWaiters, nullptr);
+            m_hasSpaceWaiters.store(false);
+        }
+        while (waiters != nullptr) {
+            detail::AsyncWaiter *next = waiters->m_next;
+            waiters->m_wake(waiters);
+            waiters = next;
+        }
+    }
+
+    /**
+     * @brief Register the consuming Task's waiter unless a message is already available
+     *
+     * @return true - waiter registered
+     * @return false - msg was popped instead
+     */
+    bool suspendReceiver(detail::AsyncWaiter *waiter, Message &msg) {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (!m_queue.tryPop(msg)) {
+                m_receiver = waiter;
+                return true;
+            }
+        }
+        popped(msg);
+        return false;
+    }
+
+    using QueueType = detail::MpmcQueue<Message>;
+
+    /**
+     * @brief Underlying data for the queue's monotonic buffer resource
+     */
+    HeapStorage::Buffer<sizeof(QueueType::Slot)> m_storage;
+
+    /**
+     * @brief Monotonic buffer resource supporting this instance's queue
+     */
+    std::pmr::monotonic_buffer_resource m_bytes;
+
+    /**
+     * @brief Queue for this instance
+     */
+    QueueType m_queue;
+
+    /**
+     * @brief Mutex protecting the waiters
+     */
+    std::mutex m_mutex;
+
+    /**
+     * @brief The consuming Task, when suspended in AsyncReceive()
+     */
+    detail::AsyncWaiter *m_receiver = nullptr;
+
+    /**
+     * @brief Tasks suspended in AsyncSend() until this queue has space
+     */
+    detail::AsyncWaiter *m_spaceWaiters = nullptr;
+
+    /**
+     * @brief True when m_spaceWaiters may be non-empty, so that pop() can skip the mutex
+     */
+    std::atomic<bool> m_hasSpaceWaiters {false};
+};
+
+}  // namespace msglib
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+#include "Dispatcher.h"
+#include "Mailbox.h"
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace msglib {
+
+/**
+ * @brief Channel is a typed endpoint binding label L to payload type T, so that one declaration
+ *        (e.g. `using Orders = Channel<ORDER, Order>;`) is shared by senders and receivers. The
+ *        pool for T is chosen once, when the Channel is constructed, so that Send() doesn't
+ *        repeat the size checks of Mailbox::SendMessage() and Data() hands out the payload
+ *        without the checks of Message::as(). Sending any type other than T doesn't compile.
+ *
+ *        Messages sent with label L by other means (e.g. SendMessage() with another type) are
+ *        rejected by Data() and released by Release() as by MailboxBase::ReleaseMessage(), but
+ *        label L should normally only be sent through the Channel.
+ *
+ * @tparam L - message label
+ * @tparam T - payload type (trivially copyable)
+ */
+template <Label L, class T>
+class Channel {
+    static_assert(std::is_trivially_copyable_v<T>, "Channel requires trivially copyable types");
+    static_assert(sizeof(T) <= UINT32_MAX, "Channel payload type is too large");
+
+public:
+    static constexpr Label LABEL = L;
+    using Type = T;
+
+    /**
+     * @brief Handler for dispatching this channel's messages with a Dispatcher
+     */
+    using Handler = msglib::Handler<L, T>;
+
+    /**
+     * @brief Bind a Channel to the mailbox it sends from and receives into, initializing mailbox
+     *        internals with the default options if necessary
+     *
+     * @param mailbox - mailbox to send from and receive into
+     * @throw std::length_error - T doesn't fit in a "large" pool block
+     */
+    explicit Channel(MailboxBase &mailbox) : m_mailbox(mailbox) {
+        if (!MailboxBase::s_mailboxData.poolFor(sizeof(T), m_pool)) {
+            throw std::length_error("Channel payload type exceeds the large pool size");
+        }
+    }
+
+    /**
+     * @brief Register the mailbox to receive this channel's messages
+     *
+     * @param mode - Mode::Broadcast or Mode::Shared, as for MailboxBase::RegisterForLabel()
+     */
+    bool Register(Mode mode = Mode::Broadcast) {
+        return m_mailbox.RegisterForLabel(L, mode);
+    }
+
+    bool Unregister() {
+        return m_mailbox.UnregisterForLabel(L);
+    }
+
+    /**
+     * @brief Send a T to each receiver of label L
+     *
+     * @return true - message was sent to all receivers
+     * @return false - pool capacity reached, or a receiver's queue was full
+     */
+    bool Send(const T &t) {
+        return m_mailbox.sendBlock(L, &t, static_cast<uint32_t>(sizeof(T)), m_pool);
+    }
+
+    /**
+     * @brief Only T can be sent on this channel
+     */
+    template <class U>
+    bool Send(const U &) = delete;
+
+    /**
+     * @brief Return true if a received message belongs to this channel
+     */
+    static bool Is(const Message &msg) {
+        return msg.m_label == L;
+    }
+
+    /**
+     * @brief Return a received message's payload
+     *
+     * @throw std::invalid_argument - the message doesn't hold a T sent on this channel
+     */
+    static const T &Data(const Message &msg) {
+        if (!holds(msg)) {
+            throw std::invalid_argument("Message doesn't belong to this Channel");
+        }
+        return *reinterpret_cast<const T *>(msg.m_data);
+    }
+
+    /**
+     * @brief Return a received message's payload for modification. The message mustn't share its
+     *        data (see Message::SHARED), e.g. with a timer's other expiries; use the const
+     *        overload for those.
+     *
+     * @throw std::invalid_argument - the message doesn't hold a T sent on this channel, or is shared
+     */
+    static T &Data(Message &msg) {
+        if (!holds(msg) || msg.shared()) {
+            throw std::invalid_argument("Message doesn't belong to this Channel");
+        }
+        return *reinterpret_cast<T *>(msg.m_data);
+    }
+
+    /**
+     * @brief Release a received message. One sent on this channel goes straight back to the
+     *        pool chosen for T; anything else (e.g. sent on label L by other means, or a timer's
+     *        shared payload) is released as by MailboxBase::ReleaseMessage().
+     */
+    void Release(Message &msg) {
+        if (msg.m_flags == 0 && holds(msg)) {
+            Tracer::Record(TraceEvent::RELEASE, L, m_mailbox.TraceId());
+            MailboxBase::s_mailboxData.freeBlock(msg.m_data, m_pool);
+        } else {
+            m_mailbox.ReleaseMessage(msg);
+        }
+        msg.m_data = nullptr;
+    }
+
+private:
+    /**
+     * @brief Return true if a message holds a T, as sent on this channel: with label L, a block
+     *        of sizeof(T) bytes (which is therefore from the pool chosen for T) and no object or
+     *        chained data
+     */
+    static bool holds(const Message &msg) {
+        return Is(msg) && msg.m_data != nullptr && msg.m_size == sizeof(T) && !msg.chained() && !msg.object();
+    }
+
+    MailboxBase &m_mailbox;
+    detail::PoolClass m_pool = detail::PoolClass::SMALL;
+};
+
+}  // namespace msglib
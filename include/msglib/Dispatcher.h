@@ -0,0 +1,269 @@
+#pragma once
+#include "Message.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace msglib {
+
+/**
+ * @brief Type identifying a label at compile time, passed to handlers which need to know it
+ */
+template <Label L>
+using LabelConstant = std::integral_constant<Label, L>;
+
+/**
+ * @brief Handler declares that messages with label L carry a T, for use with Dispatcher
+ *
+ * @tparam L - message label
+ * @tparam T - message type (trivially copyable), or void for a signal
+ */
+template <Label L, class T = void>
+struct Handler {
+    static_assert(std::is_trivially_copyable_v<T>, "Handler requires trivially copyable types");
+    static_assert(sizeof(T) <= UINT32_MAX, "Handler message type is too large");
+
+    static constexpr Label LABEL = L;
+    using Type = T;
+};
+
+/**
+ * @brief Handler for a signal (a message without data)
+ */
+template <Label L>
+struct Handler<L, void> {
+    static constexpr Label LABEL = L;
+    using Type = void;
+};
+
+/**
+ * @brief Overloaded combines several lambdas into one visitor for Dispatcher::Dispatch()
+ */
+template <class... Fns>
+struct Overloaded : Fns... {
+    using Fns::operator()...;
+};
+
+template <class... Fns>
+Overloaded(Fns...) -> Overloaded<Fns...>;
+
+/**
+ * @brief Dispatcher calls a typed handler for each received message, using a table of handler
+ *        entries generated at compile time from its list of Handlers. This replaces a
+ *        hand-written switch on the label with a cast and size check per case.
+ *
+ *        The visitor passed to Dispatch() is called for Handler<L, T> as either
+ *        `visitor(LabelConstant<L>, const T&)` or `visitor(const T&)`, and for a signal
+ *        Handler<L> as `visitor(LabelConstant<L>)`. Messages with other labels, or whose size
+ *        doesn't match their Handler's type, are passed to `visitor(const Message&)` if the
+ *        visitor accepts that, and are otherwise ignored.
+ *
+ * @tparam Handlers - Handler<Label, T> for each label to be dispatched
+ */
+template <class... Handlers>
+class Dispatcher {
+    static_assert(sizeof...(Handlers) > 0, "Dispatcher requires at least one Handler");
+
+    static constexpr size_t COUNT = sizeof...(Handlers);
+
+    static constexpr std::array<Label, COUNT> LABELS = {Handlers::LABEL...};
+
+    static constexpr Label minLabel() {
+        Label result = LABELS[0];
+        for (auto label : LABELS) {
+            result = (label < result) ? label : result;
+        }
+        return result;
+    }
+
+    static constexpr Label maxLabel() {
+        Label result = LABELS[0];
+        for (auto label : LABELS) {
+            result = (label > result) ? label : result;
+        }
+        return result;
+    }
+
+    static constexpr bool unique() {
+        for (size_t i = 0; i < COUNT; i++) {
+            for (size_t j = i + 1; j < COUNT; j++) {
+                if (LABELS[i] == LABELS[j]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(unique(), "Dispatcher Handlers must have distinct labels");
+
+public:
+    /**
+     * @brief Lowest label handled
+     */
+    static constexpr Label MIN_LABEL = minLabel();
+
+    /**
+     * @brief Number of entries in a table indexed directly by label - MIN_LABEL
+     */
+    static constexpr size_t RANGE = static_cast<size_t>(maxLabel() - MIN_LABEL) + 1;
+
+    /**
+     * @brief Labels spanning up to this many table entries per Handler (plus a little slack) are
+     *        dispatched by direct table lookup; sparser labels by binary search of a sorted table
+     */
+    static constexpr size_t DENSE_FACTOR = 4;
+
+    static constexpr bool DENSE = RANGE <= (COUNT * DENSE_FACTOR) + 64;
+
+    /**
+     * @brief Call the handler for a message, then release the message's data. Afterwards msg
+     *        retains its label but no data, so an enclosing MessageGuard won't release it again.
+     *
+     * @param mailbox - mailbox the message was received from
+     * @param msg - the message
+     * @param visitor - handlers (e.g. an Overloaded of lambdas)
+     * @return true - a Handler was called for the message
+     * @return false - the message was passed to the fallback handler or ignored
+     */
+    template <class MailboxType, class Visitor>
+    static bool Dispatch(MailboxType &mailbox, Message &msg, Visitor &&visitor) {
+        struct Release {
+            MailboxType &m_mailbox;
+            Message &m_msg;
+            ~Release() {
+                if (m_msg.m_data != nullptr) {
+                    m_mailbox.ReleaseMessage(m_msg);
+                    m_msg = Message(m_msg.m_label);
+                }
+            }
+        } release {mailbox, msg};
+
+        using Entry = bool (*)(const Message &, std::remove_reference_t<Visitor> &);
+        Entry entry = nullptr;
+        if constexpr (DENSE) {
+            static constexpr auto TABLE = denseTable<std::remove_reference_t<Visitor>>();
+            const size_t index = static_cast<size_t>(msg.m_label) - MIN_LABEL;
+            if (msg.m_label >= MIN_LABEL && index < RANGE) {
+                entry = TABLE[index];
+            }
+        } else {
+            static constexpr auto TABLE = sortedTable<std::remove_reference_t<Visitor>>();
+            size_t lo = 0;
+            size_t hi = COUNT;
+            while (lo < hi) {
+                const size_t mid = (lo + hi) / 2;
+                if (TABLE[mid].m_label < msg.m_label) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo < COUNT && TABLE[lo].m_label == msg.m_label) {
+                entry = TABLE[lo].m_entry;
+            }
+        }
+        if (entry != nullptr && entry(msg, visitor)) {
+            return true;
+        }
+        if constexpr (std::is_invocable_v<Visitor, const Message &>) {
+            visitor(static_cast<const Message &>(msg));
+        }
+        return false;
+    }
+
+    /**
+     * @brief Wait for the next message on a mailbox and dispatch it
+     *
+     * @param mailbox - mailbox to receive from
+     * @param visitor - handlers (e.g. an Overloaded of lambdas)
+     * @return Label - label of the message which was received
+     */
+    template <class MailboxType, class Visitor>
+    static Label Receive(MailboxType &mailbox, Visitor &&visitor) {
+        Message msg;
+        mailbox.Receive(msg);
+        Dispatch(mailbox, msg, std::forward<Visitor>(visitor));
+        return msg.m_label;
+    }
+
+private:
+    /**
+     * @brief Call the visitor for one Handler
+     *
+     * @return false - message size doesn't match the Handler's type
+     */
+    template <class H, class Visitor>
+    static bool invoke(const Message &msg, Visitor &visitor) {
+        using T = typename H::Type;
+        using Tag = LabelConstant<H::LABEL>;
+        if constexpr (std::is_void_v<T>) {
+            static_assert(std::is_invocable_v<Visitor &, Tag>, "Visitor must accept LabelConstant<L> for signal Handler<L>");
+            visitor(Tag {});
+            return true;
+        } else {
+            static_assert(std::is_invocable_v<Visitor &, Tag, const T &> || std::is_invocable_v<Visitor &, const T &>,
+                "Visitor must accept (LabelConstant<L>, const T&) or (const T&) for Handler<L, T>");
+            if (msg.m_size != sizeof(T) || msg.m_data == nullptr) {
+                return false;
+            }
+            if (msg.chained()) {
+                // Larger than a single pool block, so gather it into contiguous storage
+                alignas(T) std::byte bytes[sizeof(T)];
+                msg.copyTo(bytes, sizeof(T));
+                call<Tag>(visitor, *reinterpret_cast<const T *>(bytes));
+            } else {
+                call<Tag>(visitor, *reinterpret_cast<const T *>(msg.m_data));
+            }
+            return true;
+        }
+    }
+
+    template <class Tag, class Visitor, class T>
+    static void call(Visitor &visitor, const T &t) {
+        if constexpr (std::is_invocable_v<Visitor &, Tag, const T &>) {
+            visitor(Tag {}, t);
+        } else {
+            visitor(t);
+        }
+    }
+
+    template <class Visitor>
+    static constexpr auto denseTable() {
+        using Entry = bool (*)(const Message &, Visitor &);
+        std::array<Entry, RANGE> table {};
+        ((table[Handlers::LABEL - MIN_LABEL] = &invoke<Handlers, Visitor>), ...);
+        return table;
+    }
+
+    /**
+     * @brief Entry in the table of sparse labels
+     */
+    template <class Visitor>
+    struct SortedEntry {
+        Label m_label;
+        bool (*m_entry)(const Message &, Visitor &);
+    };
+
+    template <class Visitor>
+    static constexpr auto sortedTable() {
+        std::array<SortedEntry<Visitor>, COUNT> table {
+            SortedEntry<Visitor> {Handlers::LABEL, &invoke<Handlers, Visitor>}...};
+        // Insertion sort by label
+        for (size_t i = 1; i < COUNT; i++) {
+            for (size_t j = i; j > 0 && table[j].m_label < table[j - 1].m_label; j--) {
+                const SortedEntry<Visitor> tmp = table[j];
+                table[j].m_label = table[j - 1].m_label;
+                table[j].m_entry = table[j - 1].m_entry;
+                table[j - 1].m_label = tmp.m_label;
+                table[j - 1].m_entry = tmp.m_entry;
+            }
+        }
+        return table;
+    }
+};
+
+}  // namespace msglib
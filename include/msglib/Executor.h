@@ -0,0 +1,313 @@
+#pragma once
+
+/**
+ * Opt-in C++20 coroutine support: Task coroutines run on an Executor, which resumes them when
+ * the messages they are waiting for arrive (see AsyncMailbox). Nothing is defined when the
+ * compiler doesn't support coroutines; check MSGLIB_HAS_COROUTINES.
+ */
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define MSGLIB_HAS_COROUTINES 1
+
+#include "MailboxPolicies.h"
+#include "detail/MpmcQueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace msglib {
+
+class Executor;
+
+/**
+ * @brief Task is the return type of a coroutine which runs on an Executor, typically a
+ *        long-lived actor receiving from an AsyncMailbox. Tasks start suspended and are
+ *        started by Executor::Spawn(); the coroutine frame is destroyed when it completes.
+ */
+class Task {
+public:
+    struct promise_type;
+
+    /**
+     * @brief Destroys the coroutine frame on completion and tells its Executor
+     */
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+
+        void await_resume() noexcept {
+        }
+    };
+
+    struct promise_type {
+        /**
+         * @brief Executor the task was spawned on, which resumes it after each suspension
+         */
+        Executor *m_executor = nullptr;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {
+        }
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    Task &operator=(Task &&) = delete;
+
+    /**
+     * @brief Destroys the coroutine if it was never spawned
+     */
+    ~Task() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+private:
+    friend class Executor;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/**
+ * @brief Executor holds the run queue of Tasks which are ready to be resumed. The run queue is
+ *        bounded by the maximum number of live Tasks, so posting a Task never allocates.
+ *        Derived classes (SingleThreadExecutor, ThreadPoolExecutor) supply the thread(s).
+ */
+class Executor {
+public:
+    /**
+     * @brief Default maximum number of live Tasks
+     */
+    static constexpr size_t CAPACITY = 1024;
+
+    /**
+     * @brief Construct a new Executor object
+     *
+     * @param capacity - maximum number of live (spawned but not yet completed) Tasks
+     */
+    explicit Executor(size_t capacity) : m_capacity(capacity), m_ready(capacity, std::pmr::new_delete_resource()) {
+    }
+
+    Executor(const Executor &) = delete;
+    Executor(Executor &&) = delete;
+    Executor &operator=(const Executor &) = delete;
+    Executor &operator=(Executor &&) = delete;
+
+    /**
+     * @brief Destroy the Executor object. Tasks should have completed first.
+     */
+    virtual ~Executor() = default;
+
+    /**
+     * @brief Start running a Task on this Executor
+     *
+     * @param task - task to run; the Executor takes ownership
+     * @return true - task was scheduled
+     * @return false - capacity reached or the task has already been spawned
+     */
+    bool Spawn(Task task) {
+        if (!task.m_handle) {
+            return false;
+        }
+        if (m_live.fetch_add(1) >= m_capacity) {
+            m_live--;
+            return false;
+        }
+        auto handle = std::exchange(task.m_handle, nullptr);
+        handle.promise().m_executor = this;
+        if (!Post(handle)) {
+            handle.destroy();
+            taskDone();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Schedule a suspended Task to be resumed. Thread-safe.
+     *
+     * @param handle - the Task's coroutine
+     * @return true - the Task was queued
+     * @return false - the run queue is full. It holds every live Task, so this means a Task
+     *                 has been posted again before being resumed, which must not happen.
+     */
+    [[nodiscard]] bool Post(std::coroutine_handle<> handle) {
+        if (!m_ready.tryPush(handle)) {
+            return false;
+        }
+        m_wait.notify();
+        return true;
+    }
+
+    /**
+     * @brief Return the number of live Tasks
+     */
+    [[nodiscard]] size_t Live() const {
+        return m_live.load();
+    }
+
+    /**
+     * @brief Block until every spawned Task has completed
+     */
+    void WaitIdle() {
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        m_idle.wait(lock, [this]() { return m_live.load() == 0; });
+    }
+
+    /**
+     * @brief Stop resuming Tasks and release any threads blocked in the run loop
+     */
+    void Stop() {
+        m_stop = true;
+        m_wait.notifyAll();
+    }
+
+protected:
+    /**
+     * @brief Wait for a ready Task and resume it until it next suspends
+     *
+     * @param untilStopped - keep waiting while there are no live Tasks
+     * @return false - stopped, or no live Tasks remain and untilStopped is false
+     */
+    bool runOne(bool untilStopped) {
+        std::coroutine_handle<> handle;
+        m_wait.wait([this, &handle, untilStopped]() {
+            return m_ready.tryPop(handle) || m_stop.load() || (!untilStopped && m_live.load() == 0);
+        });
+        if (!handle) {
+            return false;
+        }
+        handle.resume();
+        return true;
+    }
+
+private:
+    friend struct Task::FinalAwaiter;
+
+    /**
+     * @brief Called as a Task completes
+     */
+    void taskDone() {
+        if (m_live.fetch_sub(1) == 1) {
+            m_wait.notifyAll();
+            std::lock_guard<std::mutex> guard(m_idleMutex);
+            m_idle.notify_all();
+        }
+    }
+
+    size_t m_capacity;
+    std::atomic<size_t> m_live {0};
+    std::atomic<bool> m_stop {false};
+
+    /**
+     * @brief Tasks ready to be resumed
+     */
+    detail::MpmcQueue<std::coroutine_handle<>> m_ready;
+
+    /**
+     * @brief Waiting strategy for threads running Tasks
+     */
+    BlockingWait m_wait;
+
+    std::mutex m_idleMutex;
+    std::condition_variable m_idle;
+};
+
+inline void Task::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+    Executor *executor = handle.promise().m_executor;
+    handle.destroy();
+    executor->taskDone();
+}
+
+/**
+ * @brief SingleThreadExecutor runs Tasks on the thread which calls Run()
+ */
+class SingleThreadExecutor : public Executor {
+public:
+    explicit SingleThreadExecutor(size_t capacity = CAPACITY) : Executor(capacity) {
+    }
+
+    /**
+     * @brief Run Tasks until every spawned Task has completed (or Stop() is called)
+     */
+    void Run() {
+        while (runOne(false)) {
+        }
+    }
+};
+
+/**
+ * @brief ThreadPoolExecutor runs Tasks on a fixed pool of threads. A Task may be resumed on a
+ *        different thread after each suspension.
+ */
+class ThreadPoolExecutor : public Executor {
+public:
+    /**
+     * @brief Construct a new ThreadPoolExecutor object and start its threads
+     *
+     * @param threads - number of threads
+     * @param capacity - maximum number of live Tasks
+     */
+    explicit ThreadPoolExecutor(size_t threads, size_t capacity = CAPACITY) : Executor(capacity) {
+        m_threads.reserve(threads);
+        for (size_t i = 0; i < threads; i++) {
+            m_threads.emplace_back([this]() {
+                while (runOne(true)) {
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief Stop and join the pool's threads
+     */
+    ~ThreadPoolExecutor() override {
+        Stop();
+        for (auto &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPoolExecutor(const ThreadPoolExecutor &) = delete;
+    ThreadPoolExecutor(ThreadPoolExecutor &&) = delete;
+    ThreadPoolExecutor &operator=(const ThreadPoolExecutor &) = delete;
+    ThreadPoolExecutor &operator=(ThreadPoolExecutor &&) = delete;
+
+private:
+    std::vector<std::thread> m_threads;
+};
+
+}  // namespace msglib
+
+#endif
@@ -0,0 +1,340 @@
+#pragma once
+#include "Mailbox.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace msglib {
+
+/**
+ * @brief Header at the start of a journal file
+ */
+struct JournalHeader {
+    static constexpr char MAGIC[8] = {'M', 'S', 'G', 'J', 'R', 'N', 'L', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_reserved;
+
+    /**
+     * @brief Bytes of records which follow the header. Updated after each record is complete, so
+     *        a journal left by a crashed process is still readable.
+     */
+    std::atomic<uint64_t> m_end;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "JournalHeader requires a lock-free 64-bit atomic");
+
+/**
+ * @brief Header of each record in a journal, followed by m_size bytes of message data padded to
+ *        a multiple of 8 bytes
+ */
+struct JournalRecord {
+    /**
+     * @brief Steady clock time in nanoseconds at which the message was sent
+     */
+    uint64_t m_timestamp;
+
+    Label m_label;
+    uint16_t m_reserved;
+    uint32_t m_size;
+};
+
+namespace detail {
+
+/**
+ * @brief Size of a journal record and its padded data
+ */
+inline size_t JournalRecordSize(size_t size) {
+    return sizeof(JournalRecord) + ((size + 7) & ~static_cast<size_t>(7));
+}
+
+}  // namespace detail
+
+/**
+ * @brief Journal captures every signal and message sent with the labels it registers for to an
+ *        append-only, memory-mapped file, for replay by JournalReader/ReplayJournal(). It is
+ *        registered like any other mailbox, and each message's data is copied straight from its
+ *        pool block into the file. Requests sent by Call() are never delivered to a Journal, and
+ *        messages carrying objects which aren't trivially copyable are not recorded.
+ *
+ *        The file is sized and mapped at construction. Once it is full further messages are
+ *        counted by Dropped() rather than failing the send.
+ */
+class Journal : public MailboxBase {
+public:
+    /**
+     * @brief Default capacity of a journal file
+     */
+    static constexpr size_t CAPACITY = 64 * 1024 * 1024;
+
+    /**
+     * @brief Create (or truncate) and map a journal file
+     *
+     * @param path - journal file
+     * @param capacity - bytes available for records
+     * @throw std::runtime_error - the file couldn't be created or mapped
+     */
+    explicit Journal(const std::string &path, size_t capacity = CAPACITY) : m_capacity(capacity) {
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);  // NOLINT
+        if (m_fd < 0) {
+            throw std::runtime_error("Unable to create journal " + path);
+        }
+        m_size = sizeof(JournalHeader) + capacity;
+        if (::ftruncate(m_fd, static_cast<off_t>(m_size)) != 0) {
+            ::close(m_fd);
+            throw std::runtime_error("Unable to size journal " + path);
+        }
+        // Populate the mapping up front so that appends don't take page faults
+        void *data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, 0);
+        if (data == MAP_FAILED) {  // NOLINT
+            ::close(m_fd);
+            throw std::runtime_error("Unable to map journal " + path);
+        }
+        m_data = static_cast<std::byte *>(data);
+        m_header = new (m_data) JournalHeader {};
+        std::memcpy(m_header->m_magic, JournalHeader::MAGIC, sizeof(JournalHeader::MAGIC));
+        m_header->m_version = JournalHeader::VERSION;
+        m_header->m_end.store(0, std::memory_order_release);
+    }
+
+    Journal(const Journal &) = delete;
+    Journal(Journal &&) = delete;
+    Journal &operator=(const Journal &) = delete;
+    Journal &operator=(Journal &&) = delete;
+
+    /**
+     * @brief Unmap the journal, truncating the file to the records written. Unregister the
+     *        journal's labels first.
+     */
+    ~Journal() override {
+        const uint64_t end = m_header->m_end.load(std::memory_order_acquire);
+        ::munmap(m_data, m_size);
+        if (::ftruncate(m_fd, static_cast<off_t>(sizeof(JournalHeader) + end)) != 0) {
+            // The file keeps its full size; readers only use the records up to m_end
+        }
+        ::close(m_fd);
+    }
+
+    /**
+     * @brief Return the number of bytes of records written
+     */
+    [[nodiscard]] size_t Size() const {
+        return static_cast<size_t>(m_header->m_end.load(std::memory_order_acquire));
+    }
+
+    /**
+     * @brief Return the number of messages not recorded because the journal was full
+     */
+    [[nodiscard]] size_t Dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Flush the records written so far to the file
+     *
+     * @return false - msync() failed
+     */
+    bool Sync() {
+        return ::msync(m_data, sizeof(JournalHeader) + Size(), MS_SYNC) == 0;
+    }
+
+protected:
+    /**
+     * @brief Append a record for the message and release its data. Called with the shared mailbox
+     *        lock held, which serializes appends.
+     */
+    bool deliver(const Message &msg) override {
+        const uint64_t end = m_header->m_end.load(std::memory_order_relaxed);
+        const size_t recordSize = detail::JournalRecordSize(msg.m_size);
+        if (msg.object()) {
+            // Objects constructed in place can't be recorded byte for byte
+        } else if (end + recordSize <= m_capacity) {
+            std::byte *record = m_data + sizeof(JournalHeader) + end;
+            const JournalRecord header {steadyNs(), msg.m_label, 0, msg.m_size};
+            std::memcpy(record, &header, sizeof(header));
+            msg.copyTo(record + sizeof(header), msg.m_size);
+            m_header->m_end.store(end + recordSize, std::memory_order_release);
+        } else {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (msg.m_data != nullptr) {
+            Message copy = msg;
+            ReleaseMessage(copy);
+        }
+        return true;
+    }
+
+    bool observer() const override {
+        return true;
+    }
+
+private:
+    static uint64_t steadyNs() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    size_t m_capacity;
+    size_t m_size = 0;
+    int m_fd = -1;
+    std::byte *m_data = nullptr;
+    JournalHeader *m_header = nullptr;
+    std::atomic<size_t> m_dropped {0};
+};
+
+/**
+ * @brief JournalReader maps a journal file read-only and iterates over its records
+ */
+class JournalReader {
+public:
+    /**
+     * @brief A journal record
+     */
+    struct Entry {
+        uint64_t m_timestamp;
+        Label m_label;
+        ByteSpan m_data;
+    };
+
+    /**
+     * @brief Map a journal file
+     *
+     * @param path - journal file
+     * @throw std::runtime_error - the file couldn't be opened or isn't a journal
+     */
+    explicit JournalReader(const std::string &path) {
+        m_fd = ::open(path.c_str(), O_RDONLY);  // NOLINT
+        if (m_fd < 0) {
+            throw std::runtime_error("Unable to open journal " + path);
+        }
+        struct stat status {};
+        if (::fstat(m_fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(JournalHeader)) {
+            ::close(m_fd);
+            throw std::runtime_error("Invalid journal " + path);
+        }
+        m_size = static_cast<size_t>(status.st_size);
+        void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (data == MAP_FAILED) {  // NOLINT
+            ::close(m_fd);
+            throw std::runtime_error("Unable to map journal " + path);
+        }
+        m_data = static_cast<const std::byte *>(data);
+        const auto *header = reinterpret_cast<const JournalHeader *>(m_data);
+        if (std::memcmp(header->m_magic, JournalHeader::MAGIC, sizeof(JournalHeader::MAGIC)) != 0 ||
+            header->m_version != JournalHeader::VERSION) {
+            ::munmap(const_cast<std::byte *>(m_data), m_size);
+            ::close(m_fd);
+            throw std::runtime_error("Invalid journal " + path);
+        }
+        const uint64_t end = header->m_end.load(std::memory_order_acquire);
+        m_end = std::min<size_t>(static_cast<size_t>(end), m_size - sizeof(JournalHeader));
+    }
+
+    JournalReader(const JournalReader &) = delete;
+    JournalReader(JournalReader &&) = delete;
+    JournalReader &operator=(const JournalReader &) = delete;
+    JournalReader &operator=(JournalReader &&) = delete;
+
+    ~JournalReader() {
+        ::munmap(const_cast<std::byte *>(m_data), m_size);
+        ::close(m_fd);
+    }
+
+    /**
+     * @brief Read the next record. Its data points into the mapped file.
+     *
+     * @return false - no more records
+     */
+    bool Next(Entry &entry) {
+        if (m_offset + sizeof(JournalRecord) > m_end) {
+            return false;
+        }
+        JournalRecord record {};
+        std::memcpy(&record, m_data + sizeof(JournalHeader) + m_offset, sizeof(record));
+        const size_t recordSize = detail::JournalRecordSize(record.m_size);
+        if (m_offset + recordSize > m_end) {
+            return false;
+        }
+        entry.m_timestamp = record.m_timestamp;
+        entry.m_label = record.m_label;
+        entry.m_data = ByteSpan(m_data + sizeof(JournalHeader) + m_offset + sizeof(JournalRecord), record.m_size);
+        m_offset += recordSize;
+        return true;
+    }
+
+    /**
+     * @brief Start again from the first record
+     */
+    void Rewind() {
+        m_offset = 0;
+    }
+
+private:
+    int m_fd = -1;
+    const std::byte *m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_end = 0;
+    size_t m_offset = 0;
+};
+
+/**
+ * @brief Pacing of ReplayJournal()
+ */
+enum class ReplayPacing {
+    /**
+     * @brief Keep the original intervals between messages
+     */
+    ORIGINAL,
+
+    /**
+     * @brief Send each message as soon as the receivers' queues have space
+     */
+    FAST
+};
+
+/**
+ * @brief Re-send the messages captured in a journal, as signals or messages with their original
+ *        labels and data, to whichever mailboxes are now registered for them. A send which fails
+ *        (e.g. a receiver's queue is full) is retried until it succeeds, so replay never drops
+ *        messages but is paced by the slowest receiver. As a failed send may have reached some
+ *        receivers of a label before the retry, replay into one receiver per label (e.g. a consumer
+ *        under test) to avoid duplicates.
+ *
+ * @param reader - journal to replay from its current position
+ * @param sender - mailbox to send from
+ * @param pacing - original pacing or as fast as possible
+ * @return size_t - number of messages sent
+ */
+inline size_t ReplayJournal(JournalReader &reader, MailboxBase &sender, ReplayPacing pacing = ReplayPacing::FAST) {
+    JournalReader::Entry entry {};
+    size_t count = 0;
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t first = 0;
+    while (reader.Next(entry)) {
+        if (pacing == ReplayPacing::ORIGINAL) {
+            if (count == 0) {
+                first = entry.m_timestamp;
+            }
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(entry.m_timestamp - first));
+        }
+        while (!(entry.m_data.empty() ? sender.SendSignal(entry.m_label) : sender.SendBytes(entry.m_label, entry.m_data))) {
+            std::this_thread::yield();
+        }
+        count++;
+    }
+    return count;
+}
+
+}  // namespace msglib
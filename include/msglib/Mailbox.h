@@ -1,66 +1,77 @@
 #pragma once
+#include "MailboxPolicies.h"
+#include "Options.h"
 #include "Message.h"
+#include "Tracer.h"
+#include "detail/AsyncWaiter.h"
 #include "detail/BytePool.h"
+#include "detail/DeferredMessages.h"
 #include "detail/MailboxData.h"
 #include "detail/Queue.h"
 #include "detail/Receiver.h"
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <cstring>
 #include <deque>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 namespace msglib {
 
 using Label = uint16_t;
 
+template <size_t Capacity>
+class SpscMailbox;
+
+class AsyncMailbox;
+
+template <Label L, class T>
+class Channel;
+
+class Waitable;
+
+namespace detail {
+class Timer;
+class TimerManagerData;
+}
+
 /**
- * @brief Mailbox provides interfaces for sending and receiving messages to one or more subscribers
+ * @brief MailboxBase provides interfaces for sending messages to one or more subscribers and
+ *        for registering to receive them. It is the label-routing endpoint shared by every
+ *        BasicMailbox instantiation, independent of how the receiving queue is implemented.
  */
-class Mailbox {
+class MailboxBase {
 public:
-    const size_t QUEUE_SIZE = 256;
-
-    /**
-     * @brief Construct a new Mailbox object
-     */
-    Mailbox()
-        : m_storage(std::make_unique<std::byte[]>(QUEUE_SIZE * sizeof(Message)))
-        , m_bytes(&m_storage[0], QUEUE_SIZE * sizeof(Message))
-        , m_resource(&m_bytes)
-        , m_queue(QUEUE_SIZE, &m_resource) {
-    }
-
     /**
-     * @brief Construct a new Mailbox
-     *
+     * @brief Construct a new MailboxBase object
      */
-    explicit Mailbox(size_t queueSize)
-        : m_storage(std::make_unique<std::byte[]>(queueSize * sizeof(Message)))
-        , m_bytes(&m_storage[0], queueSize * sizeof(Message))
-        , m_resource(&m_bytes)
-        , m_queue(queueSize, &m_resource) {
-    }
+    MailboxBase() = default;
 
     /**
      * @brief Disable copy construction
      */
-    Mailbox(const Mailbox &) = delete;
+    MailboxBase(const MailboxBase &) = delete;
 
     /**
      * @brief Disable move construction
      */
-    Mailbox(Mailbox &&) = delete;
+    MailboxBase(MailboxBase &&) = delete;
 
     /**
-     * @brief Destroy the Mailbox object
+     * @brief Destroy the MailboxBase object
      */
-    ~Mailbox() = default;
+    virtual ~MailboxBase() = default;
 
     static bool Initialize() {
         return s_mailboxData.Initialize();
@@ -80,13 +91,27 @@ public:
         return s_mailboxData.Initialize(smallSize, smallCap, largeSize, largeCap);
     }
 
+    /**
+     * @brief Initialize mailbox internals with the specified options
+     *
+     * @param options - pool sizes, capacities and placement
+     * @return true - success
+     * @return false - failure or already initialized
+     */
+    static bool Initialize(const Options &options) {
+        return s_mailboxData.Initialize(options);
+    }
+
     /**
      * @brief Register to receive messages with this label
      *
      * @param label - message label to register
+     * @param mode - Mode::Broadcast to receive every message with this label, or Mode::Shared to
+     *               join the label's competing-consumer group, each of whose messages is
+     *               received by just one member
      */
-    bool RegisterForLabel(Label label) {
-        return s_mailboxData.RegisterForLabel(label, this);
+    bool RegisterForLabel(Label label, Mode mode = Mode::Broadcast) {
+        return s_mailboxData.RegisterForLabel(label, this, mode);
     }
 
     /**
@@ -99,52 +124,478 @@ public:
     }
 
     /**
-     * @brief Release the data block associated with a message
+     * @brief Register to receive a copy of every message with a label in [first, last]. The range
+     *        is one subscription (up to detail::MAX_SUBSCRIPTIONS in total), registered in one
+     *        operation, and doesn't use any of the labels' receiver slots. Labels beyond the
+     *        configured number of labels are ignored.
+     *
+     * @param first - first label of the range
+     * @param last - last label of the range
+     * @return false - first > last, first is out of range, already registered for this range or
+     *                 no subscriptions are free
+     */
+    bool RegisterForLabelRange(Label first, Label last) {
+        return s_mailboxData.RegisterForLabels(detail::Subscription {this, first, last, 0, 0});
+    }
+
+    /**
+     * @brief Cancel a registration made by RegisterForLabelRange()
+     */
+    bool UnregisterForLabelRange(Label first, Label last) {
+        return s_mailboxData.UnregisterForLabels(detail::Subscription {this, first, last, 0, 0});
+    }
+
+    /**
+     * @brief Register to receive a copy of every message whose label matches value in the bits
+     *        set in mask, i.e. (label & mask) == (value & mask). For example mask 0xFF00 and value
+     *        0x4000 match 0x4000-0x40FF. Subscribes like RegisterForLabelRange().
+     *
+     * @param mask - label bits to be compared
+     * @param value - value of those bits
+     * @return false - already registered for this mask and value, or no subscriptions are free
+     */
+    bool RegisterForLabelMask(Label mask, Label value) {
+        return s_mailboxData.RegisterForLabels(maskSubscription(mask, value));
+    }
+
+    /**
+     * @brief Cancel a registration made by RegisterForLabelMask()
+     */
+    bool UnregisterForLabelMask(Label mask, Label value) {
+        return s_mailboxData.UnregisterForLabels(maskSubscription(mask, value));
+    }
+
+    /**
+     * @brief Release the data block(s) associated with a message
      */
     void ReleaseMessage(Message &msg) {
-        if (msg.m_data != nullptr) {
-            if (msg.m_size <= s_mailboxData.smallSize()) {
-                s_mailboxData.freeSmall(msg.m_data);
-            } else {
-                s_mailboxData.freeLarge(msg.m_data);
+        Tracer::Record(TraceEvent::RELEASE, msg.m_label, m_traceId);
+        s_mailboxData.releaseMessage(msg);
+    }
+
+    /**
+     * @brief Return the ID identifying this mailbox in trace records (see Tracer)
+     */
+    [[nodiscard]] uint32_t TraceId() const {
+        return m_traceId;
+    }
+
+    /**
+     * @brief Send a message with a specific label and associated data of type T.
+     *
+     *        A T which isn't trivially copyable (e.g. with std::pmr::string or std::pmr::vector
+     *        members) is copy-constructed in place in a data block for each receiver, and
+     *        destroyed when the receiver releases the message; Message::as<T>() returns it only
+     *        for the same T. Types using a pmr allocator are constructed with one which allocates
+     *        from the rest of their "large" block, so their nested data stays off the heap; the
+     *        send fails if it doesn't fit.
+     *
+     * @tparam T - a POD type, or a copy-constructible type
+     * @param label - the message label
+     * @param t - an instance
+     */
+    template <typename T>
+    bool SendMessage(Label label, const T &t) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (sizeof(T) > s_mailboxData.largeSize()) {
+                // Typed messages must fit in a single data block
+                return false;
             }
+            const ByteSpan segment(reinterpret_cast<const std::byte *>(&t), sizeof(T));
+            return sendSegments(label, &segment, 1, sizeof(T));
+        } else {
+            static_assert(std::is_copy_constructible_v<T>, "SendMessage requires copy-constructible types");
+            return sendAllocated(
+                label, [&](Message &msg) { return s_mailboxData.allocateObject<T>(label, t, msg); }, std::nullopt);
         }
     }
 
     /**
-     * @brief Send a message with a specific label and associated data of type T
+     * @brief Send a message with a specific label whose data is a T which isn't trivially
+     *        copyable, moving it into the last receiver's data block (and copying it for any
+     *        others) as described for SendMessage(Label, const T&). Const rvalues can't be moved
+     *        from, so are copied by that overload (keeping T free of cv-qualifiers for as<T>()).
+     *
+     * @tparam T - a move-constructible type. Move-only types can only be sent to a single
+     *             receiver (counting observers such as a Journal, and the shared group); the send
+     *             fails, delivering nothing, if the label has more.
+     * @param label - the message label
+     * @param t - an instance to be moved from
+     */
+    template <typename T, std::enable_if_t<!std::is_lvalue_reference_v<T> && !std::is_const_v<T> &&
+                                               !std::is_trivially_copyable_v<T>,
+                              int> = 0>
+    bool SendMessage(Label label, T &&t) {
+        static_assert(std::is_move_constructible_v<T>, "SendMessage requires move-constructible types");
+        return sendAllocated(
+            label,
+            [&](Message &msg, bool last) {
+                if (last) {
+                    return s_mailboxData.allocateObject<T>(label, std::move(t), msg);
+                }
+                if constexpr (std::is_copy_constructible_v<T>) {
+                    return s_mailboxData.allocateObject<T>(label, std::as_const(t), msg);
+                } else {
+                    return false;
+                }
+            },
+            std::nullopt, std::is_copy_constructible_v<T> ? std::numeric_limits<size_t>::max() : 1);
+    }
+
+    /**
+     * @brief Send a message with a specific label, delivering it to the member of the label's
+     *        shared group which owns the key (and to each broadcast receiver as usual). Messages
+     *        with the same key are received in order by the same member while membership is
+     *        unchanged; when members join or leave, only the keys they take over or give up move.
      *
      * @tparam T - a POD type
      * @param label - the message label
+     * @param key - partitioning key (e.g. an account ID or a hash of a symbol)
      * @param t - an instance
+     * @return true - message was sent to all receivers
+     * @return false - pool capacity reached, or the owning member's queue (or a broadcast
+     *                 receiver's) was full
      */
     template <typename T>
-    bool SendMessage(Label label, const T &t) {
+    bool SendMessage(Label label, uint64_t key, const T &t) {
+        static_assert(std::is_trivially_copyable_v<T>, "SendMessage requires trivially copyable types");
+        if (sizeof(T) > s_mailboxData.largeSize()) {
+            return false;
+        }
+        const ByteSpan segment(reinterpret_cast<const std::byte *>(&t), sizeof(T));
+        return sendSegments(label, &segment, 1, sizeof(T), key);
+    }
+
+    /**
+     * @brief Send a message with a specific label whose data is a runtime-sized range of bytes.
+     *        The data is copied into the smallest pool whose element size fits it, or split
+     *        across a chain of "large" pool blocks if it exceeds largeSize().
+     *
+     * @param label - the message label
+     * @param bytes - message data
+     * @return true - message was sent to all receivers
+     * @return false - message too large or pool/queue capacity reached for a receiver
+     */
+    bool SendBytes(Label label, ByteSpan bytes) {
+        return sendSegments(label, &bytes, 1, bytes.size());
+    }
+
+    /**
+     * @brief Send a message with a specific label whose data is gathered from several ranges
+     *        of bytes (e.g. a header and a body), which are copied back-to-back into one data block
+     *
+     * @param label - the message label
+     * @param segments - ranges of bytes making up the message data, in order
+     * @return true - message was sent to all receivers
+     * @return false - message too large or pool/queue capacity reached for a receiver
+     */
+    bool SendBytes(Label label, std::initializer_list<ByteSpan> segments) {
+        size_t size = 0;
+        for (const auto &segment : segments) {
+            size += segment.size();
+        }
+        return sendSegments(label, segments.begin(), segments.size(), size);
+    }
+
+    /**
+     * @brief Send a signal with a specific label
+     *
+     * @param label - signal's label
+     * @return false - a receiver's queue was full (the others still get the signal)
+     */
+    bool SendSignal(Label label) {
+        const detail::TraceSend trace(label, m_traceId);
         std::lock_guard<std::mutex> guard(s_mailboxData.GetMutex());
+        trace.locked();
+
         bool result = true;
-        if (sizeof(T) > s_mailboxData.largeSize()) {
+        const auto &receivers = s_mailboxData.GetReceivers(label);
+        receivers.forEachReceiver(s_mailboxData.GetSubscriptions(),
+            [label, &result](MailboxBase *receiver) { result = receiver->deliver(Message(label)) && result; });
+        if (receivers.hasShared()) {
+            result = receivers.deliverShared([label](MailboxBase *receiver) { return receiver->deliver(Message(label)); }) &&
+                result;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Send a request to one member of a label's shared group or, if it has none, to the
+     *        first receiver registered for the label, and wait for its reply.
+     *        The reply is handed directly to this caller via a pooled correlation slot rather
+     *        than being routed by label, so no reply label or filtering is needed.
+     *
+     * @tparam Req - request type (trivially copyable)
+     * @tparam Resp - reply type (trivially copyable)
+     * @param label - the request label
+     * @param req - the request
+     * @param timeout - how long to wait for the reply
+     * @return std::optional<Resp> - the reply, or std::nullopt if the request couldn't be sent
+     *                               (no receiver, full queue, no free pool blocks or correlation
+     *                               slots), the reply was of the wrong size or timed out
+     */
+    template <typename Req, typename Resp, class Rep, class Period>
+    std::optional<Resp> Call(Label label, const Req &req, const std::chrono::duration<Rep, Period> &timeout) {
+        static_assert(std::is_trivially_copyable_v<Req>, "Call requires trivially copyable request types");
+        static_assert(std::is_trivially_copyable_v<Resp>, "Call requires trivially copyable reply types");
+        auto *calls = s_mailboxData.calls();
+        uint32_t index = 0;
+        uint32_t generation = 0;
+        if (calls == nullptr || !calls->acquire(index, generation)) {
+            return std::nullopt;
+        }
+        const ByteSpan data(reinterpret_cast<const std::byte *>(&req), sizeof(Req));
+        if (!sendRequest(label, data, detail::CallTrailer {index, generation})) {
+            calls->abandon(index, generation);
+            return std::nullopt;
+        }
+
+        auto &slot = (*calls)[index];
+        auto replied = [calls, index]() { return calls->replied(index); };
+        if (!slot.m_wait.waitFor(replied, timeout)) {
+            if (calls->abandon(index, generation)) {
+                return std::nullopt;
+            }
+            // Lost the race with a responder, whose reply is about to be available
+            slot.m_wait.wait(replied);
+        }
+
+        Message reply = calls->take(index, generation);
+        std::optional<Resp> result;
+        if (reply.m_size == sizeof(Resp)) {
+            alignas(Resp) std::byte bytes[sizeof(Resp)];
+            reply.copyTo(bytes, sizeof(Resp));
+            result = *reinterpret_cast<const Resp *>(bytes);
+        }
+        s_mailboxData.releaseMessage(reply);
+        return result;
+    }
+
+    /**
+     * @brief Reply to a request received from a Call(). The request itself must still be
+     *        released as usual.
+     *
+     * @tparam Resp - reply type (trivially copyable)
+     * @param request - the request message
+     * @param resp - the reply
+     * @return true - the reply was handed to the caller
+     * @return false - msg isn't a request, the caller is no longer waiting (timed out or already
+     *                 replied to) or the pool capacity was reached
+     */
+    template <typename Resp>
+    bool Reply(const Message &request, const Resp &resp) {
+        static_assert(std::is_trivially_copyable_v<Resp>, "Reply requires trivially copyable types");
+        auto *calls = s_mailboxData.calls();
+        if (calls == nullptr || !request.request() || request.m_data == nullptr) {
+            return false;
+        }
+        detail::CallTrailer trailer {};
+        memcpy(&trailer, request.m_data + detail::CallTrailerOffset(request.m_size), sizeof(trailer));
+
+        const ByteSpan segment(reinterpret_cast<const std::byte *>(&resp), sizeof(Resp));
+        Message reply;
+        if (!s_mailboxData.allocateMessage(request.m_label, &segment, 1, sizeof(Resp), reply)) {
+            return false;
+        }
+        if (!calls->reply(trailer, reply)) {
+            s_mailboxData.releaseMessage(reply);
             return false;
         }
-        bool isLarge = (sizeof(T) > s_mailboxData.smallSize());
+        return true;
+    }
+
+protected:
+    /**
+     * @brief Queue a message for this mailbox. Called with the shared mailbox lock held.
+     *
+     * @param msg - message to be queued
+     * @return true - message was queued
+     * @return false - queue full
+     */
+    virtual bool deliver(const Message &msg) = 0;
+
+    /**
+     * @brief Ask to have a waiter woken once this mailbox's queue has space. Called with the
+     *        shared mailbox lock held after deliver() has failed.
+     *
+     * @param waiter - waiter to be woken
+     * @return detail::SpaceWait - UNSUPPORTED for mailboxes which don't notify waiters
+     */
+    virtual detail::SpaceWait waitForSpace(detail::AsyncWaiter * /*waiter*/) {
+        return detail::SpaceWait::UNSUPPORTED;
+    }
+
+    /**
+     * @brief Return true for receivers which only observe the messages sent with a label (e.g.
+     *        Journal), which are never sent requests
+     */
+    virtual bool observer() const {
+        return false;
+    }
+
+    /**
+     * @brief Return true if a message can be received without waiting. Only called by WaitAny(),
+     *        which accepts only mailboxes overriding it (see Waitable).
+     */
+    virtual bool pending() {
+        return false;
+    }
+
+    /**
+     * @brief Wake a thread blocked in WaitAny() on this mailbox. Called by deliver(), with the
+     *        shared mailbox lock held, after queueing a message.
+     */
+    void notifyReady() {
+        if (m_readyWaiter != nullptr) {
+            m_readyWaiter->notify();
+        }
+    }
+
+    /**
+     * @brief Shared mailbox state among all Mailbox instances
+     */
+    inline static detail::MailboxData s_mailboxData;
+
+private:
+    template <Label L, class T>
+    friend class Channel;
+
+    /**
+     * @brief Timers allocate their payload's shared block and deliver it on each expiry
+     */
+    friend class detail::Timer;
+    friend class detail::TimerManagerData;
+
+    template <class Rep, class Period>
+    friend std::optional<size_t> WaitAny(
+        std::initializer_list<Waitable> mailboxes, const std::chrono::duration<Rep, Period> &duration);
+
+    friend size_t WaitAny(std::initializer_list<Waitable> mailboxes);
+
+    /**
+     * @brief Set (or, with nullptr, clear) the waiter woken when a message is queued for each of
+     *        a set of mailboxes. Once it has been cleared no sender can still be notifying it.
+     */
+    static void setReadyWaiter(std::initializer_list<Waitable> mailboxes, BlockingWait *waiter);
+
+    /**
+     * @brief Find the first of a set of mailboxes with a message which can be received
+     *
+     * @param index - set to the index of the mailbox
+     * @return false - none has
+     */
+    static bool firstPending(std::initializer_list<Waitable> mailboxes, size_t &index);
+
+    /**
+     * @brief Waiter for a thread blocked in WaitAny() on this mailbox, of which there may only be
+     *        one at a time. Protected by the shared mailbox lock.
+     */
+    BlockingWait *m_readyWaiter = nullptr;
+
+    /**
+     * @brief Source of mailbox trace IDs
+     */
+    inline static std::atomic<uint32_t> s_nextTraceId {1};
+
+    /**
+     * @brief ID identifying this mailbox in trace records
+     */
+    uint32_t m_traceId = s_nextTraceId.fetch_add(1, std::memory_order_relaxed);
+
+    /**
+     * @brief SpscMailbox shares the message pools but not label routing
+     */
+    template <size_t Capacity>
+    friend class SpscMailbox;
+
+    /**
+     * @brief AsyncMailbox delivers to other mailboxes with backpressure
+     */
+    friend class AsyncMailbox;
+
+    /**
+     * @brief Copy one or more ranges of bytes into a data block (or chain of blocks) for each
+     *        receiver of a label, and one more for its shared group
+     *
+     * @param label - the message label
+     * @param segments - ranges of bytes making up the message data
+     * @param count - number of ranges
+     * @param size - total size of the message data in bytes
+     * @param key - partitioning key selecting the shared group member, or round-robin if none
+     */
+    bool sendSegments(Label label, const ByteSpan *segments, size_t count, size_t size,
+        std::optional<uint64_t> key = std::nullopt) {
+        return sendAllocated(
+            label, [&](Message &msg) { return s_mailboxData.allocateMessage(label, segments, count, size, msg); }, key);
+    }
+
+    /**
+     * @brief Copy fixed-size data into a block from a pool chosen in advance (see
+     *        MailboxData::poolFor()) for each receiver of a label, and one more for its shared group
+     */
+    bool sendBlock(Label label, const void *data, uint32_t size, detail::PoolClass pool) {
+        return sendAllocated(
+            label, [&](Message &msg) { return s_mailboxData.allocateBlock(label, data, size, pool, msg); }, std::nullopt);
+    }
+
+    /**
+     * @brief Deliver a shared block's data (see MailboxData::allocateShared()) to each receiver of
+     *        a label, and one more for its shared group, adding a reference for each message
+     */
+    bool sendShared(Label label, std::byte *shared, uint32_t size) {
+        return sendAllocated(
+            label, [&](Message &msg) { return s_mailboxData.shareBlock(label, shared, size, msg); }, std::nullopt);
+    }
+
+    /**
+     * @brief Deliver a message allocated by allocate(msg) to each receiver of a label, and one more
+     *        to its shared group. If allocate takes a second argument it is true for the last
+     *        message allocated, which may then take ownership of the data; the send then fails
+     *        without delivering anything if there are more than maxReceivers messages to deliver.
+     */
+    template <class Allocate>
+    bool sendAllocated(Label label, Allocate &&allocate, std::optional<uint64_t> key,
+                       size_t maxReceivers = std::numeric_limits<size_t>::max()) {
+        const detail::TraceSend trace(label, m_traceId);
+        std::lock_guard<std::mutex> guard(s_mailboxData.GetMutex());
+        trace.locked();
+        bool result = true;
         const auto &receivers = s_mailboxData.GetReceivers(label);
-        for (const auto &receiver : receivers.m_receivers) {
-            if (receiver == nullptr) {
-                continue;
+        [[maybe_unused]] size_t remaining = 0;
+        if constexpr (std::is_invocable_v<Allocate &, Message &, bool>) {
+            receivers.forEachReceiver(s_mailboxData.GetSubscriptions(), [&remaining](MailboxBase *) { remaining++; });
+            remaining += receivers.hasShared() ? 1 : 0;
+            if (remaining > maxReceivers) {
+                return false;
             }
-            detail::DataBlock db;
-            if (isLarge) {
-                db = s_mailboxData.allocateLarge();
+        }
+        auto allocateNext = [&allocate, &remaining](Message &msg) {
+            if constexpr (std::is_invocable_v<Allocate &, Message &, bool>) {
+                return allocate(msg, --remaining == 0);
             } else {
-                db = s_mailboxData.allocateSmall();
+                return allocate(msg);
             }
-            if (db.get() != nullptr) {
-                if (db.put(t)) {
-                    result &= receiver->m_queue.emplace(label, sizeof(T), db.get());
-                } else {
-                    s_mailboxData.freeSmall(db.get());
-                    result = false;
-                }
-            } else {
+        };
+        receivers.forEachReceiver(s_mailboxData.GetSubscriptions(), [&](MailboxBase *receiver) {
+            Message msg;
+            if (!allocateNext(msg)) {
+                result = false;
+                return;
+            }
+            if (!receiver->deliver(msg)) {
+                s_mailboxData.releaseMessage(msg);
+                result = false;
+            }
+        });
+        if (receivers.hasShared()) {
+            Message msg;
+            if (!allocateNext(msg)) {
+                return false;
+            }
+            auto deliver = [&msg](MailboxBase *receiver) { return receiver->deliver(msg); };
+            const bool delivered = key ? deliver(receivers.partition(*key)) : receivers.deliverShared(deliver);
+            if (!delivered) {
+                s_mailboxData.releaseMessage(msg);
                 result = false;
             }
         }
@@ -152,24 +603,109 @@ public:
     }
 
     /**
-     * @brief Send a signal with a specific label
+     * @brief Send a request to one member of a label's shared group, or else its first receiver
      *
-     * @param label - signal's label
+     * @param label - the request label
+     * @param data - request data
+     * @param trailer - identifies the caller's correlation slot
      */
-    bool SendSignal(Label label) {
+    bool sendRequest(Label label, ByteSpan data, const detail::CallTrailer &trailer) {
+        const detail::TraceSend trace(label, m_traceId);
         std::lock_guard<std::mutex> guard(s_mailboxData.GetMutex());
-
+        trace.locked();
         const auto &receivers = s_mailboxData.GetReceivers(label);
-        for (const auto &receiver : receivers.m_receivers) {
-            if (receiver == nullptr) {
-                continue;
+        if (receivers.hasShared()) {
+            Message msg;
+            if (!s_mailboxData.allocateRequest(label, data, trailer, msg)) {
+                return false;
+            }
+            if (!receivers.deliverShared([&msg](MailboxBase *receiver) { return receiver->deliver(msg); })) {
+                s_mailboxData.releaseMessage(msg);
+                return false;
+            }
+            return true;
+        }
+        MailboxBase *target = nullptr;
+        receivers.forEachReceiver(s_mailboxData.GetSubscriptions(), [&target](MailboxBase *receiver) {
+            if (target == nullptr && !receiver->observer()) {
+                target = receiver;
             }
-            Message m(label);
-            receiver->m_queue.emplace(label);
+        });
+        if (target == nullptr) {
+            return false;
+        }
+        Message msg;
+        if (!s_mailboxData.allocateRequest(label, data, trailer, msg)) {
+            return false;
+        }
+        if (!target->deliver(msg)) {
+            s_mailboxData.releaseMessage(msg);
+            return false;
         }
         return true;
     }
 
+    /**
+     * @brief Return the subscription for RegisterForLabelMask()
+     */
+    detail::Subscription maskSubscription(Label mask, Label value) {
+        return detail::Subscription {this, 0, std::numeric_limits<Label>::max(), mask, static_cast<Label>(value & mask)};
+    }
+
+};
+
+/**
+ * @brief BasicMailbox is a mailbox whose receive side is assembled at compile time from policies
+ *
+ * @tparam QueuePolicy - container for received messages (LockedQueue or LockFreeQueue)
+ * @tparam WaitPolicy - how Receive() waits for a message (BlockingWait or SpinWait)
+ * @tparam StoragePolicy - where queue storage lives (HeapStorage or InlineStorage<N>)
+ */
+template <class QueuePolicy = LockedQueue, class WaitPolicy = BlockingWait, class StoragePolicy = HeapStorage>
+class BasicMailbox : public MailboxBase {
+public:
+    /**
+     * @brief Default queue capacity: the InlineStorage capacity, or 256 for HeapStorage
+     */
+    static constexpr size_t QUEUE_SIZE = (StoragePolicy::CAPACITY != 0) ? StoragePolicy::CAPACITY : 256;
+
+    /**
+     * @brief Construct a new Mailbox object
+     */
+    BasicMailbox() : BasicMailbox(QUEUE_SIZE, 0) {
+    }
+
+    /**
+     * @brief Construct a new Mailbox with a specific queue capacity (HeapStorage only)
+     *
+     * @param queueSize - queue capacity
+     */
+    template <class S = StoragePolicy, std::enable_if_t<S::CAPACITY == 0, int> = 0>
+    explicit BasicMailbox(size_t queueSize) : BasicMailbox(queueSize, 0) {
+    }
+
+    /**
+     * @brief Disable copy construction
+     */
+    BasicMailbox(const BasicMailbox &) = delete;
+
+    /**
+     * @brief Disable move construction
+     */
+    BasicMailbox(BasicMailbox &&) = delete;
+
+    /**
+     * @brief Destroy the Mailbox object, releasing any messages set aside by ReceiveIf() or
+     *        never received. Unregister its labels first, so that nothing is still being
+     *        delivered to it.
+     */
+    ~BasicMailbox() override {
+        Message msg;
+        while (m_deferred.popFront(msg) || m_queue.tryPop(msg)) {
+            ReleaseMessage(msg);
+        }
+    }
+
     /**
      * @brief Block and wait until a signal/message of a register type is received
      *
@@ -178,19 +714,170 @@ public:
      *              Note: message is owned by the mailbox
      */
     void Receive(Message &msg) {
-        m_queue.pop(msg);
+        if (!m_deferred.popFront(msg)) {
+            if constexpr (QueuePolicy::NATIVE_WAIT && WaitPolicy::BLOCKS) {
+                m_queue.pop(msg);
+            } else {
+                m_wait.wait([this, &msg]() { return m_queue.tryPop(msg); });
+            }
+        }
+        received(msg);
+    }
+
+    /**
+     * @brief Wait for up to a specified duration until a signal/message is received
+     *
+     * @param msg - associated message data, or nullptr for signal
+     * @param duration - how long to wait
+     * @return true - a message was received
+     * @return false - timed out
+     */
+    template <class Rep, class Period>
+    bool Receive(Message &msg, const std::chrono::duration<Rep, Period> &duration) {
+        bool result = m_deferred.popFront(msg);
+        if (!result) {
+            if constexpr (QueuePolicy::NATIVE_WAIT && WaitPolicy::BLOCKS) {
+                result = m_queue.popWait(msg, duration);
+            } else {
+                result = m_wait.waitFor([this, &msg]() { return m_queue.tryPop(msg); }, duration);
+            }
+        }
+        return result && received(msg);
+    }
+
+    /**
+     * @brief Receive a signal/message if one is available without waiting
+     *
+     * @param msg - associated message data, or nullptr for signal
+     * @return true - a message was received
+     * @return false - the queue was empty
+     */
+    bool TryReceive(Message &msg) {
+        return (m_deferred.popFront(msg) || m_queue.tryPop(msg)) && received(msg);
+    }
+
+    /**
+     * @brief Wait for up to a specified duration until a signal/message with one of a set of
+     *        labels is received. Messages with other labels which are dequeued meanwhile are set
+     *        aside, in order, and returned by later calls to Receive(), TryReceive() or
+     *        ReceiveIf(). Usage: `mbox.ReceiveIf({REPLY, ERROR}, msg, timeout)`
+     *
+     * @param labels - labels to receive
+     * @param msg - associated message data, or nullptr for signal
+     * @param duration - how long to wait
+     * @return true - a message was received
+     * @return false - timed out, or as many messages as the queue capacity have been set aside
+     */
+    template <class Rep, class Period>
+    bool ReceiveIf(std::initializer_list<Label> labels, Message &msg, const std::chrono::duration<Rep, Period> &duration) {
+        return receiveIf(
+            [labels](const Message &m) { return std::find(labels.begin(), labels.end(), m.m_label) != labels.end(); },
+            [this, labels](Message &m) { return m_deferred.take(labels.begin(), labels.size(), m); }, msg, duration);
+    }
+
+    /**
+     * @brief Wait for up to a specified duration until a signal/message satisfying a predicate
+     *        is received. Messages which don't satisfy it are set aside as for
+     *        ReceiveIf(labels, ...), but finding a match among them tests each in turn rather than
+     *        following the per-label chains.
+     *
+     * @param pred - callable taking a const Message&
+     * @param msg - associated message data, or nullptr for signal
+     * @param duration - how long to wait
+     * @return true - a message was received
+     * @return false - timed out, or as many messages as the queue capacity have been set aside
+     */
+    template <class Pred, class Rep, class Period,
+        std::enable_if_t<std::is_invocable_r_v<bool, Pred &, const Message &>, int> = 0>
+    bool ReceiveIf(Pred &&pred, Message &msg, const std::chrono::duration<Rep, Period> &duration) {
+        return receiveIf(
+            pred, [this, &pred](Message &m) { return m_deferred.takeIf(pred, m); }, msg, duration);
+    }
+
+protected:
+    bool deliver(const Message &msg) override {
+        if (!m_queue.tryPush(msg)) {
+            return false;
+        }
+        Tracer::Record(TraceEvent::ENQUEUE, msg.m_label, TraceId());
+        if constexpr (!QueuePolicy::NATIVE_WAIT) {
+            m_wait.notify();
+        }
+        notifyReady();
+        return true;
+    }
+
+    bool pending() override {
+        return !m_deferred.empty() || !m_queue.empty();
     }
 
 private:
+    using QueueType = typename QueuePolicy::template Queue<Message>;
+    using BufferType = typename StoragePolicy::template Buffer<QueuePolicy::template ELEMENT_SIZE<Message>>;
+
+    using DeferredBufferType = typename StoragePolicy::template Buffer<detail::DeferredMessages::ELEMENT_SIZE>;
+
+    BasicMailbox(size_t queueSize, int /*unused*/)
+        : m_storage(queueSize)
+        , m_bytes(m_storage.data(), m_storage.size())
+        , m_resource(&m_bytes)
+        , m_queue(queueSize, &m_resource)
+        , m_deferredStorage(queueSize)
+        , m_deferredBytes(m_deferredStorage.data(), m_deferredStorage.size())
+        , m_deferred(queueSize, &m_deferredBytes) {
+    }
+
     /**
-     * @brief Shared mailbox state among all Mailbox instances
+     * @brief Take the first matching message set aside by an earlier call, else dequeue messages
+     *        until one matches, setting the others aside
+     *
+     * @param match - test for a newly dequeued message
+     * @param takeDeferred - take the first matching message which was set aside
      */
-    inline static detail::MailboxData s_mailboxData;
+    template <class Match, class TakeDeferred, class Rep, class Period>
+    bool receiveIf(Match &&match, TakeDeferred &&takeDeferred, Message &msg, const std::chrono::duration<Rep, Period> &duration) {
+        if (takeDeferred(msg)) {
+            return received(msg);
+        }
+        const auto deadline = std::chrono::steady_clock::now() + duration;
+        while (!m_deferred.full()) {
+            bool popped = m_queue.tryPop(msg);
+            if (!popped) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    return false;
+                }
+                if constexpr (QueuePolicy::NATIVE_WAIT && WaitPolicy::BLOCKS) {
+                    popped = m_queue.popWait(msg, deadline - now);
+                } else {
+                    popped = m_wait.waitFor([this, &msg]() { return m_queue.tryPop(msg); }, deadline - now);
+                }
+                if (!popped) {
+                    return false;
+                }
+            }
+            if (match(static_cast<const Message &>(msg))) {
+                return received(msg);
+            }
+            m_deferred.push(msg);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Record that a message has been received, for tracing
+     *
+     * @return true
+     */
+    bool received(const Message &msg) const {
+        Tracer::Record(TraceEvent::RECEIVE, msg.m_label, TraceId());
+        return true;
+    }
 
     /**
      * @brief Underlying data for the queue's monotonic buffer resource
      */
-    std::unique_ptr<std::byte[]> m_storage;
+    BufferType m_storage;
 
     /**
      * @brief Monotonic buffer resource supporting this instance's queue
@@ -205,13 +892,123 @@ private:
     /**
      * @brief Queue for this instance of the Mailbox class
      */
-    detail::Queue<Message> m_queue;
+    QueueType m_queue;
+
+    /**
+     * @brief Underlying data for the deferred messages' monotonic buffer resource
+     */
+    DeferredBufferType m_deferredStorage;
+
+    /**
+     * @brief Monotonic buffer resource supporting this instance's deferred messages
+     */
+    std::pmr::monotonic_buffer_resource m_deferredBytes;
+
+    /**
+     * @brief Messages set aside by ReceiveIf(), which are received before those still queued
+     */
+    detail::DeferredMessages m_deferred;
+
+    /**
+     * @brief Wait strategy for this instance's consumer
+     */
+    WaitPolicy m_wait;
 };
 
+/**
+ * @brief Mailbox provides interfaces for sending and receiving messages to one or more subscribers,
+ *        using a mutex-protected queue with blocking receives and heap-allocated queue storage
+ */
+using Mailbox = BasicMailbox<>;
+
+/**
+ * @brief Waitable is a mailbox which WaitAny() can wait on: a BasicMailbox (of any policies).
+ *        Other mailbox types can't report whether a message is pending, so don't convert.
+ */
+class Waitable {
+public:
+    template <class QueuePolicy, class WaitPolicy, class StoragePolicy>
+    Waitable(BasicMailbox<QueuePolicy, WaitPolicy, StoragePolicy> *mailbox) : m_mailbox(mailbox) {  // NOLINT
+    }
+
+    [[nodiscard]] MailboxBase *get() const {
+        return m_mailbox;
+    }
+
+private:
+    MailboxBase *m_mailbox;
+};
+
+inline void MailboxBase::setReadyWaiter(std::initializer_list<Waitable> mailboxes, BlockingWait *waiter) {
+    std::lock_guard<std::mutex> guard(s_mailboxData.GetMutex());
+    for (const auto &waitable : mailboxes) {
+        MailboxBase *mailbox = waitable.get();
+        if (mailbox != nullptr) {
+            assert((waiter == nullptr || mailbox->m_readyWaiter == nullptr) && "Mailbox already has a WaitAny() waiter");
+            mailbox->m_readyWaiter = waiter;
+        }
+    }
+}
+
+inline bool MailboxBase::firstPending(std::initializer_list<Waitable> mailboxes, size_t &index) {
+    index = 0;
+    for (const auto &waitable : mailboxes) {
+        MailboxBase *mailbox = waitable.get();
+        if (mailbox != nullptr && mailbox->pending()) {
+            return true;
+        }
+        index++;
+    }
+    return false;
+}
+
+/**
+ * @brief Wait for up to a specified duration until any of a set of mailboxes has a message which
+ *        can be received, parking the calling thread once for all of them rather than polling
+ *        each in turn. Only the calling thread should receive from the mailboxes while it waits,
+ *        and each mailbox may only be waited on by one WaitAny() at a time.
+ *        Usage: `auto index = WaitAny({&high, &low}, 100ms);`
+ *
+ * @param mailboxes - BasicMailbox instances (of any policies) to wait on, in priority order
+ * @param duration - how long to wait
+ * @return std::optional<size_t> - index of the first mailbox with a message, or std::nullopt if
+ *                                 timed out
+ */
+template <class Rep, class Period>
+std::optional<size_t> WaitAny(std::initializer_list<Waitable> mailboxes, const std::chrono::duration<Rep, Period> &duration) {
+    BlockingWait waiter;
+    MailboxBase::setReadyWaiter(mailboxes, &waiter);
+    size_t index = 0;
+    const bool ready = waiter.waitFor([mailboxes, &index]() { return MailboxBase::firstPending(mailboxes, index); }, duration);
+    MailboxBase::setReadyWaiter(mailboxes, nullptr);
+    if (!ready) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+/**
+ * @brief Block until any of a set of mailboxes has a message which can be received
+ *
+ * @param mailboxes - BasicMailbox instances (of any policies) to wait on, in priority order
+ * @return size_t - index of the first mailbox with a message
+ */
+inline size_t WaitAny(std::initializer_list<Waitable> mailboxes) {
+    BlockingWait waiter;
+    MailboxBase::setReadyWaiter(mailboxes, &waiter);
+    size_t index = 0;
+    waiter.wait([mailboxes, &index]() { return MailboxBase::firstPending(mailboxes, index); });
+    MailboxBase::setReadyWaiter(mailboxes, nullptr);
+    return index;
+}
+
 /**
  * @brief MessageGuard is an RAII-style wrapper class to reclaim resources associated with a Message
  *        which has been received from a mailbox.
+ *
+ * @tparam MailboxType - type of mailbox the message was received from (e.g. Mailbox, SpscMailbox)
  */
+template <class MailboxType = Mailbox>
 class MessageGuard {
 public:
     /**
@@ -225,7 +1022,7 @@ public:
      * @param mailbox
      * @param msg
      */
-    MessageGuard(Mailbox &mailbox, Message &msg) : m_mailbox(mailbox), m_msg(msg) {
+    MessageGuard(MailboxType &mailbox, Message &msg) : m_mailbox(mailbox), m_msg(msg) {
     }
 
     /**
@@ -242,7 +1039,7 @@ private:
     /**
      * @brief References to the specific mailbox and message
      */
-    Mailbox &m_mailbox;
+    MailboxType &m_mailbox;
     Message &m_msg;
 };
 
@@ -0,0 +1,301 @@
+#pragma once
+#include "detail/Arena.h"
+#include "detail/CpuRelax.h"
+#include "detail/MpmcQueue.h"
+#include "detail/Queue.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace msglib {
+
+//---------------------------------------------------------------------------------------
+// Queue policies: the container holding a mailbox's received messages
+//---------------------------------------------------------------------------------------
+
+/**
+ * @brief LockedQueue selects a mutex-protected queue. Combined with BlockingWait, consumers
+ *        block on the queue's own condition variable.
+ */
+struct LockedQueue {
+    template <class T>
+    using Queue = detail::Queue<T>;
+
+    /**
+     * @brief Bytes of storage reserved per queue element
+     */
+    template <class T>
+    static constexpr size_t ELEMENT_SIZE = sizeof(T);
+
+    /**
+     * @brief The queue provides its own blocking pop()/popWait()
+     */
+    static constexpr bool NATIVE_WAIT = true;
+};
+
+/**
+ * @brief LockFreeQueue selects a bounded lock-free multi-producer/multi-consumer ring
+ */
+struct LockFreeQueue {
+    template <class T>
+    using Queue = detail::MpmcQueue<T>;
+
+    /**
+     * @brief Bytes of storage reserved per queue element
+     */
+    template <class T>
+    static constexpr size_t ELEMENT_SIZE = sizeof(typename detail::MpmcQueue<T>::Slot);
+
+    /**
+     * @brief Waiting is provided by the mailbox's WaitPolicy
+     */
+    static constexpr bool NATIVE_WAIT = false;
+};
+
+//---------------------------------------------------------------------------------------
+// Wait policies: how a consumer waits for a message to arrive
+//---------------------------------------------------------------------------------------
+
+/**
+ * @brief BlockingWait parks a waiting consumer until a producer notifies it. Producers only
+ *        touch the mutex/condition variable when a consumer has announced that it is waiting.
+ */
+class BlockingWait {
+public:
+    static constexpr bool BLOCKS = true;
+
+    /**
+     * @brief Called by a producer after making an element available
+     */
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_condVariable.notify_one();
+        }
+    }
+
+    /**
+     * @brief Wake every waiting consumer, e.g. so that they can observe a shutdown
+     */
+    void notifyAll() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_condVariable.notify_all();
+        }
+    }
+
+    /**
+     * @brief Wait until tryPop() succeeds
+     *
+     * @param tryPop - callable returning true once an element has been dequeued
+     */
+    template <class TryPop>
+    void wait(TryPop &&tryPop) {
+        while (!tryPop()) {
+            std::unique_lock<std::mutex> uniqueLock(m_mutex);
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            // Re-check after announcing this waiter so that a concurrent notify() isn't missed
+            if (!tryPop()) {
+                m_condVariable.wait(uniqueLock);
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+            } else {
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Wait for up to a specified duration until tryPop() succeeds
+     *
+     * @param tryPop - callable returning true once an element has been dequeued
+     * @param duration - how long to wait before returning false
+     * @return true - element was dequeued
+     * @return false - timed out
+     */
+    template <class TryPop, class Rep, class Period>
+    bool waitFor(TryPop &&tryPop, const std::chrono::duration<Rep, Period> &duration) {
+        const auto deadline = std::chrono::steady_clock::now() + duration;
+        while (!tryPop()) {
+            std::unique_lock<std::mutex> uniqueLock(m_mutex);
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            if (tryPop()) {
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            auto status = m_condVariable.wait_until(uniqueLock, deadline);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+            if (status == std::cv_status::timeout) {
+                return tryPop();
+            }
+        }
+        return true;
+    }
+
+private:
+    std::atomic<unsigned> m_waiters {0};
+    std::mutex m_mutex;
+    std::condition_variable m_condVariable;
+};
+
+/**
+ * @brief SpinWait busy-waits (with a CPU pause hint, then yielding) instead of parking, trading
+ *        CPU time for the lowest hand-off latency. Producers never have to notify.
+ */
+class SpinWait {
+public:
+    static constexpr bool BLOCKS = false;
+
+    void notify() {
+    }
+
+    template <class TryPop>
+    void wait(TryPop &&tryPop) {
+        unsigned spins = 0;
+        while (!tryPop()) {
+            backoff(spins);
+        }
+    }
+
+    template <class TryPop, class Rep, class Period>
+    bool waitFor(TryPop &&tryPop, const std::chrono::duration<Rep, Period> &duration) {
+        const auto deadline = std::chrono::steady_clock::now() + duration;
+        unsigned spins = 0;
+        while (!tryPop()) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            backoff(spins);
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief Number of pause-spins before a waiting consumer starts yielding its timeslice
+     */
+    static constexpr unsigned SPIN_LIMIT = 1024;
+
+    static void backoff(unsigned &spins) {
+        if (spins < SPIN_LIMIT) {
+            spins++;
+            detail::CpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+};
+
+//---------------------------------------------------------------------------------------
+// Storage policies: where a mailbox's queue storage lives
+//---------------------------------------------------------------------------------------
+
+/**
+ * @brief HeapStorage allocates queue storage when the mailbox is constructed, with the queue
+ *        capacity given as a constructor argument. Storage is pre-faulted and honors the
+ *        Options::m_hugePages and m_lockMemory settings passed to Initialize(). Each Buffer is
+ *        its own Arena, and a BasicMailbox has two (its queue and the messages ReceiveIf() sets
+ *        aside), so constructing a mailbox costs two mmap()s, pre-faulting them and optionally
+ *        mlock()ing them; construct mailboxes at startup rather than on the hot path.
+ */
+struct HeapStorage {
+    /**
+     * @brief Capacity is specified at runtime
+     */
+    static constexpr size_t CAPACITY = 0;
+
+    template <size_t EltSize>
+    class Buffer {
+    public:
+        explicit Buffer(size_t capacity) : m_arena(capacity * EltSize, detail::DefaultArenaConfig()) {
+        }
+
+        std::byte *data() {
+            return m_arena.data();
+        }
+
+        [[nodiscard]] size_t size() const {
+            return m_arena.size();
+        }
+
+    private:
+        detail::Arena m_arena;
+    };
+};
+
+/**
+ * @brief NumaStorage allocates queue storage when the mailbox is constructed, placed in the
+ *        memory of the NUMA node the constructing thread is running on. Construct the mailbox
+ *        on its consumer thread (as is usual) so that the queue is local to the consumer. Costs
+ *        the same as HeapStorage to construct.
+ */
+struct NumaStorage {
+    /**
+     * @brief Capacity is specified at runtime
+     */
+    static constexpr size_t CAPACITY = 0;
+
+    template <size_t EltSize>
+    class Buffer {
+    public:
+        explicit Buffer(size_t capacity) : m_arena(capacity * EltSize, nodeConfig()) {
+        }
+
+        std::byte *data() {
+            return m_arena.data();
+        }
+
+        [[nodiscard]] size_t size() const {
+            return m_arena.size();
+        }
+
+    private:
+        static detail::ArenaConfig nodeConfig() {
+            detail::ArenaConfig config = detail::DefaultArenaConfig();
+            config.m_node = detail::CurrentNumaNode();
+            return config;
+        }
+
+        detail::Arena m_arena;
+    };
+};
+
+/**
+ * @brief InlineStorage holds queue storage inside the mailbox object itself, with the queue
+ *        capacity fixed at compile time
+ *
+ * @tparam N - queue capacity
+ */
+template <size_t N>
+struct InlineStorage {
+    static_assert(N > 0, "InlineStorage capacity must be non-zero");
+
+    static constexpr size_t CAPACITY = N;
+
+    template <size_t EltSize>
+    class Buffer {
+    public:
+        explicit Buffer(size_t /*capacity*/) {
+        }
+
+        std::byte *data() {
+            return m_bytes.data();
+        }
+
+        [[nodiscard]] size_t size() const {
+            return m_bytes.size();
+        }
+
+    private:
+        alignas(std::max_align_t) std::array<std::byte, N * EltSize> m_bytes;
+    };
+};
+
+}  // namespace msglib
@@ -1,18 +1,203 @@
 #pragma once
+#include "detail/Chain.h"
+#include "detail/Object.h"
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <type_traits>
-
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
 
 namespace msglib {
 
 using Label = uint16_t;
 
+#if defined(__cpp_lib_span)
+/**
+ * @brief Read-only view of a contiguous range of message bytes
+ */
+using ByteSpan = std::span<const std::byte>;
+#else
+/**
+ * @brief Read-only view of a contiguous range of message bytes. This is a minimal stand-in
+ *        for std::span<const std::byte> when building with C++17.
+ */
+class ByteSpan {
+public:
+    /**
+     * @brief Construct an empty ByteSpan
+     */
+    constexpr ByteSpan() noexcept = default;
+
+    /**
+     * @brief Construct a ByteSpan viewing size bytes starting at data
+     *
+     * @param data - first byte of the range
+     * @param size - number of bytes in the range
+     */
+    constexpr ByteSpan(const std::byte *data, size_t size) noexcept : m_data(data), m_size(size) {
+    }
+
+    [[nodiscard]] constexpr const std::byte *data() const noexcept {
+        return m_data;
+    }
+
+    [[nodiscard]] constexpr size_t size() const noexcept {
+        return m_size;
+    }
+
+    [[nodiscard]] constexpr bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] constexpr const std::byte *begin() const noexcept {
+        return m_data;
+    }
+
+    [[nodiscard]] constexpr const std::byte *end() const noexcept {
+        return m_data + m_size;
+    }
+
+    constexpr const std::byte &operator[](size_t idx) const noexcept {
+        return m_data[idx];
+    }
+
+private:
+    const std::byte *m_data = nullptr;
+    size_t m_size = 0;
+};
+#endif
+
+/**
+ * @brief SegmentView is a scatter-gather view of a message's data as a sequence of contiguous
+ *        ByteSpan segments. Messages held in a single data block have one segment; chained
+ *        messages have one segment per block in the chain.
+ */
+class SegmentView {
+public:
+    /**
+     * @brief Forward iterator over the segments of a message's data
+     */
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ByteSpan;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ByteSpan *;
+        using reference = ByteSpan;
+
+        /**
+         * @brief Construct an end iterator
+         */
+        iterator() = default;
+
+        /**
+         * @brief Construct an iterator positioned at a message's first data block
+         *
+         * @param block - first data block, or nullptr
+         * @param size - message data size (used for non-chained messages)
+         * @param chained - true if the data block is the head of a chain
+         */
+        iterator(const std::byte *block, size_t size, bool chained) : m_block(block), m_size(size), m_chained(chained) {
+        }
+
+        ByteSpan operator*() const {
+            if (m_chained) {
+                return ByteSpan(detail::ChainPayload(m_block), detail::ChainHeaderOf(m_block)->m_length);
+            }
+            return ByteSpan(m_block, m_size);
+        }
+
+        iterator &operator++() {
+            m_block = m_chained ? detail::ChainHeaderOf(m_block)->m_next : nullptr;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator prev = *this;
+            ++(*this);
+            return prev;
+        }
+
+        bool operator==(const iterator &rhs) const {
+            return m_block == rhs.m_block;
+        }
+
+        bool operator!=(const iterator &rhs) const {
+            return m_block != rhs.m_block;
+        }
+
+    private:
+        const std::byte *m_block = nullptr;
+        size_t m_size = 0;
+        bool m_chained = false;
+    };
+
+    /**
+     * @brief Construct a SegmentView of a message's data
+     *
+     * @param data - message data, or nullptr for signals
+     * @param size - message data size
+     * @param chained - true if the data is the head of a chain of blocks
+     */
+    SegmentView(const std::byte *data, size_t size, bool chained) : m_data(data), m_size(size), m_chained(chained) {
+    }
+
+    [[nodiscard]] iterator begin() const {
+        return iterator(m_data, m_size, m_chained);
+    }
+
+    [[nodiscard]] iterator end() const {
+        return iterator();
+    }
+
+    /**
+     * @brief Return the number of segments
+     *
+     * @return size_t
+     */
+    [[nodiscard]] size_t count() const {
+        return static_cast<size_t>(std::distance(begin(), end()));
+    }
+
+private:
+    const std::byte *m_data;
+    size_t m_size;
+    bool m_chained;
+};
+
 /**
  * @brief Representation of a message returned from a Mailbox Receive() call
  */
 struct Message {
 public:
+    /**
+     * @brief Flag indicating that m_data is the head of a chain of "large" pool blocks
+     */
+    static constexpr uint16_t CHAINED = 0x0001;
+
+    /**
+     * @brief Flag indicating that the message is a request sent with Mailbox::Call(), which
+     *        should be answered with Mailbox::Reply()
+     */
+    static constexpr uint16_t REQUEST = 0x0002;
+
+    /**
+     * @brief Flag indicating that m_data holds an object constructed in place (see
+     *        Mailbox::SendMessage() for types which aren't trivially copyable), which is destroyed
+     *        when the message is released. m_size is then the size of the data block.
+     */
+    static constexpr uint16_t OBJECT = 0x0004;
+
+    /**
+     * @brief Flag indicating that m_data is held in a reference-counted block shared with other
+     *        messages (e.g. each expiry of a timer with a payload), so it must be treated as
+     *        read-only. Releasing the message drops its reference.
+     */
+    static constexpr uint16_t SHARED = 0x0008;
+
     /**
      * @brief Construct a new Message object
      */
@@ -32,24 +217,116 @@ public:
      * @param label - message's label
      * @param size - message's size
      * @param data - message's data
+     * @param flags - message's flags (e.g. CHAINED)
      */         
-    Message(Label label, uint16_t size, std::byte *data) : m_data(data), m_label(label), m_size(size) {
+    Message(Label label, uint32_t size, std::byte *data, uint16_t flags = 0)
+        : m_data(data), m_label(label), m_flags(flags), m_size(size) {
     }   
         
     /**
      * @brief Return this message instance's data as a pointer to an object of type T
      *
-     * @tparam T - a POD type
-     * @return T - result of the conversion, or nullptr for a size mismatch or invalid type
+     * @tparam T - a POD type, or for messages carrying an object the object's type
+     * @return T - result of the conversion, or nullptr for a size mismatch or invalid type, or if
+     *             the data is shared with other messages (see SHARED), which must only be read
+     *             through the const overload
      */
     template <typename T>
     T *as() {
-        if (m_data != nullptr && sizeof(T) == m_size && std::is_trivially_copyable<T>()) {
-            return reinterpret_cast<T *>(m_data);
+        if (shared()) {
+            return nullptr;
+        }
+        return const_cast<T *>(static_cast<const Message *>(this)->as<T>());
+    }
+
+    /**
+     * @brief Return this message instance's data as a pointer to a const object of type T
+     *        (e.g. from a ReceiveIf() predicate, or for shared data)
+     */
+    template <typename T>
+    const T *as() const {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (m_data != nullptr && !chained() && !object() && sizeof(T) == m_size) {
+                return reinterpret_cast<const T *>(m_data);
+            }
+        } else if (m_data != nullptr && object()) {
+            const auto *header = reinterpret_cast<const detail::ObjectHeader *>(m_data);
+            if (header->m_type == &detail::TYPE_TAG<T>) {
+                return static_cast<const T *>(header->m_object);
+            }
         }
         return nullptr;
     }
 
+    /**
+     * @brief Return this message instance's data as a read-only view of m_size bytes
+     *
+     * @return ByteSpan - view of the message data, empty in the case of signals, objects and
+     *                    chained messages (see segments())
+     */
+    [[nodiscard]] ByteSpan bytes() const {
+        return ByteSpan(m_data, (m_data != nullptr && !chained() && !object()) ? m_size : 0);
+    }
+
+    /**
+     * @brief Return this message instance's data as a scatter-gather view
+     *
+     * @return SegmentView - one segment per data block, or none in the case of signals
+     */
+    [[nodiscard]] SegmentView segments() const {
+        return SegmentView(m_data, m_size, chained());
+    }
+
+    /**
+     * @brief Copy this message instance's data into a contiguous buffer
+     *
+     * @param dest - destination buffer
+     * @param len - size of the destination buffer
+     * @return size_t - number of bytes copied
+     */
+    size_t copyTo(std::byte *dest, size_t len) const {
+        size_t copied = 0;
+        for (auto segment : segments()) {
+            size_t count = (segment.size() < len - copied) ? segment.size() : len - copied;
+            if (count > 0) {
+                memcpy(dest + copied, segment.data(), count);
+            }
+            copied += count;
+            if (copied == len) {
+                break;
+            }
+        }
+        return copied;
+    }
+
+    /**
+     * @brief Return true if this message's data is a chain of "large" pool blocks
+     */
+    [[nodiscard]] bool chained() const {
+        return (m_flags & CHAINED) != 0;
+    }
+
+    /**
+     * @brief Return true if this message's data is an object constructed in place
+     */
+    [[nodiscard]] bool object() const {
+        return (m_flags & OBJECT) != 0;
+    }
+
+    /**
+     * @brief Return true if this message's data is shared with other messages
+     */
+    [[nodiscard]] bool shared() const {
+        return (m_flags & SHARED) != 0;
+    }
+
+    /**
+     * @brief Return true if this message is a request expecting a reply
+     */
+    [[nodiscard]] bool request() const {
+        return (m_flags & REQUEST) != 0;
+    }
+
     /**
      * @brief Data associated with this Message. This will be nullptr in the case of signals
      */
@@ -60,10 +337,15 @@ public:
      */
     Label m_label = 0;
 
+    /**
+     * @brief Flags describing the Mailbox message data (e.g. CHAINED)
+     */
+    uint16_t m_flags = 0;
+
     /**
      * @brief Size of the Mailbox message data
      */
-    uint16_t m_size = 0;
+    uint32_t m_size = 0;
 };
 
 } // namespace msglib
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 
+#include "Channel.h"
+#include "Dispatcher.h"
 #include "Mailbox.h"
+#include "Options.h"
+#include "SpscMailbox.h"
+#include "ThreadPolicy.h"
 #include "TimerManager.h"
 
 namespace msglib {
@@ -21,6 +26,28 @@ inline bool Initialize(size_t smallSize, size_t smallCap, size_t largeSize, size
     return result;
 }
 
+/**
+ * @brief Initialize timer and mailbox internals with the specified options
+ *
+ * @param options - pool sizes, capacities and placement
+ * @return true - success
+ * @return false - failure
+ */
+inline bool Initialize(const Options &options) {
+    // Mailbox first, so that the timer thread's mailbox honors the memory options
+    auto result = Mailbox::Initialize(options);
+    result &= TimerManager::Initialize(options);
+    return result;
+}
+
+/**
+ * @brief Return how msglib's preallocated memory is currently backed (huge pages, locked,
+ *        NUMA-bound), reflecting any fallbacks taken when the requested Options couldn't be met
+ */
+inline MemoryStats GetMemoryStats() {
+    return detail::GetMemoryStats();
+}
+
 /**
  * @brief Initialize timer and mailbox internals
  * 
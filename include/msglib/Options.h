@@ -0,0 +1,256 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace msglib {
+
+namespace detail {
+
+/**
+ * @brief Default resource pool sizes and capacities
+ */
+static constexpr size_t LARGE_SIZE = 2048;
+static constexpr size_t SMALL_SIZE = 256;
+static constexpr size_t LARGE_CAP = 200;
+static constexpr size_t SMALL_CAP = 200;
+
+/**
+ * @brief Default (and maximum) number of labels
+ */
+static constexpr size_t MAX_LABELS = 65536;
+
+/**
+ * @brief Default maximum number of outstanding timers
+ */
+static constexpr size_t MAX_TIMERS = 65536;
+
+/**
+ * @brief Default maximum number of outstanding Mailbox::Call()s
+ */
+static constexpr size_t MAX_CALLS = 64;
+
+}  // namespace detail
+
+/**
+ * @brief Page size used to back msglib's preallocated memory
+ */
+enum class HugePages {
+    /**
+     * @brief Regular (typically 4 KB) pages
+     */
+    NONE,
+
+    /**
+     * @brief Transparent huge pages requested via madvise(MADV_HUGEPAGE)
+     */
+    TRANSPARENT,
+
+    /**
+     * @brief Explicit 2 MB huge pages via mmap(MAP_HUGETLB), falling back to TRANSPARENT and
+     *        then NONE if no huge pages are reserved
+     */
+    EXPLICIT
+};
+
+/**
+ * @brief PoolGrowth lets the message pools grow beyond their configured capacities, in slabs
+ *        of preallocated blocks, rather than failing sends as soon as they are exhausted
+ */
+struct PoolGrowth {
+    /**
+     * @brief Bytes by which each pool may grow; 0 disables growth
+     */
+    size_t m_budget = 0;
+
+    /**
+     * @brief Size of each slab added, rounded down to a whole number of blocks
+     */
+    size_t m_slabSize = 1024 * 1024;
+
+    /**
+     * @brief A slab is added in the background once fewer than this percentage of a pool's blocks
+     *        are free. If a pool is exhausted before then, a slab is added by the allocating thread.
+     */
+    size_t m_lowWaterPercent = 10;
+
+    /**
+     * @brief An added slab is returned once all of its blocks have been free for this long
+     */
+    std::chrono::milliseconds m_cooldown {5000};
+};
+
+/**
+ * @brief Clock driving the TimerManager's timers
+ */
+enum class TimerClock {
+    /**
+     * @brief POSIX timers, fired by the timer thread as real time passes
+     */
+    REAL,
+
+    /**
+     * @brief Virtual time, which only advances when TimerManager::AdvanceTo(), AdvanceBy() or
+     *        RunUntilIdle() is called; due timers fire synchronously within those calls
+     */
+    VIRTUAL
+};
+
+/**
+ * @brief Scheduling policy for a thread (see ThreadPolicy)
+ */
+enum class SchedPolicy {
+    /**
+     * @brief Leave the thread's scheduling policy and priority as it was created
+     */
+    OTHER,
+
+    /**
+     * @brief SCHED_FIFO real-time scheduling
+     */
+    FIFO,
+
+    /**
+     * @brief SCHED_RR real-time scheduling
+     */
+    RR
+};
+
+/**
+ * @brief ThreadPolicy describes the scheduling and CPU affinity for a thread, applied with
+ *        ApplyThreadPolicy(). Real-time policies need CAP_SYS_NICE (or a sufficient
+ *        RLIMIT_RTPRIO).
+ */
+struct ThreadPolicy {
+    SchedPolicy m_policy = SchedPolicy::OTHER;
+
+    /**
+     * @brief Real-time priority for FIFO and RR (1..99 on Linux)
+     */
+    int m_priority = 0;
+
+    /**
+     * @brief CPUs the thread may run on; empty leaves its affinity as it was created
+     */
+    std::vector<int> m_cpus;
+
+    /**
+     * @brief Return true if the policy changes anything
+     */
+    [[nodiscard]] bool requested() const {
+        return m_policy != SchedPolicy::OTHER || !m_cpus.empty();
+    }
+};
+
+/**
+ * @brief Options controlling how msglib internals are initialized
+ */
+struct Options {
+    /**
+     * @brief Max size of elements in the "small" pool
+     */
+    size_t m_smallSize = detail::SMALL_SIZE;
+
+    /**
+     * @brief Capacity of the "small" pool
+     */
+    size_t m_smallCap = detail::SMALL_CAP;
+
+    /**
+     * @brief Max size of elements in the "large" pool
+     */
+    size_t m_largeSize = detail::LARGE_SIZE;
+
+    /**
+     * @brief Capacity of the "large" pool
+     */
+    size_t m_largeCap = detail::LARGE_CAP;
+
+    /**
+     * @brief Partition the "small" and "large" pools by NUMA node. Each node gets its own pools
+     *        with the capacities above, placed in that node's memory. Senders allocate from the
+     *        pools of the node they are running on, and blocks are freed back to the node which
+     *        owns them.
+     */
+    bool m_numaLocal = false;
+
+    /**
+     * @brief Back the message pools, heap-allocated mailbox queues and timer storage with huge
+     *        pages to avoid TLB misses. Memory blocks smaller than a huge page use regular pages.
+     */
+    HugePages m_hugePages = HugePages::NONE;
+
+    /**
+     * @brief Lock preallocated memory into RAM with mlock() so it can never be paged out.
+     *        Requires a sufficient RLIMIT_MEMLOCK (or CAP_IPC_LOCK).
+     */
+    bool m_lockMemory = false;
+
+    /**
+     * @brief Number of labels which can be registered for or used with timers; labels from 0 to
+     *        m_maxLabels - 1 are valid. Label tables are committed lazily as labels are used.
+     */
+    size_t m_maxLabels = detail::MAX_LABELS;
+
+    /**
+     * @brief Maximum number of timers which can be outstanding at any one time
+     */
+    size_t m_maxTimers = detail::MAX_TIMERS;
+
+    /**
+     * @brief Maximum number of Mailbox::Call()s which can be awaiting a reply at any one time
+     */
+    size_t m_maxCalls = detail::MAX_CALLS;
+
+    /**
+     * @brief Optional growth of the message pools beyond their capacities
+     */
+    PoolGrowth m_poolGrowth;
+
+    /**
+     * @brief Clock driving timers, e.g. TimerClock::VIRTUAL for deterministic simulation
+     */
+    TimerClock m_timerClock = TimerClock::REAL;
+
+    /**
+     * @brief Scheduling and CPU affinity for the timer thread. If anything is requested the thread
+     *        is started by TimerManager::Initialize() (rather than with the first timer), so that
+     *        TimerManager::TimerThreadStatus() reports whether it took effect. It is applied just
+     *        after the thread starts, but before the thread handles any timer expiry.
+     */
+    ThreadPolicy m_timerThread;
+};
+
+/**
+ * @brief MemoryStats reports how msglib's preallocated memory is currently backed, so that the
+ *        effect of Options::m_hugePages, m_lockMemory and m_numaLocal can be verified
+ */
+struct MemoryStats {
+    /**
+     * @brief Total bytes of memory mapped by msglib, including lazily committed tables
+     */
+    size_t m_bytes = 0;
+
+    /**
+     * @brief Bytes backed by explicit (MAP_HUGETLB) huge pages
+     */
+    size_t m_hugeTlbBytes = 0;
+
+    /**
+     * @brief Bytes found to be backed by transparent huge pages (in /proc/self/smaps) once they
+     *        were pre-faulted
+     */
+    size_t m_transparentHugeBytes = 0;
+
+    /**
+     * @brief Bytes locked into RAM
+     */
+    size_t m_lockedBytes = 0;
+
+    /**
+     * @brief Bytes bound to a specific NUMA node
+     */
+    size_t m_numaBoundBytes = 0;
+};
+
+}  // namespace msglib
@@ -0,0 +1,170 @@
+#pragma once
+#include "Mailbox.h"
+#include "Message.h"
+#include "detail/SpscQueue.h"
+#include <chrono>
+#include <initializer_list>
+#include <type_traits>
+
+namespace msglib {
+
+/**
+ * @brief SpscMailbox is a mailbox endpoint bound directly to exactly one producer thread and
+ *        one consumer thread. The producer calls Send()/SendBytes()/SendSignal() on the
+ *        SpscMailbox itself, bypassing label routing and the shared Mailbox lock; messages are
+ *        handed off through a lock-free SPSC ring. Message data still comes from the shared
+ *        "small"/"large" pools, so msglib must be initialized first.
+ *
+ *        Calling any Send method from more than one thread, or Receive from more than one
+ *        thread, is undefined behavior.
+ *
+ * @tparam Capacity - queue capacity, which must be a power of 2
+ */
+template <size_t Capacity = 256>
+class SpscMailbox {
+public:
+    /**
+     * @brief Construct a new SpscMailbox object
+     */
+    SpscMailbox() = default;
+
+    /**
+     * @brief Disable copy construction
+     */
+    SpscMailbox(const SpscMailbox &) = delete;
+
+    /**
+     * @brief Disable move construction
+     */
+    SpscMailbox(SpscMailbox &&) = delete;
+
+    /**
+     * @brief Destroy the SpscMailbox object, releasing any messages which were never received
+     */
+    ~SpscMailbox() {
+        Message msg;
+        while (m_queue.tryPop(msg)) {
+            ReleaseMessage(msg);
+        }
+    }
+
+    /**
+     * @brief Send a message with a specific label and associated data of type T (producer only)
+     *
+     * @tparam T - a POD type
+     * @param label - the message label
+     * @param t - an instance
+     * @return true - message was queued
+     * @return false - message too large, pool exhausted or queue full
+     */
+    template <typename T>
+    bool Send(Label label, const T &t) {
+        static_assert(std::is_trivially_copyable_v<T>, "Send requires trivially copyable types");
+        if (sizeof(T) > MailboxBase::s_mailboxData.largeSize()) {
+            // Typed messages must fit in a single data block
+            return false;
+        }
+        const ByteSpan segment(reinterpret_cast<const std::byte *>(&t), sizeof(T));
+        return sendSegments(label, &segment, 1, sizeof(T));
+    }
+
+    /**
+     * @brief Send a message with a specific label whose data is a runtime-sized range of bytes (producer only)
+     *
+     * @param label - the message label
+     * @param bytes - message data
+     * @return true - message was queued
+     * @return false - pool exhausted or queue full
+     */
+    bool SendBytes(Label label, ByteSpan bytes) {
+        return sendSegments(label, &bytes, 1, bytes.size());
+    }
+
+    /**
+     * @brief Send a message with a specific label whose data is gathered from several ranges
+     *        of bytes (producer only)
+     *
+     * @param label - the message label
+     * @param segments - ranges of bytes making up the message data, in order
+     * @return true - message was queued
+     * @return false - pool exhausted or queue full
+     */
+    bool SendBytes(Label label, std::initializer_list<ByteSpan> segments) {
+        size_t size = 0;
+        for (const auto &segment : segments) {
+            size += segment.size();
+        }
+        return sendSegments(label, segments.begin(), segments.size(), size);
+    }
+
+    /**
+     * @brief Send a signal with a specific label (producer only)
+     *
+     * @param label - signal's label
+     * @return true - signal was queued
+     * @return false - queue full
+     */
+    bool SendSignal(Label label) {
+        return m_queue.tryPush(Message(label));
+    }
+
+    /**
+     * @brief Spin until a signal/message is received (consumer only)
+     *
+     * @param msg - received message; its data is owned by the mailbox until released
+     */
+    void Receive(Message &msg) {
+        m_queue.pop(msg);
+    }
+
+    /**
+     * @brief Receive a signal/message if one is available without waiting (consumer only)
+     *
+     * @param msg - received message; its data is owned by the mailbox until released
+     * @return true - a message was received
+     * @return false - the queue was empty
+     */
+    bool TryReceive(Message &msg) {
+        return m_queue.tryPop(msg);
+    }
+
+    /**
+     * @brief Wait up to a specified duration for a signal/message (consumer only)
+     *
+     * @param msg - received message; its data is owned by the mailbox until released
+     * @param duration - how long to wait
+     * @return true - a message was received
+     * @return false - timed out
+     */
+    template <class Rep, class Period>
+    bool Receive(Message &msg, const std::chrono::duration<Rep, Period> &duration) {
+        return m_queue.popWait(msg, duration);
+    }
+
+    /**
+     * @brief Release the data block(s) associated with a message
+     */
+    void ReleaseMessage(Message &msg) {
+        MailboxBase::s_mailboxData.releaseMessage(msg);
+    }
+
+private:
+    bool sendSegments(Label label, const ByteSpan *segments, size_t count, size_t size) {
+        Message msg;
+        if (!MailboxBase::s_mailboxData.allocateMessage(label, segments, count, size, msg)) {
+            return false;
+        }
+        if (!m_queue.tryPush(msg)) {
+            MailboxBase::s_mailboxData.releaseMessage(msg);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Lock-free queue for this instance of the SpscMailbox class
+     */
+    detail::SpscQueue<Message, Capacity> m_queue;
+};
+
+}  // namespace msglib
@@ -0,0 +1,128 @@
+#pragma once
+#include "Options.h"
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+namespace msglib {
+
+/**
+ * @brief ThreadStatus reports whether a ThreadPolicy took effect, as read back from the thread
+ *        after it was applied
+ */
+struct ThreadStatus {
+    /**
+     * @brief The requested scheduling policy and priority are in effect (or none was requested).
+     *        False if they were restored because the affinity failed.
+     */
+    bool m_scheduling = false;
+
+    /**
+     * @brief The thread's affinity is the requested set of CPUs (or none was requested). False
+     *        if it wasn't attempted because the scheduling policy failed.
+     */
+    bool m_affinity = false;
+
+    /**
+     * @brief Error from the setting which failed (e.g. EPERM without CAP_SYS_NICE, EINVAL for a
+     *        priority out of range or no usable CPU), or 0
+     */
+    int m_error = 0;
+
+    /**
+     * @brief Return true if everything requested took effect
+     */
+    [[nodiscard]] bool ok() const {
+        return m_scheduling && m_affinity;
+    }
+};
+
+namespace detail {
+
+inline int SchedPolicyOf(SchedPolicy policy) {
+    switch (policy) {
+    case SchedPolicy::FIFO:
+        return SCHED_FIFO;
+    case SchedPolicy::RR:
+        return SCHED_RR;
+    case SchedPolicy::OTHER:
+        break;
+    }
+    return SCHED_OTHER;
+}
+
+/**
+ * @brief Build the CPU set for a policy, ignoring CPUs outside CPU_SETSIZE
+ */
+inline cpu_set_t CpuSetOf(const ThreadPolicy &policy) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : policy.m_cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    return cpus;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Apply a scheduling policy and CPU affinity to a thread (e.g. a consumer thread
+ *        receiving from a mailbox), then read them back to verify that they took effect. The
+ *        settings are applied all or nothing: if the scheduling policy fails the affinity isn't
+ *        attempted, and if the affinity fails the thread's original scheduling policy is restored,
+ *        so a failure leaves the thread as it was. Failures are reported rather than thrown.
+ *
+ * @param policy - scheduling and affinity to apply
+ * @param thread - thread to apply them to (default is the calling thread)
+ * @return ThreadStatus - what took effect
+ */
+inline ThreadStatus ApplyThreadPolicy(const ThreadPolicy &policy, pthread_t thread = pthread_self()) {
+    ThreadStatus status;
+    int original = SCHED_OTHER;
+    sched_param originalParam {};
+    const bool scheduling = (policy.m_policy != SchedPolicy::OTHER);
+    if (!scheduling) {
+        status.m_scheduling = true;
+    } else if ((status.m_error = pthread_getschedparam(thread, &original, &originalParam)) == 0) {
+        const int sched = detail::SchedPolicyOf(policy.m_policy);
+        sched_param param {};
+        param.sched_priority = policy.m_priority;
+        const int error = pthread_setschedparam(thread, sched, &param);
+        int actual = SCHED_OTHER;
+        if (error != 0) {
+            status.m_error = error;
+        } else if (pthread_getschedparam(thread, &actual, &param) == 0) {
+            status.m_scheduling = (actual == sched && param.sched_priority == policy.m_priority);
+        }
+    }
+    if (policy.m_cpus.empty()) {
+        status.m_affinity = true;
+    } else if (status.m_scheduling) {
+        cpu_set_t cpus = detail::CpuSetOf(policy);
+        const int error = (CPU_COUNT(&cpus) == 0) ? EINVAL : pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+        cpu_set_t actual;
+        CPU_ZERO(&actual);
+        if (error != 0) {
+            status.m_error = error;
+        } else if (pthread_getaffinity_np(thread, sizeof(actual), &actual) == 0) {
+            status.m_affinity = CPU_EQUAL(&actual, &cpus) != 0;
+        }
+    }
+    if (scheduling && status.m_scheduling && !status.m_affinity) {
+        pthread_setschedparam(thread, original, &originalParam);
+        status.m_scheduling = false;
+    }
+    return status;
+}
+
+/**
+ * @brief Apply a scheduling policy and CPU affinity to a std::thread
+ */
+inline ThreadStatus ApplyThreadPolicy(const ThreadPolicy &policy, std::thread &thread) {
+    return ApplyThreadPolicy(policy, thread.native_handle());
+}
+
+}  // namespace msglib
@@ -14,10 +14,37 @@ enum TimerType_e { PERIODIC, ONE_SHOT };
 #include "detail/TimerManagerData.h"
 #include <chrono>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <type_traits>
 
 namespace msglib {
 
+/**
+ * @brief VirtualClock is the TimerManager's clock when initialized with TimerClock::VIRTUAL. It
+ *        starts at zero and only advances when TimerManager::AdvanceTo(), AdvanceBy() or
+ *        RunUntilIdle() is called. Its time points can be used as absolute timer deadlines.
+ */
+struct VirtualClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<VirtualClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now();
+};
+
+namespace detail {
+
+template <>
+struct ClockTraits<VirtualClock> {
+    static constexpr clockid_t CLOCK_ID = VIRTUAL_CLOCK_ID;
+};
+
+}  // namespace detail
+
 /**
  * @brief TimerManager supports one-shot and recurring timers which result in specific signals being sent
  *        as signals to the mailbox for processing by other thread(s)
@@ -25,6 +52,18 @@ namespace msglib {
 class TimerManager {
 public:
     static bool Initialize() {
+        return Initialize(Options());
+    }
+
+    /**
+     * @brief Initialize timer internals with the specified options
+     *
+     * @param options - options controlling the backing of timer storage, the timer thread and
+     *                  the clock driving timers
+     * @return true - success
+     * @return false - failure
+     */
+    static bool Initialize(const Options &options) {
         sigset_t sigset;
         if (sigemptyset(&sigset) != 0) {
             return false;
@@ -39,7 +78,7 @@ public:
             return false;
         }
 
-        return s_timerData.Initialize();
+        return s_timerData.Initialize(options);
     }
 
     /**
@@ -90,20 +129,72 @@ public:
     }
 
     /**
-     * @brief Start a one-shot timer resulting in the specified label being signalled at a specific time
+     * @brief Start a one-shot or recurring timer which delivers a message carrying a payload rather
+     *        than a signal, so the handler receives its context with the expiry. The payload is
+     *        copied once, into a pool block which is shared (read-only) by the message sent on every
+     *        expiry; it is freed once the timer has been cancelled (or a one-shot timer has fired)
+     *        and each message has been released.
+     *
+     * @tparam T - a POD type
+     * @tparam R - std::chrono::duration representation class
+     * @tparam P - std::chrono::duration period class
+     * @param label - label to use for this timer
+     * @param time - time expressed as a std::chrono::duration
+     * @param payload - data delivered with each expiry, read with the const Message::as<T>()
+     * @param type - type of timer to create (default is one-shot)
+     * @return true - timer started successfully
+     * @return false - timer not started, or the payload doesn't fit in a pool block
+     */
+    template <class T, class R, class P, std::enable_if_t<!std::is_same_v<T, TimerType_e>, int> = 0>
+    static bool StartTimer(const Label &label, const std::chrono::duration<R, P> time, const T &payload,
+        const TimerType_e type = ONE_SHOT) {
+        static_assert(std::is_trivially_copyable_v<T>, "Timer payloads must be trivially copyable");
+        static_assert(sizeof(T) <= UINT32_MAX, "Timer payload type is too large");
+        const timespec ts = detail::Chrono2Timespec(time);
+        return s_timerData.startTimer(
+            label, CLOCK_MONOTONIC, 0, itimerspec {ts, ts}, type, &payload, static_cast<uint32_t>(sizeof(T)));
+    }
+
+    /**
+     * @brief Start a one-shot timer resulting in the specified label being signalled at an absolute
+     *        time. A steady_clock deadline is measured against CLOCK_MONOTONIC; a system_clock
+     *        deadline against CLOCK_REALTIME, so it follows changes to the wall clock. A VirtualClock
+     *        deadline is only valid with TimerClock::VIRTUAL, which supports no other. A deadline
+     *        which has already passed fires immediately.
      *
+     * @tparam C - std::chrono::steady_clock, std::chrono::system_clock or VirtualClock
+     * @tparam D - std::chrono::time_point duration class
      * @param label - label to use for this timer
-     * @param time - time expressed as a std::chrono::time_point
+     * @param time - deadline expressed as a std::chrono::time_point
      * @return true - timer started successfully
      * @return false - timer not started
      */
     template <typename C, typename D>
-    static bool StartTimer(const Label &label, std::chrono::time_point<C, D> &time) {
-        auto secs = std::chrono::time_point_cast<std::chrono::seconds>(time);
-        auto ns = std::chrono::time_point_cast<std::chrono::nanoseconds>(time) -
-            std::chrono::time_point_cast<std::chrono::nanoseconds>(secs);
+    static bool StartTimer(const Label &label, const std::chrono::time_point<C, D> &time) {
+        const itimerspec spec {timespec {0, 0}, detail::TimePoint2Timespec(time)};
+        return s_timerData.startTimer(label, detail::ClockTraits<C>::CLOCK_ID, TIMER_ABSTIME, spec, ONE_SHOT);
+    }
 
-        return s_timerData.startTimer(label, timespec {secs.time_since_epoch().count(), ns.count()}, ONE_SHOT);
+    /**
+     * @brief Start a recurring timer anchored to an absolute phase: the label is signalled at first,
+     *        first + period, first + 2 * period, ... Expiries are computed by the kernel from first
+     *        rather than from when each signal was handled, so the timer doesn't drift.
+     *
+     * @tparam C - std::chrono::steady_clock, std::chrono::system_clock or VirtualClock
+     * @tparam D - std::chrono::time_point duration class
+     * @tparam T - std::chrono::duration representation class
+     * @tparam P - std::chrono::duration period class
+     * @param label - label to use for this timer
+     * @param first - time of the first expiry
+     * @param period - interval between expiries
+     * @return true - timer started successfully
+     * @return false - timer not started
+     */
+    template <typename C, typename D, class T, class P>
+    static bool StartTimer(
+        const Label &label, const std::chrono::time_point<C, D> &first, const std::chrono::duration<T, P> period) {
+        const itimerspec spec {detail::Chrono2Timespec(period), detail::TimePoint2Timespec(first)};
+        return s_timerData.startTimer(label, detail::ClockTraits<C>::CLOCK_ID, TIMER_ABSTIME, spec, PERIODIC);
     }
 
     /**
@@ -117,8 +208,77 @@ public:
         return s_timerData.cancelTimer(label);
     }
 
+    /**
+     * @brief Advance the virtual clock to a time, firing each timer due by then synchronously, in
+     *        deadline order, through the usual SendSignal() path (or that of timer payloads).
+     *        Does nothing unless initialized with TimerClock::VIRTUAL.
+     *
+     *        Expiries are queued to their receivers during the call, so one which the caller's
+     *        own thread drains must be given room: an expiry which finds its queue full is dropped
+     *        and counted by DroppedExpiries(). Passing maxExpiries fires the timers in steps,
+     *        with the receiver drained between calls.
+     *
+     * @param time - virtual time to advance to; the clock never goes backwards
+     * @param maxExpiries - stop after this many expiries, leaving the clock at the last one's
+     *                      deadline so that calling again with the same time continues
+     * @return size_t - number of timer expiries delivered
+     */
+    static size_t AdvanceTo(VirtualClock::time_point time, size_t maxExpiries = std::numeric_limits<size_t>::max()) {
+        return s_timerData.advanceTo(time.time_since_epoch(), maxExpiries);
+    }
+
+    /**
+     * @brief Advance the virtual clock by a duration, as for AdvanceTo()
+     *
+     * @tparam T - std::chrono::duration representation class
+     * @tparam P - std::chrono::duration period class
+     * @param duration - virtual time to advance by
+     * @return size_t - number of timer expiries delivered
+     */
+    template <class T, class P>
+    static size_t AdvanceBy(const std::chrono::duration<T, P> duration) {
+        return AdvanceTo(VirtualClock::now() + std::chrono::duration_cast<VirtualClock::duration>(duration));
+    }
+
+    /**
+     * @brief Advance the virtual clock from deadline to deadline, firing timers as for AdvanceTo(),
+     *        until no one-shot timers are outstanding. Periodic timers fire along the way but
+     *        don't keep the clock running.
+     *
+     * @param maxExpiries - stop after this many expiries; calling again continues
+     * @return size_t - number of timer expiries delivered
+     */
+    static size_t RunUntilIdle(size_t maxExpiries = std::numeric_limits<size_t>::max()) {
+        return s_timerData.runUntilIdle(maxExpiries);
+    }
+
+    /**
+     * @brief Return the number of virtual timer expiries which couldn't be delivered by
+     *        AdvanceTo(), AdvanceBy() or RunUntilIdle() (e.g. because the receiver's queue was
+     *        full)
+     */
+    static size_t DroppedExpiries() {
+        return s_timerData.dropped();
+    }
+
+    /**
+     * @brief Return what took effect of Options::m_timerThread (the timer thread's scheduling
+     *        policy and CPU affinity), as read back when the thread was started
+     *
+     * @return std::optional<msglib::ThreadStatus> - nullopt if the timer thread hasn't been started
+     */
+    static std::optional<msglib::ThreadStatus> TimerThreadStatus() {
+        return s_timerData.threadStatus();
+    }
+
 private:
+    friend struct VirtualClock;
+
     inline static detail::TimerManagerData s_timerData;
 };
 
+inline VirtualClock::time_point VirtualClock::now() {
+    return time_point(TimerManager::s_timerData.now());
+}
+
 }  // namespace msglib
\ No newline at end of file
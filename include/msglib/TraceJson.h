@@ -0,0 +1,234 @@
+#pragma once
+#include "Tracer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace msglib {
+
+namespace detail {
+
+/**
+ * @brief Writes trace events in the Chrome/Perfetto JSON trace format
+ */
+class TraceJsonWriter {
+public:
+    explicit TraceJsonWriter(std::ostream &out) : m_out(out) {
+        m_out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    }
+
+    TraceJsonWriter(const TraceJsonWriter &) = delete;
+    TraceJsonWriter(TraceJsonWriter &&) = delete;
+    TraceJsonWriter &operator=(const TraceJsonWriter &) = delete;
+    TraceJsonWriter &operator=(TraceJsonWriter &&) = delete;
+
+    ~TraceJsonWriter() {
+        m_out << "\n]}\n";
+    }
+
+    void threadName(uint32_t thread) {
+        begin();
+        m_out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\"msglib thread "
+              << thread << "\"}}";
+    }
+
+    /**
+     * @brief Instant event
+     */
+    void instant(const char *name, uint32_t thread, double ns, const TraceRecord &record) {
+        begin();
+        m_out << "{\"name\":\"" << name << ' ' << record.m_label << "\",\"cat\":\"msglib\",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+        micros(ns);
+        m_out << ",\"pid\":1,\"tid\":" << thread;
+        args(record);
+    }
+
+    /**
+     * @brief Complete event (slice) from startNs to endNs
+     */
+    void slice(const char *name, uint32_t thread, double startNs, double endNs, const TraceRecord &record) {
+        begin();
+        m_out << "{\"name\":\"" << name << ' ' << record.m_label << "\",\"cat\":\"msglib\",\"ph\":\"X\",\"ts\":";
+        micros(startNs);
+        m_out << ",\"dur\":";
+        micros(endNs - startNs);
+        m_out << ",\"pid\":1,\"tid\":" << thread;
+        args(record);
+    }
+
+    /**
+     * @brief Start ("s") or finish ("f") of a flow arrow between threads
+     */
+    void flow(bool start, uint64_t id, uint32_t thread, double ns) {
+        begin();
+        m_out << "{\"name\":\"queued\",\"cat\":\"msglib\",\"ph\":\"" << (start ? "s" : "f") << "\",\"id\":" << id << ",\"ts\":";
+        micros(ns);
+        m_out << ",\"pid\":1,\"tid\":" << thread << (start ? "}" : ",\"bp\":\"e\"}");
+    }
+
+private:
+    void begin() {
+        m_out << (m_first ? "\n" : ",\n");
+        m_first = false;
+    }
+
+    void micros(double ns) {
+        // Chrome trace time stamps are in microseconds; keep nanosecond resolution
+        const auto whole = static_cast<int64_t>(ns);
+        const int64_t sign = (whole < 0) ? -1 : 1;
+        const int64_t magnitude = whole * sign;
+        m_out << ((whole < 0) ? "-" : "") << (magnitude / 1000) << '.';
+        const int64_t fraction = magnitude % 1000;
+        m_out << static_cast<char>('0' + (fraction / 100)) << static_cast<char>('0' + ((fraction / 10) % 10))
+              << static_cast<char>('0' + (fraction % 10));
+    }
+
+    void args(const TraceRecord &record) {
+        m_out << ",\"args\":{\"label\":" << record.m_label << ",\"mailbox\":" << record.m_mailbox << "}}";
+    }
+
+    std::ostream &m_out;
+    bool m_first = true;
+};
+
+}  // namespace detail
+
+/**
+ * @brief Convert a trace file written by Tracer::Write() to the Chrome/Perfetto JSON trace
+ *        format, as used by the trace2json tool. Each traced thread becomes a track with:
+ *        - a "send" slice for each send, containing a "lock wait" slice until the shared mailbox
+ *          lock was acquired and an "enqueue" instant for each receiving mailbox
+ *        - a "receive" instant for each message dequeued, joined by a "queued" flow arrow to the
+ *          matching "enqueue" on the sending thread (matched in order per mailbox and label)
+ *        - a "handle" slice from when a message was received until it was released
+ *
+ * @param in - trace file contents
+ * @param out - JSON output
+ * @return false - not a valid trace file
+ */
+inline bool TraceToJson(std::istream &in, std::ostream &out) {
+    TraceFileHeader header {};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.m_magic, TraceFileHeader::MAGIC, sizeof(header.m_magic)) != 0 ||
+        header.m_version != TraceFileHeader::VERSION) {
+        return false;
+    }
+
+    struct Event {
+        TraceRecord m_record;
+        uint32_t m_thread;
+    };
+    std::vector<Event> events;
+    std::vector<uint32_t> threads;
+    for (uint32_t i = 0; i < header.m_threads; i++) {
+        TraceThreadHeader thread {};
+        if (!in.read(reinterpret_cast<char *>(&thread), sizeof(thread))) {
+            return false;
+        }
+        threads.push_back(thread.m_thread);
+        for (uint64_t j = 0; j < thread.m_count; j++) {
+            Event event {};
+            if (!in.read(reinterpret_cast<char *>(&event.m_record), sizeof(TraceRecord))) {
+                return false;
+            }
+            event.m_thread = thread.m_thread;
+            events.push_back(event);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+        [](const Event &a, const Event &b) { return a.m_record.m_timestamp < b.m_record.m_timestamp; });
+
+    // Time stamp ticks per nanosecond, from the samples taken by Enable() and Write()
+    const double ticks = static_cast<double>(header.m_endTimestamp - header.m_startTimestamp);
+    const double nanos = static_cast<double>(header.m_endNs - header.m_startNs);
+    const double scale = (ticks > 0 && nanos > 0) ? (nanos / ticks) : 1.0;
+    auto toNs = [&header, scale](const TraceRecord &record) {
+        return (static_cast<double>(record.m_timestamp) - static_cast<double>(header.m_startTimestamp)) * scale;
+    };
+
+    /**
+     * @brief Events awaiting their matching end event on each thread
+     */
+    struct Open {
+        bool m_send = false;
+        TraceRecord m_sendBegin {};
+        bool m_locked = false;
+        TraceRecord m_sendLocked {};
+        bool m_receive = false;
+        TraceRecord m_received {};
+    };
+    std::map<uint32_t, Open> open;
+
+    // Enqueue and receive times and threads per (mailbox, label), in order
+    using Points = std::vector<std::pair<double, uint32_t>>;
+    std::map<std::pair<uint32_t, Label>, std::pair<Points, Points>> queued;
+
+    detail::TraceJsonWriter writer(out);
+    for (auto thread : threads) {
+        writer.threadName(thread);
+    }
+    for (const auto &event : events) {
+        const TraceRecord &record = event.m_record;
+        Open &state = open[event.m_thread];
+        const double ns = toNs(record);
+        switch (record.m_event) {
+        case TraceEvent::SEND_BEGIN:
+            state.m_send = true;
+            state.m_sendBegin = record;
+            state.m_locked = false;
+            break;
+        case TraceEvent::SEND_LOCKED:
+            state.m_locked = state.m_send;
+            state.m_sendLocked = record;
+            break;
+        case TraceEvent::ENQUEUE:
+            writer.instant("enqueue", event.m_thread, ns, record);
+            queued[{record.m_mailbox, record.m_label}].first.emplace_back(ns, event.m_thread);
+            break;
+        case TraceEvent::SEND_END:
+            if (state.m_send && state.m_sendBegin.m_label == record.m_label) {
+                writer.slice("send", event.m_thread, toNs(state.m_sendBegin), ns, state.m_sendBegin);
+                if (state.m_locked) {
+                    writer.slice("lock wait", event.m_thread, toNs(state.m_sendBegin), toNs(state.m_sendLocked), state.m_sendBegin);
+                }
+            }
+            state.m_send = false;
+            state.m_locked = false;
+            break;
+        case TraceEvent::RECEIVE:
+            writer.instant("receive", event.m_thread, ns, record);
+            queued[{record.m_mailbox, record.m_label}].second.emplace_back(ns, event.m_thread);
+            state.m_receive = true;
+            state.m_received = record;
+            break;
+        case TraceEvent::RELEASE:
+            if (state.m_receive && state.m_received.m_label == record.m_label && state.m_received.m_mailbox == record.m_mailbox) {
+                writer.slice("handle", event.m_thread, toNs(state.m_received), ns, record);
+                state.m_receive = false;
+            } else {
+                writer.instant("release", event.m_thread, ns, record);
+            }
+            break;
+        }
+    }
+
+    // A receiver may dequeue a message before its sender records the enqueue, so pair them by
+    // position rather than time
+    uint64_t flow = 1;
+    for (const auto &entry : queued) {
+        const Points &enqueues = entry.second.first;
+        const Points &receives = entry.second.second;
+        for (size_t i = 0; i < enqueues.size() && i < receives.size(); i++, flow++) {
+            writer.flow(true, flow, enqueues[i].second, enqueues[i].first);
+            writer.flow(false, flow, receives[i].second, receives[i].first);
+        }
+    }
+    return true;
+}
+
+}  // namespace msglib
@@ -0,0 +1,383 @@
+#pragma once
+#include "Options.h"
+#include "detail/Arena.h"
+#include "detail/SpscQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace msglib {
+
+using Label = uint16_t;
+
+/**
+ * @brief Point in a message's flow recorded by the Tracer
+ */
+enum class TraceEvent : uint8_t {
+    /**
+     * @brief A send (or signal) was started, before taking the shared mailbox lock
+     */
+    SEND_BEGIN,
+
+    /**
+     * @brief The sender acquired the shared mailbox lock
+     */
+    SEND_LOCKED,
+
+    /**
+     * @brief A message was allocated and queued for a receiving mailbox
+     */
+    ENQUEUE,
+
+    /**
+     * @brief The send finished and released the shared mailbox lock
+     */
+    SEND_END,
+
+    /**
+     * @brief A message was dequeued by its receiver
+     */
+    RECEIVE,
+
+    /**
+     * @brief A message's data was released back to the pools, normally once it has been handled
+     */
+    RELEASE
+};
+
+/**
+ * @brief Fixed-size binary trace record
+ */
+struct TraceRecord {
+    /**
+     * @brief Time stamp counter (or, where there is none, steady clock nanoseconds)
+     */
+    uint64_t m_timestamp;
+
+    /**
+     * @brief Mailbox ID (see MailboxBase::TraceId()): the sender's for SEND_* events, otherwise
+     *        the receiver's
+     */
+    uint32_t m_mailbox;
+
+    Label m_label;
+    TraceEvent m_event;
+    uint8_t m_reserved;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord should be 16 bytes");
+
+/**
+ * @brief Header of a trace file written by Tracer::Write(). Time stamps are converted to
+ *        nanoseconds using the two (time stamp, steady clock) pairs sampled by Enable() and Write().
+ *        The header is followed, for each thread which recorded events, by a TraceThreadHeader and
+ *        that thread's records, oldest first.
+ */
+struct TraceFileHeader {
+    static constexpr char MAGIC[8] = {'M', 'S', 'G', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr uint32_t VERSION = 1;
+
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_threads;
+    uint64_t m_startTimestamp;
+    uint64_t m_startNs;
+    uint64_t m_endTimestamp;
+    uint64_t m_endNs;
+};
+
+/**
+ * @brief Per-thread section header in a trace file
+ */
+struct TraceThreadHeader {
+    /**
+     * @brief Index of the thread, in the order threads first recorded an event
+     */
+    uint32_t m_thread;
+
+    /**
+     * @brief Records overwritten because the thread's ring was full
+     */
+    uint32_t m_overwritten;
+
+    /**
+     * @brief Number of records which follow
+     */
+    uint64_t m_count;
+};
+
+namespace detail {
+
+/**
+ * @brief A thread's ring of trace records
+ */
+struct alignas(CACHE_LINE_SIZE) TraceRing {
+    /**
+     * @brief Number of records ever written; only the owning thread writes it
+     */
+    std::atomic<uint64_t> m_head {0};
+
+    TraceRecord *m_records = nullptr;
+};
+
+/**
+ * @brief Tracer state shared by all threads
+ */
+struct TraceData {
+    std::atomic<bool> m_enabled {false};
+
+    /**
+     * @brief Serializes Enable()
+     */
+    std::mutex m_mutex;
+    std::atomic<size_t> m_nextRing {0};
+    size_t m_maxThreads = 0;
+    size_t m_capacity = 0;
+    TraceRing *m_rings = nullptr;
+    uint64_t m_startTimestamp = 0;
+    uint64_t m_startNs = 0;
+    std::unique_ptr<Arena> m_arena;
+};
+
+}  // namespace detail
+
+/**
+ * @brief Tracer records message flow events (see TraceEvent) into a fixed-size ring buffer per
+ *        thread, so that the time spent waiting for the shared mailbox lock, allocating, queued and
+ *        being handled can be seen for each hop. Tracing is off until Enable() is called; while it
+ *        is off each trace point costs an acquire load (a plain load on x86) and a branch.
+ *        Recording is lock-free: each thread only writes its own ring, and a full ring overwrites
+ *        its oldest records. Recording an event costs a read of the time stamp counter plus a few
+ *        nanoseconds, so it exceeds 20 ns wherever reading the counter itself takes more than
+ *        about 17 ns (e.g. about 26 ns per event where rdtsc takes 25 ns).
+ *
+ *        Write() saves the rings to a binary file which the trace2json tool (see tools/) converts
+ *        to the Chrome/Perfetto JSON trace format.
+ */
+class Tracer {
+public:
+    /**
+     * @brief Default maximum number of threads which can record events
+     */
+    static constexpr size_t MAX_THREADS = 64;
+
+    /**
+     * @brief Default number of records per thread, rounded up to a power of 2
+     */
+    static constexpr size_t RECORDS_PER_THREAD = 65536;
+
+    /**
+     * @brief Start recording. The first call allocates the ring buffers; threads beyond the first
+     *        maxThreads to record an event aren't traced. Later calls resume recording into the
+     *        same rings (e.g. after Disable()) and ignore the sizes.
+     *
+     * @param maxThreads - maximum number of threads which can record events
+     * @param recordsPerThread - capacity of each thread's ring
+     * @return false - already enabled
+     */
+    static bool Enable(size_t maxThreads = MAX_THREADS, size_t recordsPerThread = RECORDS_PER_THREAD) {
+        auto &data = s_data;
+        std::lock_guard<std::mutex> guard(data.m_mutex);
+        if (data.m_enabled.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (data.m_rings == nullptr) {
+            size_t capacity = 1;
+            while (capacity < recordsPerThread) {
+                capacity <<= 1U;
+            }
+            data.m_capacity = capacity;
+            data.m_maxThreads = maxThreads;
+            data.m_arena = std::make_unique<detail::Arena>(
+                maxThreads * (sizeof(detail::TraceRing) + (capacity * sizeof(TraceRecord))), detail::DefaultArenaConfig());
+            auto *rings = reinterpret_cast<detail::TraceRing *>(data.m_arena->data());
+            auto *records = reinterpret_cast<TraceRecord *>(rings + maxThreads);
+            for (size_t i = 0; i < maxThreads; i++) {
+                new (&rings[i]) detail::TraceRing {};
+                rings[i].m_records = records + (i * capacity);
+            }
+            data.m_rings = rings;
+            data.m_startTimestamp = Timestamp();
+            data.m_startNs = steadyNs();
+        }
+        data.m_enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Stop recording. The rings are kept, so that they can still be written.
+     */
+    static void Disable() {
+        s_data.m_enabled.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Return true while events are being recorded
+     */
+    static bool Enabled() {
+        return s_data.m_enabled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Record an event for the calling thread, if tracing is enabled
+     *
+     * @param event - the event
+     * @param label - the message label
+     * @param mailbox - mailbox ID (see MailboxBase::TraceId())
+     */
+    static void Record(TraceEvent event, Label label, uint32_t mailbox) {
+        // Acquire pairs with the release in Enable(), so that the rings it set up are visible
+        // (a plain load on x86)
+        if (s_data.m_enabled.load(std::memory_order_acquire)) {
+            record(event, label, mailbox);
+        }
+    }
+
+    /**
+     * @brief Return the current time stamp: the CPU's time stamp counter where available
+     */
+    static uint64_t Timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return steadyNs();
+#endif
+    }
+
+    /**
+     * @brief Write the recorded events to a trace file. Each thread's ring is read while it may
+     *        still be recording, so call Disable() first for a consistent snapshot.
+     *
+     * @param path - file to be written
+     * @return false - tracing was never enabled, or the file couldn't be written
+     */
+    static bool Write(const char *path) {
+        auto &data = s_data;
+        if (data.m_rings == nullptr) {
+            return false;
+        }
+        std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path, "wb"), &std::fclose);
+        if (!file) {
+            return false;
+        }
+        const auto threads = static_cast<uint32_t>(std::min(data.m_nextRing.load(), data.m_maxThreads));
+        TraceFileHeader header {};
+        std::copy(std::begin(TraceFileHeader::MAGIC), std::end(TraceFileHeader::MAGIC), header.m_magic);
+        header.m_version = TraceFileHeader::VERSION;
+        header.m_threads = threads;
+        header.m_startTimestamp = data.m_startTimestamp;
+        header.m_startNs = data.m_startNs;
+        header.m_endTimestamp = Timestamp();
+        header.m_endNs = steadyNs();
+        bool ok = std::fwrite(&header, sizeof(header), 1, file.get()) == 1;
+
+        const size_t mask = data.m_capacity - 1;
+        for (uint32_t i = 0; i < threads && ok; i++) {
+            const detail::TraceRing &ring = data.m_rings[i];
+            const uint64_t head = ring.m_head.load(std::memory_order_acquire);
+            const uint64_t count = std::min<uint64_t>(head, data.m_capacity);
+            const TraceThreadHeader thread {i, static_cast<uint32_t>(std::min<uint64_t>(head - count, UINT32_MAX)), count};
+            ok = std::fwrite(&thread, sizeof(thread), 1, file.get()) == 1;
+            // Oldest records first, in up to two pieces if the ring has wrapped
+            const size_t first = static_cast<size_t>(head - count) & mask;
+            const size_t firstCount = std::min<size_t>(static_cast<size_t>(count), data.m_capacity - first);
+            ok = ok && std::fwrite(ring.m_records + first, sizeof(TraceRecord), firstCount, file.get()) == firstCount;
+            const size_t rest = static_cast<size_t>(count) - firstCount;
+            ok = ok && std::fwrite(ring.m_records, sizeof(TraceRecord), rest, file.get()) == rest;
+        }
+        return ok && std::fflush(file.get()) == 0;
+    }
+
+private:
+    inline static detail::TraceData s_data;
+
+    /**
+     * @brief The calling thread's ring, claimed when it first records an event
+     */
+    inline static thread_local detail::TraceRing *t_ring = nullptr;
+
+    /**
+     * @brief Set once a thread has found every ring already claimed
+     */
+    inline static thread_local bool t_untraced = false;
+
+    static uint64_t steadyNs() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void record(TraceEvent event, Label label, uint32_t mailbox) {
+        detail::TraceRing *ring = t_ring;
+        if (ring == nullptr) {
+            ring = claim();
+            if (ring == nullptr) {
+                return;
+            }
+        }
+        // Written field by field in place rather than copied from a temporary (m_reserved is left
+        // as the Arena's zero fill)
+        const uint64_t head = ring->m_head.load(std::memory_order_relaxed);
+        TraceRecord &record = ring->m_records[head & (s_data.m_capacity - 1)];
+        record.m_timestamp = Timestamp();
+        record.m_mailbox = mailbox;
+        record.m_label = label;
+        record.m_event = event;
+        ring->m_head.store(head + 1, std::memory_order_release);
+    }
+
+    static detail::TraceRing *claim() {
+        if (t_untraced) {
+            return nullptr;
+        }
+        const size_t index = s_data.m_nextRing.fetch_add(1);
+        if (index >= s_data.m_maxThreads) {
+            t_untraced = true;
+            return nullptr;
+        }
+        t_ring = &s_data.m_rings[index];
+        return t_ring;
+    }
+};
+
+namespace detail {
+
+/**
+ * @brief Records SEND_BEGIN on construction, SEND_LOCKED when locked() is called and SEND_END on
+ *        destruction
+ */
+class TraceSend {
+public:
+    TraceSend(Label label, uint32_t mailbox) : m_label(label), m_mailbox(mailbox) {
+        Tracer::Record(TraceEvent::SEND_BEGIN, m_label, m_mailbox);
+    }
+
+    TraceSend(const TraceSend &) = delete;
+    TraceSend(TraceSend &&) = delete;
+    TraceSend &operator=(const TraceSend &) = delete;
+    TraceSend &operator=(TraceSend &&) = delete;
+
+    ~TraceSend() {
+        Tracer::Record(TraceEvent::SEND_END, m_label, m_mailbox);
+    }
+
+    void locked() const {
+        Tracer::Record(TraceEvent::SEND_LOCKED, m_label, m_mailbox);
+    }
+
+private:
+    Label m_label;
+    uint32_t m_mailbox;
+};
+
+}  // namespace detail
+
+}  // namespace msglib
@@ -0,0 +1,343 @@
+#pragma once
+
+#include "Mailbox.h"
+#include "detail/MpmcQueue.h"
+#include "detail/WorkStealingDeque.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace msglib {
+
+class ActorMailbox;
+
+/**
+ * @brief WorkStealingExecutor runs the handlers of ActorMailboxes on a fixed pool of threads,
+ *        instead of each mailbox having its own thread blocked in Receive(). A mailbox becomes
+ *        runnable when a message arrives while it is idle. Each worker thread has a deque of
+ *        runnable mailboxes; mailboxes made runnable by a handler are pushed onto the worker's
+ *        own deque, others onto a shared queue, and idle workers steal from busy ones.
+ */
+class WorkStealingExecutor {
+public:
+    /**
+     * @brief Default maximum number of ActorMailboxes
+     */
+    static constexpr size_t CAPACITY = 1024;
+
+    /**
+     * @brief Construct a new WorkStealingExecutor object and start its threads
+     *
+     * @param threads - number of worker threads
+     * @param capacity - maximum number of ActorMailboxes using this executor
+     */
+    explicit WorkStealingExecutor(size_t threads, size_t capacity = CAPACITY)
+        : m_capacity(capacity), m_injected(capacity, std::pmr::new_delete_resource()) {
+        m_workers.reserve(threads);
+        for (size_t i = 0; i < threads; i++) {
+            m_workers.push_back(std::make_unique<Worker>(*this, i, capacity));
+        }
+        m_threads.reserve(threads);
+        for (size_t i = 0; i < threads; i++) {
+            m_threads.emplace_back([this, i]() { runWorker(*m_workers[i]); });
+        }
+    }
+
+    WorkStealingExecutor(const WorkStealingExecutor &) = delete;
+    WorkStealingExecutor(WorkStealingExecutor &&) = delete;
+    WorkStealingExecutor &operator=(const WorkStealingExecutor &) = delete;
+    WorkStealingExecutor &operator=(WorkStealingExecutor &&) = delete;
+
+    /**
+     * @brief Stop and join the worker threads. ActorMailboxes should be destroyed first.
+     */
+    ~WorkStealingExecutor() {
+        Stop();
+    }
+
+    /**
+     * @brief Stop running handlers and join the worker threads. Messages still queued are
+     *        released when their ActorMailbox is destroyed.
+     */
+    void Stop() {
+        m_stop = true;
+        m_wait.notifyAll();
+        for (auto &thread : m_threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        m_stopped = true;
+    }
+
+    /**
+     * @brief Return true once Stop() has joined the worker threads
+     */
+    [[nodiscard]] bool Stopped() const {
+        return m_stopped.load();
+    }
+
+private:
+    friend class ActorMailbox;
+
+    /**
+     * @brief A worker thread's deque of runnable mailboxes
+     */
+    struct Worker {
+        Worker(WorkStealingExecutor &executor, size_t index, size_t capacity)
+            : m_executor(executor), m_index(index), m_deque(capacity) {
+        }
+
+        WorkStealingExecutor &m_executor;
+        size_t m_index;
+        detail::WorkStealingDeque<ActorMailbox *> m_deque;
+    };
+
+    /**
+     * @brief Worker running on the current thread, if any
+     */
+    inline static thread_local Worker *t_worker = nullptr;
+
+    /**
+     * @brief Reserve capacity for a new ActorMailbox
+     */
+    bool attach() {
+        if (m_attached.fetch_add(1) >= m_capacity) {
+            m_attached--;
+            return false;
+        }
+        return true;
+    }
+
+    void detach() {
+        m_attached--;
+    }
+
+    /**
+     * @brief Queue a mailbox which has become runnable. Each mailbox is queued at most once at a
+     *        time, and there are at most m_capacity of them, so there is always room.
+     */
+    void schedule(ActorMailbox *mailbox) {
+        Worker *worker = t_worker;
+        if (worker == nullptr || &worker->m_executor != this || !worker->m_deque.push(mailbox)) {
+            m_injected.tryPush(mailbox);
+        }
+        m_wait.notify();
+    }
+
+    /**
+     * @brief Find a runnable mailbox: from the worker's own deque, then the shared queue, then
+     *        by stealing from other workers
+     */
+    bool findWork(Worker &worker, ActorMailbox *&mailbox) {
+        if (worker.m_deque.pop(mailbox) || m_injected.tryPop(mailbox)) {
+            return true;
+        }
+        const size_t count = m_workers.size();
+        for (size_t i = 1; i < count; i++) {
+            if (m_workers[(worker.m_index + i) % count]->m_deque.steal(mailbox)) {
+                return true;
+            }
+        }
+        mailbox = nullptr;
+        return false;
+    }
+
+    void runWorker(Worker &worker);
+
+    size_t m_capacity;
+    std::atomic<size_t> m_attached {0};
+    std::atomic<bool> m_stop {false};
+    std::atomic<bool> m_stopped {false};
+
+    /**
+     * @brief Mailboxes made runnable by threads other than the workers
+     */
+    detail::MpmcQueue<ActorMailbox *> m_injected;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    /**
+     * @brief Waiting strategy for idle workers
+     */
+    BlockingWait m_wait;
+};
+
+/**
+ * @brief ActorMailbox is a mailbox whose messages are passed to a handler run by a
+ *        WorkStealingExecutor. The handler is never run concurrently with itself, and sees
+ *        messages in the order they were queued. Each message is released after the handler
+ *        returns, unless the handler has already released it (e.g. with Dispatcher::Dispatch()).
+ *
+ *        Unregister the mailbox's labels before destroying it; the destructor waits for any
+ *        queued messages to be handled while the executor is running.
+ */
+class ActorMailbox : public MailboxBase {
+public:
+    /**
+     * @brief Handler called for each received message
+     */
+    using Handler = std::function<void(ActorMailbox &, Message &)>;
+
+    /**
+     * @brief Default queue capacity
+     */
+    static constexpr size_t QUEUE_SIZE = 256;
+
+    /**
+     * @brief Maximum number of messages handled each time the mailbox runs, before it yields to
+     *        other runnable mailboxes
+     */
+    static constexpr size_t BATCH_SIZE = 64;
+
+    /**
+     * @brief Construct a new ActorMailbox object
+     *
+     * @param executor - executor to run the handler
+     * @param handler - handler for received messages
+     * @param queueSize - queue capacity
+     * @throw std::runtime_error - the executor's capacity has been reached
+     */
+    ActorMailbox(WorkStealingExecutor &executor, Handler handler, size_t queueSize = QUEUE_SIZE)
+        : m_executor(executor)
+        , m_handler(std::move(handler))
+        , m_storage(queueSize)
+        , m_bytes(m_storage.data(), m_storage.size())
+        , m_queue(queueSize, &m_bytes) {
+        if (!m_executor.attach()) {
+            throw std::runtime_error("WorkStealingExecutor capacity reached");
+        }
+    }
+
+    ActorMailbox(const ActorMailbox &) = delete;
+    ActorMailbox(ActorMailbox &&) = delete;
+    ActorMailbox &operator=(const ActorMailbox &) = delete;
+    ActorMailbox &operator=(ActorMailbox &&) = delete;
+
+    ~ActorMailbox() override {
+        while ((m_scheduled.load() || m_running.load()) && !m_executor.Stopped()) {
+            std::this_thread::yield();
+        }
+        Message msg;
+        while (m_queue.tryPop(msg)) {
+            ReleaseMessage(msg);
+        }
+        m_executor.detach();
+    }
+
+    /**
+     * @brief Return the number of queued messages
+     */
+    [[nodiscard]] size_t Pending() const {
+        return m_queue.size();
+    }
+
+protected:
+    bool deliver(const Message &msg) override {
+        if (!m_queue.tryPush(msg)) {
+            return false;
+        }
+        Tracer::Record(TraceEvent::ENQUEUE, msg.m_label, TraceId());
+        // Pairs with the fence in run() so that either run() sees the message or this sees the
+        // mailbox is idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_scheduled.exchange(true, std::memory_order_acq_rel)) {
+            m_executor.schedule(this);
+        }
+        return true;
+    }
+
+private:
+    friend class WorkStealingExecutor;
+
+    /**
+     * @brief Handle up to BATCH_SIZE messages
+     *
+     * @return true - messages remain, and the mailbox is still scheduled
+     * @return false - the mailbox is idle (or has been scheduled again by a sender)
+     */
+    bool run() {
+        m_running.store(true, std::memory_order_relaxed);
+        const bool more = handleBatch();
+        // The last access by this worker once the mailbox is idle, which the destructor waits for
+        m_running.store(false, std::memory_order_release);
+        return more;
+    }
+
+    bool handleBatch() {
+        Message msg;
+        for (size_t i = 0; i < BATCH_SIZE; i++) {
+            if (!m_queue.tryPop(msg)) {
+                m_scheduled.store(false, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // Reclaim the mailbox if a message arrived before it was marked idle
+                if (m_queue.empty() || m_scheduled.exchange(true, std::memory_order_acq_rel)) {
+                    return false;
+                }
+                continue;
+            }
+            Tracer::Record(TraceEvent::RECEIVE, msg.m_label, TraceId());
+            m_handler(*this, msg);
+            if (msg.m_data != nullptr) {
+                ReleaseMessage(msg);
+            }
+        }
+        return true;
+    }
+
+    WorkStealingExecutor &m_executor;
+    Handler m_handler;
+
+    using QueueType = detail::MpmcQueue<Message>;
+
+    /**
+     * @brief Underlying data for the queue's monotonic buffer resource
+     */
+    HeapStorage::Buffer<sizeof(QueueType::Slot)> m_storage;
+
+    /**
+     * @brief Monotonic buffer resource supporting this instance's queue
+     */
+    std::pmr::monotonic_buffer_resource m_bytes;
+
+    /**
+     * @brief Queue for this instance
+     */
+    QueueType m_queue;
+
+    /**
+     * @brief True while the mailbox is queued to run or running, so that only one worker runs it
+     */
+    std::atomic<bool> m_scheduled {false};
+
+    /**
+     * @brief True while a worker is running the mailbox
+     */
+    std::atomic<bool> m_running {false};
+};
+
+inline void WorkStealingExecutor::runWorker(Worker &worker) {
+    t_worker = &worker;
+    while (true) {
+        ActorMailbox *mailbox = nullptr;
+        m_wait.wait([this, &worker, &mailbox]() { return findWork(worker, mailbox) || m_stop.load(); });
+        if (mailbox == nullptr) {
+            break;
+        }
+        if (mailbox->run()) {
+            // More messages remain; go to the back of the shared queue so others get a turn
+            m_injected.tryPush(mailbox);
+            m_wait.notify();
+        }
+    }
+    t_worker = nullptr;
+}
+
+}  // namespace msglib
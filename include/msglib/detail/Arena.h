@@ -0,0 +1,395 @@
+#pragma once
+#include "Numa.h"
+#include "msglib/Options.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace msglib::detail {
+
+/**
+ * @brief Size of the huge pages used for Arenas
+ */
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * @brief ArenaConfig describes how an Arena's memory should be obtained
+ */
+struct ArenaConfig {
+    /**
+     * @brief Flag value for an Arena with no NUMA node preference
+     */
+    static constexpr size_t NO_NODE = static_cast<size_t>(-1);
+
+    /**
+     * @brief NUMA node on which to place the pages, or NO_NODE
+     */
+    size_t m_node = NO_NODE;
+
+    /**
+     * @brief Requested page size
+     */
+    HugePages m_hugePages = HugePages::NONE;
+
+    /**
+     * @brief Lock the pages into RAM
+     */
+    bool m_lock = false;
+
+    /**
+     * @brief Touch every page at construction. Otherwise pages are committed on first use.
+     */
+    bool m_prefault = true;
+
+    /**
+     * @brief Return the ArenaConfig requested by a set of Options for a given NUMA node
+     */
+    static ArenaConfig FromOptions(const Options &options, size_t node = NO_NODE) {
+        return ArenaConfig {node, options.m_hugePages, options.m_lockMemory, true};
+    }
+};
+
+/**
+ * @brief Running totals describing all Arenas currently in existence
+ */
+struct ArenaTotals {
+    std::atomic<size_t> m_bytes {0};
+    std::atomic<size_t> m_hugeTlbBytes {0};
+    std::atomic<size_t> m_transparentHugeBytes {0};
+    std::atomic<size_t> m_lockedBytes {0};
+    std::atomic<size_t> m_numaBoundBytes {0};
+};
+
+/**
+ * @brief Return the process-wide Arena totals
+ */
+inline ArenaTotals &GetArenaTotals() {
+    static ArenaTotals totals;
+    return totals;
+}
+
+/**
+ * @brief DefaultArena holds the ArenaConfig used for memory allocated after initialization by
+ *        other components (e.g. mailbox queue storage and trace rings)
+ */
+struct DefaultArena {
+    std::mutex m_mutex;
+    ArenaConfig m_config;
+};
+
+inline DefaultArena &GetDefaultArena() {
+    static DefaultArena arena;
+    return arena;
+}
+
+/**
+ * @brief Return a copy of the default ArenaConfig, which may be read on any thread while
+ *        Mailbox::Initialize() is setting it
+ */
+inline ArenaConfig DefaultArenaConfig() {
+    auto &arena = GetDefaultArena();
+    std::lock_guard<std::mutex> guard(arena.m_mutex);
+    return arena.m_config;
+}
+
+/**
+ * @brief Set the default ArenaConfig. Called once, by Mailbox::Initialize().
+ */
+inline void SetDefaultArenaConfig(const ArenaConfig &config) {
+    auto &arena = GetDefaultArena();
+    std::lock_guard<std::mutex> guard(arena.m_mutex);
+    arena.m_config = config;
+}
+
+/**
+ * @brief Return how many bytes of a range are backed by transparent huge pages, according to
+ *        the AnonHugePages of the mappings overlapping it in /proc/self/smaps
+ *
+ * @param data - start of the range
+ * @param size - length of the range
+ * @return size_t - bytes backed by huge pages, or 0 if smaps can't be read
+ */
+inline size_t TransparentHugeBytes(const std::byte *data, size_t size) {
+    FILE *fp = fopen("/proc/self/smaps", "r");
+    if (fp == nullptr) {
+        return 0;
+    }
+    const auto first = reinterpret_cast<uintptr_t>(data);
+    const uintptr_t last = first + size;
+    size_t overlap = 0;
+    size_t total = 0;
+    char line[4096] = {};  // NOLINT
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        // Each mapping starts with a "start-end perms ..." line, followed by its fields
+        unsigned long start = 0;  // NOLINT
+        unsigned long end = 0;  // NOLINT
+        unsigned long kb = 0;  // NOLINT
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            const uintptr_t from = (start > first) ? start : first;
+            const uintptr_t to = (end < last) ? end : last;
+            overlap = (from < to) ? (to - from) : 0;
+        } else if (overlap > 0 && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            // A mapping merged with a neighbour may report huge pages outside the range
+            total += ((kb * 1024) < overlap) ? (kb * 1024) : overlap;
+            overlap = 0;
+        }
+    }
+    fclose(fp);
+    return total;
+}
+
+/**
+ * @brief Arena is a page-aligned block of memory obtained directly from the kernel at
+ *        initialization time. Depending on its ArenaConfig it is backed by huge pages, placed on
+ *        a specific NUMA node and/or locked into RAM; each of these is best-effort, and the
+ *        Arena records what was actually obtained. Unless the configuration disables it, every
+ *        page is touched when the Arena is constructed so that no page faults occur on the hot
+ *        path.
+ */
+class Arena {
+public:
+    /**
+     * @brief Flag value for an Arena with no NUMA node preference
+     */
+    static constexpr size_t NO_NODE = ArenaConfig::NO_NODE;
+
+    /**
+     * @brief Construct a new Arena object
+     *
+     * @param size - minimum size in bytes (rounded up to a whole number of pages)
+     * @param config - page size, NUMA node and locking requested for the Arena
+     * @throw std::bad_alloc - memory couldn't be mapped
+     */
+    Arena(size_t size, const ArenaConfig &config) : m_node(config.m_node) {
+        // Huge pages are only worthwhile when the Arena fills at least one
+        const bool huge = (config.m_hugePages != HugePages::NONE) && (size >= HUGE_PAGE_SIZE);
+        if (huge && config.m_hugePages == HugePages::EXPLICIT) {
+            mapHugeTlb(size);
+        }
+        if (m_data == nullptr && huge) {
+            mapTransparentHuge(size);
+        }
+        if (m_data == nullptr) {
+            mapRegular(size);
+        }
+        if (m_node != NO_NODE) {
+            m_bound = BindToNumaNode(m_data, m_size, m_node);
+        }
+        if (config.m_prefault) {
+            prefault();
+        }
+        if (config.m_lock) {
+            m_locked = (mlock(m_data, m_size) == 0);
+        }
+        if (m_hugePages == HugePages::TRANSPARENT) {
+            // MADV_HUGEPAGE being accepted doesn't mean that huge pages back the Arena: THP may be
+            // disabled, deferred to khugepaged or unavailable due to fragmentation
+            m_transparentHugeBytes = TransparentHugeBytes(m_data, m_size);
+            m_hugePages = (m_transparentHugeBytes > 0) ? HugePages::TRANSPARENT : HugePages::NONE;
+        }
+        updateTotals(1);
+    }
+
+    /**
+     * @brief Construct a new Arena object using regular pages
+     *
+     * @param size - minimum size in bytes (rounded up to a whole number of pages)
+     * @param node - NUMA node on which to place the pages, or NO_NODE
+     * @throw std::bad_alloc - memory couldn't be mapped
+     */
+    Arena(size_t size, size_t node) : Arena(size, ArenaConfig {node, HugePages::NONE, false, true}) {
+    }
+
+    /**
+     * @brief Disable copy construction
+     */
+    Arena(const Arena &) = delete;
+
+    /**
+     * @brief Disable move construction
+     */
+    Arena(Arena &&) = delete;
+
+    /**
+     * @brief Disable assignment
+     */
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Disable move assignment
+     */
+    Arena &operator=(Arena &&) = delete;
+
+    /**
+     * @brief Destroy the Arena object, returning its memory to the kernel
+     */
+    ~Arena() {
+        updateTotals(-1);
+        munmap(m_data, m_size);
+    }
+
+    std::byte *data() {
+        return m_data;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_size;
+    }
+
+    /**
+     * @brief Return the requested NUMA node, or NO_NODE
+     */
+    [[nodiscard]] size_t node() const {
+        return m_node;
+    }
+
+    /**
+     * @brief Return true if the Arena's pages were successfully bound to the requested NUMA node
+     */
+    [[nodiscard]] bool bound() const {
+        return m_bound;
+    }
+
+    /**
+     * @brief Return the page size actually backing the Arena. TRANSPARENT means that at least
+     *        some of it was backed by transparent huge pages after it was pre-faulted (see
+     *        transparentHugeBytes()).
+     */
+    [[nodiscard]] HugePages hugePages() const {
+        return m_hugePages;
+    }
+
+    /**
+     * @brief Return how many bytes were backed by transparent huge pages at construction. The
+     *        kernel may later split or collapse them.
+     */
+    [[nodiscard]] size_t transparentHugeBytes() const {
+        return m_transparentHugeBytes;
+    }
+
+    /**
+     * @brief Return true if the Arena's pages were successfully locked into RAM
+     */
+    [[nodiscard]] bool locked() const {
+        return m_locked;
+    }
+
+    /**
+     * @brief Return true if a pointer lies within this Arena
+     */
+    [[nodiscard]] bool contains(const std::byte *ptr) const {
+        return ptr >= m_data && ptr < m_data + m_size;
+    }
+
+    /**
+     * @brief Return the system page size
+     */
+    static size_t pageSize() {
+        static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return pageSize;
+    }
+
+private:
+    static size_t roundTo(size_t size, size_t multiple) {
+        return ((size + multiple - 1) / multiple) * multiple;
+    }
+
+    void mapRegular(size_t size) {
+        m_size = roundTo(size, pageSize());
+        void *addr = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {  // NOLINT
+            throw std::bad_alloc();
+        }
+        m_data = static_cast<std::byte *>(addr);
+        m_hugePages = HugePages::NONE;
+    }
+
+    void mapHugeTlb(size_t size) {
+        const size_t len = roundTo(size, HUGE_PAGE_SIZE);
+        void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (addr != MAP_FAILED) {  // NOLINT
+            m_data = static_cast<std::byte *>(addr);
+            m_size = len;
+            m_hugePages = HugePages::EXPLICIT;
+        }
+    }
+
+    void mapTransparentHuge(size_t size) {
+        // Over-allocate so that the Arena can start on a huge page boundary, then trim
+        const size_t len = roundTo(size, HUGE_PAGE_SIZE);
+        void *addr = mmap(nullptr, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {  // NOLINT
+            return;
+        }
+        auto *base = static_cast<std::byte *>(addr);
+        auto *aligned = reinterpret_cast<std::byte *>(roundTo(reinterpret_cast<uintptr_t>(base), HUGE_PAGE_SIZE));
+        if (aligned > base) {
+            munmap(base, static_cast<size_t>(aligned - base));
+        }
+        const size_t tail = static_cast<size_t>((base + len + HUGE_PAGE_SIZE) - (aligned + len));
+        if (tail > 0) {
+            munmap(aligned + len, tail);
+        }
+        m_data = aligned;
+        m_size = len;
+        // Verified once the Arena has been faulted in
+        m_hugePages = (madvise(m_data, m_size, MADV_HUGEPAGE) == 0) ? HugePages::TRANSPARENT : HugePages::NONE;
+    }
+
+    /**
+     * @brief Touch each page so it is faulted in now (on the bound node) rather than on first use.
+     *        Only MAP_HUGETLB memory is sure to be faulted a huge page at a time; transparent huge
+     *        pages may fall back to regular pages, so each of those is touched.
+     */
+    void prefault() {
+        const size_t page = (m_hugePages == HugePages::EXPLICIT) ? HUGE_PAGE_SIZE : pageSize();
+        for (size_t offset = 0; offset < m_size; offset += page) {
+            m_data[offset] = std::byte {0};
+        }
+    }
+
+    void updateTotals(int sign) {
+        auto update = [sign](std::atomic<size_t> &total, size_t bytes) {
+            if (sign > 0) {
+                total += bytes;
+            } else {
+                total -= bytes;
+            }
+        };
+        auto &totals = GetArenaTotals();
+        update(totals.m_bytes, m_size);
+        update(totals.m_hugeTlbBytes, (m_hugePages == HugePages::EXPLICIT) ? m_size : 0);
+        update(totals.m_transparentHugeBytes, m_transparentHugeBytes);
+        update(totals.m_lockedBytes, m_locked ? m_size : 0);
+        update(totals.m_numaBoundBytes, m_bound ? m_size : 0);
+    }
+
+    std::byte *m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_node;
+    HugePages m_hugePages = HugePages::NONE;
+    size_t m_transparentHugeBytes = 0;
+    bool m_bound = false;
+    bool m_locked = false;
+};
+
+/**
+ * @brief Return a snapshot of the Arena totals
+ */
+inline MemoryStats GetMemoryStats() {
+    auto &totals = GetArenaTotals();
+    MemoryStats stats;
+    stats.m_bytes = totals.m_bytes.load();
+    stats.m_hugeTlbBytes = totals.m_hugeTlbBytes.load();
+    stats.m_transparentHugeBytes = totals.m_transparentHugeBytes.load();
+    stats.m_lockedBytes = totals.m_lockedBytes.load();
+    stats.m_numaBoundBytes = totals.m_numaBoundBytes.load();
+    return stats;
+}
+
+}  // namespace msglib::detail
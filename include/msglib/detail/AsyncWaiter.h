@@ -0,0 +1,47 @@
+#pragma once
+
+namespace msglib::detail {
+
+/**
+ * @brief AsyncWaiter is an intrusive list node for a suspended coroutine waiting on a mailbox
+ *        (see AsyncMailbox). It lives in the coroutine frame, so registering one never allocates.
+ */
+struct AsyncWaiter {
+    /**
+     * @brief Next waiter in the list
+     */
+    AsyncWaiter *m_next = nullptr;
+
+    /**
+     * @brief Called (without any mailbox lock held) when the condition being waited for occurs
+     */
+    void (*m_wake)(AsyncWaiter *waiter) = nullptr;
+
+    /**
+     * @brief Called (without any mailbox lock held) instead of m_wake if the mailbox being waited
+     *        on is destroyed first
+     */
+    void (*m_cancel)(AsyncWaiter *waiter) = nullptr;
+};
+
+/**
+ * @brief Result of asking a mailbox to wake a waiter once its queue has space
+ */
+enum class SpaceWait {
+    /**
+     * @brief The mailbox can't notify waiters
+     */
+    UNSUPPORTED,
+
+    /**
+     * @brief The queue has space now, so retry immediately
+     */
+    AVAILABLE,
+
+    /**
+     * @brief The waiter has been registered and will be woken
+     */
+    WAITING
+};
+
+}  // namespace msglib::detail
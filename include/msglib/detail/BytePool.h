@@ -1,10 +1,21 @@
 #pragma once
+#include "Arena.h"
+#include "msglib/Options.h"
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <stdalign.h>
 #include <cstddef>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <memory_resource>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace msglib::detail {
 
@@ -85,23 +96,41 @@ private:
 /**
  * @brief BytePool is a fixed-block allocator where the block size and pool
  *        capacity is specified at instantiation time.
- *        Internally std::pmr::polymorphic_allocator<std::byte> is used; the
- *        underlying memory_resource for this allocator is assumed to be
- *        std::pmr::synchronized_BytePool_resource for thread safety
+ *        The blocks are carved out of one allocation from the underlying
+ *        memory_resource at construction, and free blocks are kept on a free
+ *        list protected by a mutex, so any thread can allocate any free block.
+ *
+ *        Optionally (see enableGrowth()) the pool grows by adding slabs of
+ *        blocks in their own Arenas, up to a byte budget, and returns slabs
+ *        which have been idle for a cooldown period.
  */
 class BytePool {
 public:
+    /**
+     * @brief Maximum number of slabs, including the initial one
+     */
+    static constexpr size_t MAX_SLABS = 64;
+
     /**
      * @brief Construct a new Byte Pool object
      *
      * @param eltSize - size in bytes of each element
      * @param capacity - number of elements
      * @param resource - underlying PMR memory_resource
-     *
-     * TODO: Pad eltSize to ensure that each element is aligned properly
      */
     BytePool(size_t eltSize, size_t capacity, std::pmr::memory_resource *resource)
-        : m_alloc(resource), m_eltSize(eltSize), m_size(capacity), m_capacity(capacity) {
+        : m_alloc(resource), m_eltSize(eltSize), m_stride(Stride(eltSize)), m_size(capacity), m_capacity(capacity) {
+        if (capacity > 0) {
+            try {
+                auto *data = m_alloc.allocate(m_stride * capacity);
+                m_slabs[0] = Slab {data, data + (m_stride * capacity), data, nullptr, capacity, capacity, nullptr, {}};
+                m_slabCount = 1;
+            } catch (...) {
+                // Contain PMR exception here
+                m_size = 0;
+                m_capacity = 0;
+            }
+        }
     }
 
     /**
@@ -118,7 +147,11 @@ public:
      * @brief Destroy the Byte Pool object
      * 
      */
-    ~BytePool() = default;
+    ~BytePool() {
+        if (m_slabCount > 0 && m_slabs[0].m_arena == nullptr) {
+            m_alloc.deallocate(m_slabs[0].m_begin, m_slabs[0].m_blocks * m_stride);
+        }
+    }
 
     /**
      * @brief Disable assignment
@@ -131,7 +164,15 @@ public:
     BytePool &operator=(BytePool &&rhs) = delete;
 
     /**
-     * @brief Return the current number of allocated elements
+     * @brief Return the size in bytes each element occupies in the pool's memory
+     */
+    static size_t Stride(size_t eltSize) {
+        const size_t size = std::max(eltSize, sizeof(std::byte *));
+        return ((size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) * alignof(std::max_align_t);
+    }
+
+    /**
+     * @brief Return the current number of free elements
      *
      * @return size_t
      */
@@ -140,7 +181,7 @@ public:
     }
 
     /**
-     * @brief Return the pool's capacity
+     * @brief Return the pool's capacity, including any slabs added by growth
      *
      * @return size_t
      */
@@ -157,6 +198,119 @@ public:
         return m_eltSize;
     }
 
+    /**
+     * @brief Allow the pool to grow by slabs of blocks, each in its own Arena
+     *
+     * @param growth - budget, slab size, low-water mark and cooldown
+     * @param config - how slabs' memory should be obtained
+     * @param wake - called (without the pool's lock held) when the free blocks first fall below
+     *               the low-water mark, e.g. to wake a PoolGrower
+     */
+    void enableGrowth(const PoolGrowth &growth, const ArenaConfig &config, std::function<void()> wake = nullptr) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_growth = growth;
+        m_slabBlocks = std::max<size_t>(growth.m_slabSize / m_stride, 1);
+        m_config = config;
+        m_wake = std::move(wake);
+    }
+
+    /**
+     * @brief Return true if the free blocks are below the low-water mark and the budget allows
+     *        another slab
+     */
+    [[nodiscard]] bool needsGrowth() const {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return canGrow() && belowLowWater();
+    }
+
+    /**
+     * @brief Add a slab of blocks, if the budget allows. The slab's memory is mapped without the
+     *        pool's lock held.
+     *
+     * @return false - growth isn't enabled, the budget is used up or memory couldn't be mapped
+     */
+    bool grow() {
+        size_t blocks = 0;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (!canGrow()) {
+                return false;
+            }
+            blocks = m_slabBlocks;
+            m_growing += blocks * m_stride;
+        }
+        std::unique_ptr<Arena> arena;
+        try {
+            auto config = m_config;
+            // Pages are committed when blocks are first used, so an idle slab costs address space only
+            config.m_prefault = false;
+            arena = std::make_unique<Arena>(blocks * m_stride, config);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_growing -= blocks * m_stride;
+            return false;
+        }
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_growing -= blocks * m_stride;
+        if (m_slabCount == MAX_SLABS) {
+            return false;
+        }
+        std::byte *data = arena->data();
+        m_slabs[m_slabCount++] =
+            Slab {data, data + (blocks * m_stride), data, nullptr, blocks, blocks, std::move(arena), Clock::now()};
+        m_grown += blocks * m_stride;
+        m_capacity += blocks;
+        m_size += blocks;
+        m_lowSignalled = false;
+        return true;
+    }
+
+    /**
+     * @brief Return added slabs whose blocks have all been free for the cooldown period, while
+     *        keeping the free blocks at or above the low-water mark
+     *
+     * @param now - current time
+     * @return size_t - number of slabs returned
+     */
+    size_t shrink(std::chrono::steady_clock::time_point now = Clock::now()) {
+        std::array<std::unique_ptr<Arena>, MAX_SLABS> released;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            for (size_t i = m_slabCount; i-- > 1;) {
+                Slab &slab = m_slabs[i];
+                if (slab.m_arena == nullptr || slab.m_free != slab.m_blocks || now - slab.m_idleSince < m_growth.m_cooldown ||
+                    (m_size - slab.m_blocks) * 100 < (m_capacity - slab.m_blocks) * m_growth.m_lowWaterPercent) {
+                    continue;
+                }
+                m_grown -= slab.m_blocks * m_stride;
+                m_capacity -= slab.m_blocks;
+                m_size -= slab.m_blocks;
+                released[count++] = std::move(slab.m_arena);
+                std::move(m_slabs.begin() + i + 1, m_slabs.begin() + m_slabCount, m_slabs.begin() + i);
+                m_slabs[--m_slabCount] = Slab {};
+            }
+        }
+        // The Arenas are unmapped here, without the lock held
+        return count;
+    }
+
+    /**
+     * @brief Return the number of bytes currently added by growth
+     */
+    [[nodiscard]] size_t grown() const {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_grown;
+    }
+
+    /**
+     * @brief Return true if a block belongs to this pool
+     */
+    [[nodiscard]] bool contains(const std::byte *block) const {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return find(block) != nullptr;
+    }
+
     /**
      * @brief Allocate an element from the BytePool
      * 
@@ -164,14 +318,26 @@ public:
      *                     indicates allocation failure
      */
     DataBlock alloc() {
-        if (m_size > 0) {
-            try {
-                auto *result = m_alloc.allocate(m_eltSize);
-                m_size--;
-                return DataBlock(m_eltSize,result);
-            } catch (...) {
-                // Contain PMR exception here
-                return DataBlock();
+        for (int attempt = 0; attempt < 2; attempt++) {
+            std::byte *block = nullptr;
+            bool wake = false;
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                block = take();
+                if (block != nullptr && !m_lowSignalled && m_wake && canGrow() && belowLowWater()) {
+                    m_lowSignalled = true;
+                    wake = true;
+                }
+            }
+            if (wake) {
+                m_wake();
+            }
+            if (block != nullptr) {
+                return DataBlock(m_eltSize, block);
+            }
+            // Exhausted before the background growth caught up
+            if (!grow()) {
+                break;
             }
         }
         return DataBlock();
@@ -184,18 +350,104 @@ public:
      */
     void free(std::byte *t) {
         if (t != nullptr) {
-            try {
-                m_alloc.deallocate(t, m_eltSize);
-                m_size++;
-            } catch (...) {
-                // Contain PMR exception here
+            std::lock_guard<std::mutex> guard(m_mutex);
+            Slab *slab = find(t);
+            if (slab == nullptr) {
+                return;
+            }
+            std::memcpy(t, &slab->m_freeList, sizeof(std::byte *));
+            slab->m_freeList = t;
+            if (++slab->m_free == slab->m_blocks) {
+                slab->m_idleSince = Clock::now();
+            }
+            m_size++;
+            if (!belowLowWater()) {
+                m_lowSignalled = false;
             }
         }
     }
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A contiguous run of blocks. Blocks below m_next which are free are kept on
+     *        m_freeList, linked through their first bytes; blocks from m_next on have never been
+     *        used.
+     */
+    struct Slab {
+        std::byte *m_begin = nullptr;
+        std::byte *m_end = nullptr;
+        std::byte *m_next = nullptr;
+        std::byte *m_freeList = nullptr;
+        size_t m_blocks = 0;
+        size_t m_free = 0;
+
+        /**
+         * @brief Memory of a slab added by growth; the initial slab's comes from the memory_resource
+         */
+        std::unique_ptr<Arena> m_arena;
+
+        /**
+         * @brief When the last of the slab's blocks was freed
+         */
+        Clock::time_point m_idleSince;
+    };
+
     /**
-     * @brief Polymorphic allocator using an underlying std::pmr::synchronized_pool_resource
+     * @brief Take a free block, preferring the earliest slab so that later ones can drain and be
+     *        returned, with m_mutex held
+     */
+    std::byte *take() {
+        for (size_t i = 0; i < m_slabCount; i++) {
+            Slab &slab = m_slabs[i];
+            if (slab.m_free == 0) {
+                continue;
+            }
+            std::byte *block = slab.m_freeList;
+            if (block != nullptr) {
+                std::memcpy(&slab.m_freeList, block, sizeof(std::byte *));
+            } else {
+                block = slab.m_next;
+                slab.m_next += m_stride;
+            }
+            slab.m_free--;
+            m_size--;
+            return block;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Find the slab holding a block, with m_mutex held
+     */
+    Slab *find(const std::byte *block) {
+        for (size_t i = 0; i < m_slabCount; i++) {
+            if (block >= m_slabs[i].m_begin && block < m_slabs[i].m_end) {
+                return &m_slabs[i];
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] const Slab *find(const std::byte *block) const {
+        return const_cast<BytePool *>(this)->find(block);
+    }
+
+    /**
+     * @brief Return true if another slab fits in the budget, with m_mutex held
+     */
+    [[nodiscard]] bool canGrow() const {
+        return m_slabBlocks > 0 && m_slabCount + 1 < MAX_SLABS &&
+            m_grown + m_growing + (m_slabBlocks * m_stride) <= m_growth.m_budget;
+    }
+
+    [[nodiscard]] bool belowLowWater() const {
+        return m_size * 100 < m_capacity * m_growth.m_lowWaterPercent;
+    }
+
+    /**
+     * @brief Polymorphic allocator for the initial slab
      */
     std::pmr::polymorphic_allocator<std::byte> m_alloc;
 
@@ -205,7 +457,12 @@ private:
     size_t m_eltSize;
 
     /**
-     * @brief Current number of elements allocated from the BytePool
+     * @brief Distance between elements, allowing for alignment and the free list link
+     */
+    size_t m_stride;
+
+    /**
+     * @brief Current number of free elements in the BytePool
      */
     std::atomic<size_t> m_size;
 
@@ -213,6 +470,106 @@ private:
      * @brief Capacity of elements in the BytePool
      */
     std::atomic<size_t> m_capacity;
+
+    /**
+     * @brief Protects the slabs and growth state
+     */
+    mutable std::mutex m_mutex;
+
+    std::array<Slab, MAX_SLABS> m_slabs {};
+    size_t m_slabCount = 0;
+
+    PoolGrowth m_growth;
+    ArenaConfig m_config;
+
+    /**
+     * @brief Blocks per added slab; 0 while growth is disabled
+     */
+    size_t m_slabBlocks = 0;
+
+    /**
+     * @brief Bytes added by growth, and being added
+     */
+    size_t m_grown = 0;
+    size_t m_growing = 0;
+
+    /**
+     * @brief Called when the free blocks fall below the low-water mark
+     */
+    std::function<void()> m_wake;
+
+    /**
+     * @brief Set once m_wake has been called, until the free blocks recover
+     */
+    bool m_lowSignalled = false;
+};
+
+/**
+ * @brief PoolGrower runs a background thread which adds slabs to pools whose free blocks have
+ *        fallen below their low-water mark, and returns slabs which have been idle for their
+ *        cooldown, so that neither happens on the hot path
+ */
+class PoolGrower {
+public:
+    /**
+     * @brief Start the thread
+     *
+     * @param pools - pools to be managed, which have had enableGrowth() called with wake()
+     * @param cooldown - idle slabs are checked for at least this often
+     */
+    PoolGrower(std::vector<BytePool *> pools, std::chrono::milliseconds cooldown)
+        : m_pools(std::move(pools)), m_interval(std::max(cooldown / 4, std::chrono::milliseconds(1))) {
+        m_thread = std::thread([this]() { run(); });
+    }
+
+    PoolGrower(const PoolGrower &) = delete;
+    PoolGrower(PoolGrower &&) = delete;
+    PoolGrower &operator=(const PoolGrower &) = delete;
+    PoolGrower &operator=(PoolGrower &&) = delete;
+
+    ~PoolGrower() {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_one();
+        m_thread.join();
+    }
+
+    /**
+     * @brief Wake the thread to grow the pools
+     */
+    void wake() {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_woken = true;
+        }
+        m_cond.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop) {
+            m_cond.wait_for(lock, m_interval, [this]() { return m_stop || m_woken; });
+            m_woken = false;
+            lock.unlock();
+            for (auto *pool : m_pools) {
+                while (pool->needsGrowth() && pool->grow()) {
+                }
+                pool->shrink();
+            }
+            lock.lock();
+        }
+    }
+
+    std::vector<BytePool *> m_pools;
+    std::chrono::milliseconds m_interval;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+    bool m_woken = false;
+    std::thread m_thread;
 };
 
-}  // namespace msglib::detail
\ No newline at end of file
+}  // namespace msglib::detail
@@ -0,0 +1,236 @@
+#pragma once
+#include "msglib/MailboxPolicies.h"
+#include "msglib/Message.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace msglib::detail {
+
+/**
+ * @brief CallTrailer follows the request data in the data block of a message sent with
+ *        Mailbox::Call(), identifying the caller's correlation slot. Keeping it after the data
+ *        (rather than before) means responders see an ordinary message of the request type.
+ */
+struct CallTrailer {
+    /**
+     * @brief Index of the caller's correlation slot
+     */
+    uint32_t m_slot;
+
+    /**
+     * @brief Generation of the slot when the request was sent
+     */
+    uint32_t m_generation;
+};
+
+/**
+ * @brief Offset of the CallTrailer within a request's data block
+ *
+ * @param size - size of the request data
+ */
+inline size_t CallTrailerOffset(size_t size) {
+    return ((size + alignof(CallTrailer) - 1) / alignof(CallTrailer)) * alignof(CallTrailer);
+}
+
+/**
+ * @brief Size of the data block holding a request of a given size and its CallTrailer
+ *
+ * @param size - size of the request data
+ */
+inline size_t CallBlockSize(size_t size) {
+    return CallTrailerOffset(size) + sizeof(CallTrailer);
+}
+
+/**
+ * @brief CallSlot correlates a reply with the caller waiting for it. The reply message is
+ *        handed to the caller directly rather than being routed by label.
+ *
+ *        m_state packs the slot's generation (upper 32 bits) with its State (lower 32 bits), so
+ *        that a reply racing with the caller giving up either wins outright or sees a newer
+ *        generation and is discarded.
+ */
+struct CallSlot {
+    enum State : uint32_t {
+        /**
+         * @brief The caller is waiting for a reply
+         */
+        WAITING = 0,
+
+        /**
+         * @brief A responder has claimed the slot and is storing its reply
+         */
+        REPLYING = 1,
+
+        /**
+         * @brief The reply is available in m_reply
+         */
+        REPLIED = 2,
+
+        /**
+         * @brief The slot is not in use
+         */
+        IDLE = 3
+    };
+
+    static uint64_t pack(uint32_t generation, State state) {
+        return (static_cast<uint64_t>(generation) << 32U) | state;
+    }
+
+    static uint32_t generationOf(uint64_t value) {
+        return static_cast<uint32_t>(value >> 32U);
+    }
+
+    static State stateOf(uint64_t value) {
+        return static_cast<State>(value & 0xffffffffU);
+    }
+
+    /**
+     * @brief Generation and State of the slot
+     */
+    std::atomic<uint64_t> m_state {pack(0, IDLE)};
+
+    /**
+     * @brief Reply to the current call, valid once REPLIED
+     */
+    Message m_reply;
+
+    /**
+     * @brief Wait strategy for the caller
+     */
+    BlockingWait m_wait;
+};
+
+/**
+ * @brief CallSlots is a fixed pool of CallSlots allocated at initialization time
+ */
+class CallSlots {
+public:
+    /**
+     * @brief Construct a new CallSlots object
+     *
+     * @param count - maximum number of concurrently outstanding calls
+     */
+    explicit CallSlots(size_t count) : m_slots(std::make_unique<CallSlot[]>(count)), m_count(count) {
+        m_free.reserve(count);
+        for (size_t i = count; i > 0; i--) {
+            m_free.push_back(static_cast<uint32_t>(i - 1));
+        }
+    }
+
+    /**
+     * @brief Acquire a slot for a new call, placing it in the WAITING state
+     *
+     * @param index - index of the acquired slot
+     * @param generation - generation of the call
+     * @return false - all slots are in use
+     */
+    bool acquire(uint32_t &index, uint32_t &generation) {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (m_free.empty()) {
+                return false;
+            }
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        CallSlot &slot = m_slots[index];
+        generation = CallSlot::generationOf(slot.m_state.load(std::memory_order_relaxed)) + 1;
+        slot.m_reply = Message();
+        slot.m_state.store(CallSlot::pack(generation, CallSlot::WAITING), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Give up on the current call if no reply has been claimed for it
+     *
+     * @return true - the slot has been released, and any later reply will be discarded
+     * @return false - a reply is being (or has been) stored
+     */
+    bool abandon(uint32_t index, uint32_t generation) {
+        uint64_t expected = CallSlot::pack(generation, CallSlot::WAITING);
+        if (m_slots[index].m_state.compare_exchange_strong(
+                expected, CallSlot::pack(generation, CallSlot::IDLE), std::memory_order_acq_rel)) {
+            release(index);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Hand a reply to the caller waiting on a slot
+     *
+     * @param trailer - identifies the slot and the call's generation
+     * @param reply - reply message, owned by the caller on success
+     * @return false - the caller is no longer waiting (timed out or already replied to)
+     */
+    bool reply(const CallTrailer &trailer, const Message &reply) {
+        if (trailer.m_slot >= m_count) {
+            return false;
+        }
+        CallSlot &slot = m_slots[trailer.m_slot];
+        uint64_t expected = CallSlot::pack(trailer.m_generation, CallSlot::WAITING);
+        if (!slot.m_state.compare_exchange_strong(
+                expected, CallSlot::pack(trailer.m_generation, CallSlot::REPLYING), std::memory_order_acq_rel)) {
+            return false;
+        }
+        slot.m_reply = reply;
+        slot.m_state.store(CallSlot::pack(trailer.m_generation, CallSlot::REPLIED), std::memory_order_release);
+        slot.m_wait.notify();
+        return true;
+    }
+
+    /**
+     * @brief Return true once a reply is available for the current call
+     */
+    bool replied(uint32_t index) const {
+        return CallSlot::stateOf(m_slots[index].m_state.load(std::memory_order_acquire)) == CallSlot::REPLIED;
+    }
+
+    /**
+     * @brief Take the reply from a REPLIED slot and release the slot
+     */
+    Message take(uint32_t index, uint32_t generation) {
+        CallSlot &slot = m_slots[index];
+        Message reply = slot.m_reply;
+        slot.m_reply = Message();
+        slot.m_state.store(CallSlot::pack(generation, CallSlot::IDLE), std::memory_order_release);
+        release(index);
+        return reply;
+    }
+
+    CallSlot &operator[](uint32_t index) {
+        return m_slots[index];
+    }
+
+    /**
+     * @brief Return the number of slots
+     */
+    [[nodiscard]] size_t size() const {
+        return m_count;
+    }
+
+private:
+    void release(uint32_t index) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_free.push_back(index);
+    }
+
+    std::unique_ptr<CallSlot[]> m_slots;
+    size_t m_count;
+
+    /**
+     * @brief Mutex protecting the free list
+     */
+    std::mutex m_mutex;
+
+    /**
+     * @brief Indices of unused slots
+     */
+    std::vector<uint32_t> m_free;
+};
+
+}  // namespace msglib::detail
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace msglib::detail {
+
+/**
+ * @brief ChainHeader is stored at the start of each "large" pool block making up a chained
+ *        message, linking the blocks together. The block's share of the message data follows
+ *        the header at CHAIN_HEADER_SIZE bytes.
+ */
+struct ChainHeader {
+    /**
+     * @brief Next block in the chain, or nullptr for the last block
+     */
+    std::byte *m_next;
+
+    /**
+     * @brief Number of message data bytes held in this block
+     */
+    size_t m_length;
+};
+
+/**
+ * @brief Offset of the message data within each chained block, keeping it suitably aligned
+ */
+static constexpr size_t CHAIN_HEADER_SIZE =
+    ((sizeof(ChainHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) * alignof(std::max_align_t);
+
+/**
+ * @brief Return the header of a chained block
+ *
+ * @param block - block allocated from the "large" pool
+ * @return ChainHeader* - header at the start of the block
+ */
+inline ChainHeader *ChainHeaderOf(std::byte *block) {
+    return reinterpret_cast<ChainHeader *>(block);
+}
+
+/**
+ * @brief Return the header of a chained block
+ *
+ * @param block - block allocated from the "large" pool
+ * @return const ChainHeader* - header at the start of the block
+ */
+inline const ChainHeader *ChainHeaderOf(const std::byte *block) {
+    return reinterpret_cast<const ChainHeader *>(block);
+}
+
+/**
+ * @brief Return the message data held in a chained block
+ *
+ * @param block - block allocated from the "large" pool
+ * @return std::byte* - start of this block's message data
+ */
+inline std::byte *ChainPayload(std::byte *block) {
+    return block + CHAIN_HEADER_SIZE;
+}
+
+/**
+ * @brief Return the message data held in a chained block
+ *
+ * @param block - block allocated from the "large" pool
+ * @return const std::byte* - start of this block's message data
+ */
+inline const std::byte *ChainPayload(const std::byte *block) {
+    return block + CHAIN_HEADER_SIZE;
+}
+
+}  // namespace msglib::detail
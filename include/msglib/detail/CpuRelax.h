@@ -0,0 +1,17 @@
+#pragma once
+
+namespace msglib::detail {
+
+/**
+ * @brief Hint to the CPU that the caller is busy-waiting, reducing power use and contention
+ *        with a hyperthread sibling while spinning
+ */
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+}  // namespace msglib::detail
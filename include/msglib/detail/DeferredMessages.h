@@ -0,0 +1,268 @@
+#pragma once
+#include "msglib/Message.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace msglib::detail {
+
+/**
+ * @brief DeferredMessages holds messages which a selective receive has taken from a mailbox's
+ *        queue without matching, in arrival order, until they are received. Besides the list of
+ *        all messages, each message is linked into a sub-chain for its label's hash bucket, so
+ *        that finding the oldest message with a given label only visits messages in that bucket
+ *        rather than the whole list.
+ *
+ *        Nodes and buckets are allocated once at construction. Not thread-safe: it belongs to
+ *        the mailbox's consumer.
+ */
+class DeferredMessages {
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        Message m_msg;
+        uint32_t m_seq;
+        uint32_t m_prev;
+        uint32_t m_next;
+        uint32_t m_bucketNext;
+    };
+
+    struct Bucket {
+        uint32_t m_head;
+        uint32_t m_tail;
+    };
+
+public:
+    /**
+     * @brief Bytes of storage needed per unit of capacity
+     */
+    static constexpr size_t ELEMENT_SIZE = sizeof(Node) + 2 * sizeof(Bucket);
+
+    /**
+     * @brief Construct a new DeferredMessages object
+     *
+     * @param capacity - maximum number of messages
+     * @param resource - memory resource from which nodes and buckets are allocated
+     */
+    DeferredMessages(size_t capacity, std::pmr::memory_resource *resource)
+        : m_nodeAlloc(resource)
+        , m_bucketAlloc(resource)
+        , m_capacity(capacity)
+        , m_bucketCount(bucketCount(capacity))
+        , m_nodes(m_nodeAlloc.allocate(capacity))
+        , m_buckets(m_bucketAlloc.allocate(m_bucketCount)) {
+        for (size_t i = 0; i < m_capacity; i++) {
+            new (&m_nodes[i]) Node {Message(), 0, NIL, (i + 1 < m_capacity) ? static_cast<uint32_t>(i + 1) : NIL, NIL};
+        }
+        m_free = (m_capacity > 0) ? 0 : NIL;
+        for (size_t i = 0; i < m_bucketCount; i++) {
+            new (&m_buckets[i]) Bucket {NIL, NIL};
+        }
+    }
+
+    ~DeferredMessages() {
+        m_nodeAlloc.deallocate(m_nodes, m_capacity);
+        m_bucketAlloc.deallocate(m_buckets, m_bucketCount);
+    }
+
+    DeferredMessages(const DeferredMessages &) = delete;
+    DeferredMessages(DeferredMessages &&) = delete;
+    DeferredMessages &operator=(const DeferredMessages &) = delete;
+    DeferredMessages &operator=(DeferredMessages &&) = delete;
+
+    [[nodiscard]] bool empty() const {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] bool full() const {
+        return m_size == m_capacity;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_size;
+    }
+
+    /**
+     * @brief Append a message
+     *
+     * @return false - full
+     */
+    bool push(const Message &msg) {
+        if (m_free == NIL) {
+            return false;
+        }
+        const uint32_t index = m_free;
+        Node &node = m_nodes[index];
+        m_free = node.m_next;
+        node = Node {msg, m_nextSeq++, m_tail, NIL, NIL};
+        if (m_tail != NIL) {
+            m_nodes[m_tail].m_next = index;
+        } else {
+            m_head = index;
+        }
+        m_tail = index;
+
+        Bucket &bucket = m_buckets[bucketOf(msg.m_label)];
+        if (bucket.m_tail != NIL) {
+            m_nodes[bucket.m_tail].m_bucketNext = index;
+        } else {
+            bucket.m_head = index;
+        }
+        bucket.m_tail = index;
+        m_size++;
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest message
+     *
+     * @return false - empty
+     */
+    bool popFront(Message &msg) {
+        if (m_head == NIL) {
+            return false;
+        }
+        // The oldest message is also the oldest in its bucket
+        const uint32_t index = m_head;
+        Bucket &bucket = m_buckets[bucketOf(m_nodes[index].m_msg.m_label)];
+        remove(index, bucket, NIL);
+        msg = m_nodes[index].m_msg;
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest message with any of a set of labels
+     *
+     * @param labels - labels to match
+     * @param count - number of labels
+     * @return false - no message matches
+     */
+    bool take(const Label *labels, size_t count, Message &msg) {
+        uint32_t found = NIL;
+        uint32_t foundPrev = NIL;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t prev = NIL;
+            for (uint32_t index = m_buckets[bucketOf(labels[i])].m_head; index != NIL; index = m_nodes[index].m_bucketNext) {
+                if (m_nodes[index].m_msg.m_label == labels[i]) {
+                    if (found == NIL || older(m_nodes[index].m_seq, m_nodes[found].m_seq)) {
+                        found = index;
+                        foundPrev = prev;
+                    }
+                    break;
+                }
+                prev = index;
+            }
+        }
+        if (found == NIL) {
+            return false;
+        }
+        remove(found, m_buckets[bucketOf(m_nodes[found].m_msg.m_label)], foundPrev);
+        msg = m_nodes[found].m_msg;
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest message satisfying a predicate
+     *
+     * @param pred - callable taking a const Message&
+     * @return false - no message matches
+     */
+    template <class Pred>
+    bool takeIf(Pred &&pred, Message &msg) {
+        for (uint32_t index = m_head; index != NIL; index = m_nodes[index].m_next) {
+            if (pred(static_cast<const Message &>(m_nodes[index].m_msg))) {
+                Bucket &bucket = m_buckets[bucketOf(m_nodes[index].m_msg.m_label)];
+                remove(index, bucket, bucketPrev(bucket, index));
+                msg = m_nodes[index].m_msg;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static size_t bucketCount(size_t capacity) {
+        size_t count = 1;
+        while (count < capacity) {
+            count <<= 1U;
+        }
+        return count;
+    }
+
+    [[nodiscard]] size_t bucketOf(Label label) const {
+        return label & (m_bucketCount - 1);
+    }
+
+    /**
+     * @brief Return true if sequence number a is older than b, allowing for wrap-around
+     */
+    static bool older(uint32_t a, uint32_t b) {
+        return static_cast<int32_t>(a - b) < 0;
+    }
+
+    uint32_t bucketPrev(const Bucket &bucket, uint32_t index) const {
+        uint32_t prev = NIL;
+        for (uint32_t i = bucket.m_head; i != index; i = m_nodes[i].m_bucketNext) {
+            prev = i;
+        }
+        return prev;
+    }
+
+    /**
+     * @brief Unlink a node from the list and its bucket and return it to the free list
+     *
+     * @param bucketPrev - the node preceding it in the bucket, or NIL
+     */
+    void remove(uint32_t index, Bucket &bucket, uint32_t bucketPrev) {
+        Node &node = m_nodes[index];
+        if (node.m_prev != NIL) {
+            m_nodes[node.m_prev].m_next = node.m_next;
+        } else {
+            m_head = node.m_next;
+        }
+        if (node.m_next != NIL) {
+            m_nodes[node.m_next].m_prev = node.m_prev;
+        } else {
+            m_tail = node.m_prev;
+        }
+
+        if (bucketPrev != NIL) {
+            m_nodes[bucketPrev].m_bucketNext = node.m_bucketNext;
+        } else {
+            bucket.m_head = node.m_bucketNext;
+        }
+        if (bucket.m_tail == index) {
+            bucket.m_tail = bucketPrev;
+        }
+
+        node.m_next = m_free;
+        m_free = index;
+        m_size--;
+    }
+
+    std::pmr::polymorphic_allocator<Node> m_nodeAlloc;
+    std::pmr::polymorphic_allocator<Bucket> m_bucketAlloc;
+    size_t m_capacity;
+    size_t m_bucketCount;
+    Node *m_nodes;
+    Bucket *m_buckets;
+    size_t m_size = 0;
+
+    /**
+     * @brief Oldest and newest messages
+     */
+    uint32_t m_head = NIL;
+    uint32_t m_tail = NIL;
+
+    /**
+     * @brief First unused node, linked through m_next
+     */
+    uint32_t m_free = NIL;
+
+    /**
+     * @brief Sequence number for the next message pushed, for ordering messages across buckets
+     */
+    uint32_t m_nextSeq = 0;
+};
+
+}  // namespace msglib::detail
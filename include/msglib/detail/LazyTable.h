@@ -0,0 +1,57 @@
+#pragma once
+#include "Arena.h"
+#include <cstddef>
+#include <type_traits>
+
+namespace msglib::detail {
+
+/**
+ * @brief LazyTable is a fixed-size table whose memory is reserved up front but only committed
+ *        by the kernel, page by page, as entries are first touched. Construction costs a single
+ *        mmap() regardless of the table size. Entries start out zero-filled, so T must be a
+ *        trivial type for which all-zero bytes is its empty state.
+ *
+ *        Locking memory (Options::m_lockMemory) commits the whole table at construction.
+ *
+ * @tparam T - table entry type
+ */
+template <class T>
+class LazyTable {
+    static_assert(std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>,
+        "LazyTable requires entries which are valid when zero-filled");
+
+public:
+    /**
+     * @brief Construct a new LazyTable object
+     *
+     * @param count - number of entries
+     * @param config - memory configuration; pre-faulting and huge pages are not used
+     * @throw std::bad_alloc - memory couldn't be mapped
+     */
+    LazyTable(size_t count, const ArenaConfig &config)
+        : m_arena(((count != 0) ? count : 1) * sizeof(T), lazyConfig(config)), m_count(count) {
+    }
+
+    T &operator[](size_t index) {
+        return reinterpret_cast<T *>(m_arena.data())[index];
+    }
+
+    /**
+     * @brief Return the number of entries
+     */
+    [[nodiscard]] size_t size() const {
+        return m_count;
+    }
+
+private:
+    static ArenaConfig lazyConfig(ArenaConfig config) {
+        config.m_hugePages = HugePages::NONE;
+        config.m_prefault = false;
+        return config;
+    }
+
+    Arena m_arena;
+    size_t m_count;
+};
+
+}  // namespace msglib::detail
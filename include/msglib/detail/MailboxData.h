@@ -1,9 +1,24 @@
 #pragma once
 
+#include "Arena.h"
 #include "BytePool.h"
+#include "CallSlots.h"
+#include "Chain.h"
+#include "LazyTable.h"
+#include "Numa.h"
 #include "Receiver.h"
+#include "SharedBlock.h"
+#include "msglib/Message.h"
+#include "msglib/Options.h"
 #include <memory_resource>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
 
 namespace msglib {
 using Label = uint16_t;
@@ -11,17 +26,62 @@ using Label = uint16_t;
 namespace detail {
 
 /**
- * @brief Default resource pool sizes and capacities
+ * @brief Maximum number of mailboxes given a 16-bit label (0..65535)
  */
-static constexpr size_t LARGE_SIZE = 2048;
-static constexpr size_t SMALL_SIZE = 256;
-static constexpr size_t LARGE_CAP = 200;
-static constexpr size_t SMALL_CAP = 200;
+static constexpr size_t MAX_MAILBOX = MAX_LABELS;
 
 /**
- * @brief Maximum number of mailboxes given a 16-bit label (0..65535)
+ * @brief Pool from which a fixed-size message's data block is allocated
+ */
+enum class PoolClass : uint8_t { SMALL, LARGE };
+
+/**
+ * @brief PoolPartition is a set of "small" and "large" BytePools carved out of a single Arena,
+ *        optionally placed on a specific NUMA node
  */
-static constexpr size_t MAX_MAILBOX = 65536;
+struct PoolPartition {
+    /**
+     * @brief Arena holding the pools' memory
+     */
+    Arena m_arena;
+
+    /**
+     * @brief Monotonic buffer resource from which the small and large pools take their blocks
+     */
+    std::pmr::monotonic_buffer_resource m_byteResource;
+
+    /**
+     * @brief BytePool for allocating "small" data blocks
+     */
+    detail::BytePool m_smallPool;
+
+    /**
+     * @brief BytePool for allocating "large" data blocks
+     */
+    detail::BytePool m_largePool;
+
+    /**
+     * @brief Construct a new PoolPartition object
+     *
+     * @param options - pool sizes and capacities
+     * @param node - NUMA node for the partition's memory, or Arena::NO_NODE
+     */
+    PoolPartition(const Options &options, size_t node)
+        : m_arena((BytePool::Stride(options.m_smallSize) * options.m_smallCap) +
+                  (BytePool::Stride(options.m_largeSize) * options.m_largeCap) + 1000,
+              ArenaConfig::FromOptions(options, node))
+        , m_byteResource(m_arena.data(), m_arena.size(), std::pmr::null_memory_resource())
+        , m_smallPool(options.m_smallSize, options.m_smallCap, &m_byteResource)
+        , m_largePool(options.m_largeSize, options.m_largeCap, &m_byteResource) {
+    }
+
+    /**
+     * @brief Return true if a block belongs to this partition's pools
+     */
+    bool owns(const std::byte *block) const {
+        return m_arena.contains(block) || m_smallPool.contains(block) || m_largePool.contains(block);
+    }
+};
 
 /**
  * @brief Resources is a struct encapsulating dynamically allocated resources within the
@@ -39,66 +99,144 @@ struct Resources {
     size_t m_largeSize;
 
     /**
-     * @brief Number of bytes to be allocated for the monotonic buffer resource
+     * @brief Pool partitions, one per NUMA node (indexed by node) or a single partition
      */
-    size_t m_byteSize;
+    std::vector<std::unique_ptr<PoolPartition>> m_partitions;
 
     /**
-     * @brief Bytes to be used by the monotonic buffer resource
+     * @brief For each node, the partitions to allocate from in order of distance
      */
-    std::unique_ptr<std::byte[]> m_bytes;
+    std::vector<std::vector<size_t>> m_nearest;
 
     /**
-     * @brief Monotonic buffer resource supporting small and large pools
-     *        and the unordered_map of receivers
+     * @brief Collection of registered receivers indexed by Label, committed as labels are used
      */
-    std::pmr::monotonic_buffer_resource m_byteResource;
+    LazyTable<Receivers> m_mailboxes;
 
     /**
-     * @brief Synchronized pool resource
+     * @brief Label range and mask subscriptions, flagged in the Receivers of each label they match
      */
-    std::pmr::synchronized_pool_resource m_syncResource;
+    Subscriptions m_subscriptions;
 
     /**
-     * @brief BytePool for allocating "small" data blocks
+     * @brief Correlation slots for outstanding Mailbox::Call()s
      */
-    detail::BytePool m_smallPool;
+    CallSlots m_calls;
 
     /**
-     * @brief BytePool for allocating "large" data blocks
+     * @brief Background thread growing and shrinking the pools, if Options::m_poolGrowth enables
+     *        growth. Declared last so that it stops before the pools are destroyed.
      */
-    detail::BytePool m_largePool;
+    std::unique_ptr<PoolGrower> m_grower;
 
     /**
-     * @brief Collection of registered receivers indexed by Label
+     * @brief Construct a new Resources object
+     *
+     * @param options - pool sizes and capacities, NUMA placement and number of labels
      */
-    std::array<Receivers, MAX_MAILBOX> m_mailboxes;
+    explicit Resources(const Options &options)
+        : m_smallSize(options.m_smallSize)
+        , m_largeSize(options.m_largeSize)
+        , m_mailboxes((options.m_maxLabels < MAX_MAILBOX) ? options.m_maxLabels : MAX_MAILBOX,
+              ArenaConfig::FromOptions(options))
+        , m_calls(options.m_maxCalls) {
+        if (options.m_numaLocal) {
+            const size_t nodes = NumaNodeCount();
+            for (size_t node = 0; node < nodes; node++) {
+                m_partitions.push_back(std::make_unique<PoolPartition>(options, node));
+                m_nearest.push_back(NumaNodesByDistance(node, nodes));
+            }
+        } else {
+            m_partitions.push_back(std::make_unique<PoolPartition>(options, Arena::NO_NODE));
+        }
+        if (options.m_poolGrowth.m_budget > 0) {
+            std::vector<BytePool *> pools;
+            for (auto &partition : m_partitions) {
+                pools.push_back(&partition->m_smallPool);
+                pools.push_back(&partition->m_largePool);
+            }
+            m_grower = std::make_unique<PoolGrower>(pools, options.m_poolGrowth.m_cooldown);
+            for (size_t i = 0; i < m_partitions.size(); i++) {
+                const auto config = ArenaConfig::FromOptions(options, options.m_numaLocal ? i : Arena::NO_NODE);
+                auto wake = [grower = m_grower.get()]() { grower->wake(); };
+                m_partitions[i]->m_smallPool.enableGrowth(options.m_poolGrowth, config, wake);
+                m_partitions[i]->m_largePool.enableGrowth(options.m_poolGrowth, config, wake);
+            }
+        }
+    }
 
     /**
-     * @brief Construct a new Resources object
-     * 
-     * @param smallSize - size of elements in the "small" BytePool
-     * @param smallCap - capacity of the "small" BytePool
-     * @param largeSize - size of elements in the "large" BytePool
-     * @param largeCap - capacity of the "large" BytePool
+     * @brief Allocate a block from one of each partition's pools, trying the calling thread's
+     *        node first and then the others, nearest first, so that sends only fail once every
+     *        node's pool is exhausted
+     *
+     * @param pool - PoolPartition::m_smallPool or PoolPartition::m_largePool
+     */
+    DataBlock allocate(BytePool PoolPartition::*pool) {
+        if (m_partitions.size() == 1) {
+            return (*m_partitions[0].*pool).alloc();
+        }
+        size_t node = CurrentNumaNode();
+        node = (node < m_partitions.size()) ? node : 0;
+        for (size_t next : m_nearest[node]) {
+            auto db = (*m_partitions[next].*pool).alloc();
+            if (db.get() != nullptr) {
+                return db;
+            }
+        }
+        return DataBlock();
+    }
+
+    /**
+     * @brief Return the partition which owns a block
      */
-    Resources(size_t smallSize, size_t smallCap, size_t largeSize, size_t largeCap)
-        : m_smallSize(smallSize)
-        , m_largeSize(largeSize)
-        , m_byteSize((smallSize * smallCap) + (largeSize * largeCap) + 1000)
-        , m_bytes(std::make_unique<std::byte[]>(m_byteSize))
-        , m_byteResource(m_bytes.get(), m_byteSize, std::pmr::null_memory_resource())
-        , m_syncResource(&m_byteResource)
-        , m_smallPool(smallSize, smallCap, &m_syncResource)
-        , m_largePool(largeSize, largeCap, &m_syncResource) {
+    PoolPartition &owner(const std::byte *block) {
+        if (m_partitions.size() > 1) {
+            for (auto &partition : m_partitions) {
+                if (partition->owns(block)) {
+                    return *partition;
+                }
+            }
+        }
+        return *m_partitions[0];
+    }
+};
+
+/**
+ * @brief SegmentCursor tracks progress through a sequence of ranges of bytes being copied
+ *        into one or more destination buffers
+ */
+class SegmentCursor {
+public:
+    SegmentCursor(const ByteSpan *segments, size_t count) : m_segments(segments), m_count(count) {
     }
 
     /**
-     * @brief Destroy the Resources object
+     * @brief Copy the next len bytes from the ranges into dest
      */
-    ~Resources() 
-    {}
+    void copy(std::byte *dest, size_t len) {
+        size_t copied = 0;
+        while (copied < len && m_index < m_count) {
+            const auto &segment = m_segments[m_index];
+            size_t avail = segment.size() - m_offset;
+            size_t n = (avail < len - copied) ? avail : len - copied;
+            if (n > 0) {
+                memcpy(dest + copied, segment.data() + m_offset, n);
+            }
+            copied += n;
+            m_offset += n;
+            if (m_offset == segment.size()) {
+                m_index++;
+                m_offset = 0;
+            }
+        }
+    }
 
+private:
+    const ByteSpan *m_segments;
+    size_t m_count;
+    size_t m_index = 0;
+    size_t m_offset = 0;
 };
 
 /**
@@ -109,67 +247,122 @@ public:
     MailboxData() noexcept = default;
 
     bool Initialize() {
-        try {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (!m_initialized) {
-                m_resources = std::make_unique<Resources>(SMALL_SIZE, SMALL_CAP, LARGE_SIZE, LARGE_CAP);
-                m_initialized = true;
-            }
-            else {
-                return false;
-            }
-        } catch (std::exception &e) {
-            return false;
-        }
-        return true;
+        return Initialize(Options());
     }
 
     bool Initialize(size_t smallSize, size_t smallCap, size_t largeSize, size_t largeCap) {
-        try {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (!m_initialized) {
-                m_resources = std::make_unique<Resources>(smallSize, smallCap, largeSize, largeCap);
-                m_initialized = true;
-            }
-            else {
-                // Already initialized
-                return false;
-            }
-        } catch (std::exception &e) {
-            return false;
-        }
-        return true;
+        Options options;
+        options.m_smallSize = smallSize;
+        options.m_smallCap = smallCap;
+        options.m_largeSize = largeSize;
+        options.m_largeCap = largeCap;
+        return Initialize(options);
+    }
+
+    bool Initialize(const Options &options) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return initializeLocked(options);
     }
 
     /**
      * @brief Register a Mailbox instance as a receiver for a particular label
+     *
+     * @return false - label is outside the configured range or has the maximum number of receivers
      */
-    bool RegisterForLabel(msglib::Label label, msglib::Mailbox *mbox) {
+    bool RegisterForLabel(msglib::Label label, msglib::MailboxBase *mbox, Mode mode = Mode::Broadcast) {
         std::lock_guard<std::mutex> guard(m_mutex);
         if (!m_initialized) {
-            Initialize();
+            initializeLocked(Options());
         }
-        return m_resources->m_mailboxes[label].add(mbox);
+        if (!m_resources || label >= m_resources->m_mailboxes.size()) {
+            return false;
+        }
+        return m_resources->m_mailboxes[label].add(mbox, mode);
     }
 
     /**
      * @brief Unregister a Mailbox instance as a receiver for a particular label
      */
-    bool UnregisterForLabel(msglib::Label label, Mailbox *mbox) {
+    bool UnregisterForLabel(msglib::Label label, MailboxBase *mbox) {
         std::lock_guard<std::mutex> lock(m_mutex);
         if (!m_initialized) {
-            Initialize();
+            initializeLocked(Options());
+        }
+        if (!m_resources || label >= m_resources->m_mailboxes.size()) {
+            return false;
         }
         m_resources->m_mailboxes[label].remove(mbox);
         return true;
     }
 
+    /**
+     * @brief Subscribe a Mailbox instance to every label in [first, last] matching a mask. The
+     *        subscription takes one entry in the Subscriptions table and one bit in each matching
+     *        label's Receivers, set in a single pass under the lock, rather than a receiver slot
+     *        per label.
+     *
+     * @return false - first > last, first is outside the configured range, value has bits outside
+     *                 the mask, the subscription already exists or the Subscriptions table is full
+     */
+    bool RegisterForLabels(const Subscription &subscription) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (!m_initialized) {
+            initializeLocked(Options());
+        }
+        if (!m_resources || subscription.m_first > subscription.m_last ||
+            subscription.m_first >= m_resources->m_mailboxes.size() || (subscription.m_value & ~subscription.m_mask) != 0 ||
+            m_resources->m_subscriptions.find(subscription) != MAX_SUBSCRIPTIONS) {
+            return false;
+        }
+        const size_t index = m_resources->m_subscriptions.add(subscription);
+        if (index == MAX_SUBSCRIPTIONS) {
+            return false;
+        }
+        updateSubscribed(subscription, 1U << index, true);
+        return true;
+    }
+
+    /**
+     * @brief Cancel a subscription made by RegisterForLabels()
+     *
+     * @return false - no such subscription
+     */
+    bool UnregisterForLabels(const Subscription &subscription) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (!m_resources) {
+            return false;
+        }
+        const size_t index = m_resources->m_subscriptions.find(subscription);
+        if (index == MAX_SUBSCRIPTIONS) {
+            return false;
+        }
+        updateSubscribed(subscription, 1U << index, false);
+        m_resources->m_subscriptions.remove(index);
+        return true;
+    }
+
+    /**
+     * @brief Get the label range and mask subscriptions referred to by Receivers::m_subscribed
+     */
+    const Subscriptions &GetSubscriptions() {
+        static const Subscriptions NONE {};
+        if (!m_resources) {
+            return NONE;
+        }
+        return m_resources->m_subscriptions;
+    }
+
     /**
      * @brief Get the registered receivers for the specified label
      *
-     * @return Receivers&
+     * @return const Receivers& - receivers, which are empty for labels that are out of range
+     *                            or if not yet initialized
      */
-    Receivers &GetReceivers(msglib::Label label) {
+    const Receivers &GetReceivers(msglib::Label label) {
+        static const Receivers NONE {};
+        if (!m_resources || label >= m_resources->m_mailboxes.size()) {
+            return NONE;
+        }
         return m_resources->m_mailboxes[label];
     }
 
@@ -187,7 +380,7 @@ public:
             Initialize();
         }
         try {
-            return m_resources->m_smallPool.alloc();
+            return m_resources->allocate(&PoolPartition::m_smallPool);
         }
         catch (std::exception &) {
             return detail::DataBlock();
@@ -200,7 +393,7 @@ public:
      */
     void freeSmall(std::byte *msg) {
         if (m_resources) {
-            m_resources->m_smallPool.free(msg);
+            m_resources->owner(msg).m_smallPool.free(msg);
         }
     }
 
@@ -214,7 +407,7 @@ public:
             Initialize();
         }
         try {
-            return m_resources->m_largePool.alloc();
+            return m_resources->allocate(&PoolPartition::m_largePool);
         }
         catch (std::exception &) {
             return detail::DataBlock();
@@ -228,8 +421,309 @@ public:
      */
     void freeLarge(std::byte *msg) {
         if (m_resources) {
-            m_resources->m_largePool.free(msg);
+            m_resources->owner(msg).m_largePool.free(msg);
+        }
+    }
+
+    /**
+     * @brief Allocate a chain of linked "large" blocks with enough room for size bytes of
+     *        message data. Each block's ChainHeader records its share of the data.
+     *
+     * @param size - total size of the message data
+     * @return std::byte* - first block in the chain, or nullptr if the pool is exhausted
+     */
+    std::byte *allocateChain(size_t size) {
+        if (largeSize() <= CHAIN_HEADER_SIZE) {
+            return nullptr;
+        }
+        const size_t chunk = largeSize() - CHAIN_HEADER_SIZE;
+        std::byte *head = nullptr;
+        ChainHeader *tail = nullptr;
+        while (size > 0) {
+            auto db = allocateLarge();
+            if (db.get() == nullptr) {
+                freeChain(head);
+                return nullptr;
+            }
+            const size_t length = (size < chunk) ? size : chunk;
+            auto *header = new (db.get()) ChainHeader {nullptr, length};
+            if (tail != nullptr) {
+                tail->m_next = db.get();
+            } else {
+                head = db.get();
+            }
+            tail = header;
+            size -= length;
+        }
+        return head;
+    }
+
+    /**
+     * @brief Free each "large" block in a chain
+     *
+     * @param head - first block in the chain
+     */
+    void freeChain(std::byte *head) {
+        while (head != nullptr) {
+            std::byte *next = ChainHeaderOf(head)->m_next;
+            freeLarge(head);
+            head = next;
+        }
+    }
+
+    /**
+     * @brief Allocate data block(s) for a message and copy its data into them. Data up to
+     *        smallSize() goes to the "small" pool, up to largeSize() to the "large" pool and
+     *        anything larger to a chain of "large" blocks.
+     *
+     * @param label - the message label
+     * @param segments - ranges of bytes making up the message data
+     * @param count - number of ranges
+     * @param size - total size of the message data in bytes
+     * @param msg - resulting message, which must be released with releaseMessage()
+     * @return true - message was allocated
+     * @return false - message too large or pool capacity reached
+     */
+    bool allocateMessage(Label label, const ByteSpan *segments, size_t count, size_t size, Message &msg) {
+        if (size == 0) {
+            // Nothing to copy, so deliver as an empty message without a data block
+            msg = Message(label);
+            return true;
+        }
+        if (size > std::numeric_limits<uint32_t>::max()) {
+            return false;
+        }
+        SegmentCursor cursor(segments, count);
+        if (size > largeSize()) {
+            std::byte *head = allocateChain(size);
+            if (head == nullptr) {
+                return false;
+            }
+            for (std::byte *block = head; block != nullptr; block = ChainHeaderOf(block)->m_next) {
+                cursor.copy(ChainPayload(block), ChainHeaderOf(block)->m_length);
+            }
+            msg = Message(label, static_cast<uint32_t>(size), head, Message::CHAINED);
+            return true;
+        }
+        auto db = (size > smallSize()) ? allocateLarge() : allocateSmall();
+        if (db.get() == nullptr) {
+            return false;
+        }
+        cursor.copy(db.get(), size);
+        msg = Message(label, static_cast<uint32_t>(size), db.get());
+        return true;
+    }
+
+    /**
+     * @brief Choose the pool for message data of a fixed size, initializing with the default
+     *        options if necessary
+     *
+     * @param size - data size
+     * @param pool - set to the pool whose blocks fit the data
+     * @return false - the data doesn't fit in a "large" block
+     */
+    bool poolFor(size_t size, PoolClass &pool) {
+        if (!m_initialized) {
+            Initialize();
+        }
+        if (size > largeSize()) {
+            return false;
+        }
+        pool = (size > smallSize()) ? PoolClass::LARGE : PoolClass::SMALL;
+        return true;
+    }
+
+    /**
+     * @brief Allocate a data block from a pool already chosen by poolFor() and copy the message
+     *        data into it, without checking its size again
+     *
+     * @param label - the message label
+     * @param data - message data
+     * @param size - data size, as passed to poolFor()
+     * @param pool - pool chosen by poolFor()
+     * @param msg - resulting message, which must be released with releaseMessage() or freeBlock()
+     * @return false - pool capacity reached
+     */
+    bool allocateBlock(Label label, const void *data, uint32_t size, PoolClass pool, Message &msg) {
+        auto db = (pool == PoolClass::LARGE) ? allocateLarge() : allocateSmall();
+        if (db.get() == nullptr) {
+            return false;
+        }
+        memcpy(db.get(), data, size);
+        msg = Message(label, size, db.get());
+        return true;
+    }
+
+    /**
+     * @brief Free a data block allocated by allocateBlock()
+     */
+    void freeBlock(std::byte *block, PoolClass pool) {
+        if (pool == PoolClass::LARGE) {
+            freeLarge(block);
+        } else {
+            freeSmall(block);
+        }
+    }
+
+    /**
+     * @brief Allocate a data block and construct an object of type T in it from arg. Types using
+     *        a pmr allocator are given a "large" block, the rest of which serves their nested
+     *        allocations; other types the smallest block they fit in.
+     *
+     * @param label - the message label
+     * @param arg - value to copy or move from
+     * @param msg - resulting message, which must be released with releaseMessage()
+     * @return false - T doesn't fit in a block, pool capacity reached or T's constructor threw
+     */
+    template <class T, class Arg>
+    bool allocateObject(Label label, Arg &&arg, Message &msg) {
+        constexpr size_t size = OBJECT_BLOCK_SIZE<T>;
+        if (size > largeSize()) {
+            return false;
+        }
+        const bool large = USES_POOL_ALLOCATOR<T> || size > smallSize();
+        auto db = large ? allocateLarge() : allocateSmall();
+        if (db.get() == nullptr) {
+            return false;
+        }
+        if (!ConstructObject<T>(db.get(), db.size(), std::forward<Arg>(arg))) {
+            large ? freeLarge(db.get()) : freeSmall(db.get());
+            return false;
+        }
+        msg = Message(label, static_cast<uint32_t>(db.size()), db.get(), Message::OBJECT);
+        return true;
+    }
+
+    /**
+     * @brief Allocate a shared block (see Message::SHARED) holding a copy of some data, with one
+     *        reference held by the caller
+     *
+     * @param data - data to copy
+     * @param size - data size
+     * @return std::byte* - the block's data, or nullptr if it doesn't fit in a block or pool
+     *                      capacity was reached
+     */
+    std::byte *allocateShared(const void *data, uint32_t size) {
+        if (!m_initialized) {
+            Initialize();
+        }
+        const size_t blockSize = SHARED_HEADER_SIZE + size;
+        if (blockSize > largeSize()) {
+            return nullptr;
+        }
+        const bool large = blockSize > smallSize();
+        auto db = large ? allocateLarge() : allocateSmall();
+        if (db.get() == nullptr) {
+            return nullptr;
+        }
+        new (db.get()) SharedHeader {{1}, large};
+        std::byte *shared = db.get() + SHARED_HEADER_SIZE;
+        if (size > 0) {
+            memcpy(shared, data, size);
+        }
+        return shared;
+    }
+
+    /**
+     * @brief Make a message referring to a shared block's data, adding a reference
+     *
+     * @param label - the message label
+     * @param shared - data of a block allocated by allocateShared()
+     * @param size - data size
+     * @param msg - resulting message, which must be released with releaseMessage()
+     */
+    bool shareBlock(Label label, std::byte *shared, uint32_t size, Message &msg) {
+        SharedHeaderOf(shared)->m_refs.fetch_add(1, std::memory_order_relaxed);
+        msg = Message(label, size, shared, Message::SHARED);
+        return true;
+    }
+
+    /**
+     * @brief Drop a reference to a shared block, freeing it with the last
+     *
+     * @param shared - data of a block allocated by allocateShared()
+     */
+    void releaseShared(std::byte *shared) {
+        SharedHeader *header = SharedHeaderOf(shared);
+        if (header->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            const bool large = header->m_large;
+            header->~SharedHeader();
+            auto *block = reinterpret_cast<std::byte *>(header);
+            large ? freeLarge(block) : freeSmall(block);
+        }
+    }
+
+    /**
+     * @brief Allocate a data block for a request message, holding the request data followed by
+     *        the CallTrailer identifying the caller
+     *
+     * @param label - the message label
+     * @param data - request data
+     * @param trailer - identifies the caller's correlation slot
+     * @param msg - resulting message, which must be released with releaseMessage()
+     * @return false - request too large or pool capacity reached
+     */
+    bool allocateRequest(Label label, ByteSpan data, const CallTrailer &trailer, Message &msg) {
+        const size_t blockSize = CallBlockSize(data.size());
+        if (blockSize > largeSize()) {
+            return false;
+        }
+        auto db = (blockSize > smallSize()) ? allocateLarge() : allocateSmall();
+        if (db.get() == nullptr) {
+            return false;
+        }
+        if (!data.empty()) {
+            memcpy(db.get(), data.data(), data.size());
+        }
+        memcpy(db.get() + CallTrailerOffset(data.size()), &trailer, sizeof(trailer));
+        msg = Message(label, static_cast<uint32_t>(data.size()), db.get(), Message::REQUEST);
+        return true;
+    }
+
+    /**
+     * @brief Return the correlation slots for Mailbox::Call(), or nullptr if not initialized
+     */
+    CallSlots *calls() {
+        if (!m_initialized) {
+            Initialize();
+        }
+        return m_resources ? &m_resources->m_calls : nullptr;
+    }
+
+    /**
+     * @brief Release the data block(s) associated with a message
+     *
+     * @param msg - message to be released
+     */
+    void releaseMessage(const Message &msg) {
+        if (msg.m_data != nullptr) {
+            if (msg.shared()) {
+                releaseShared(msg.m_data);
+                return;
+            }
+            if (msg.object()) {
+                auto *header = reinterpret_cast<ObjectHeader *>(msg.m_data);
+                header->m_destroy(header);
+            }
+            const size_t blockSize = msg.request() ? CallBlockSize(msg.m_size) : msg.m_size;
+            if (msg.chained()) {
+                freeChain(msg.m_data);
+            } else if (blockSize <= smallSize()) {
+                freeSmall(msg.m_data);
+            } else {
+                freeLarge(msg.m_data);
+            }
+        }
+    }
+
+    /**
+     * @brief Return the number of pool partitions (one per NUMA node when NUMA-local pools are enabled)
+     */
+    size_t numaPartitions() const {
+        if (m_resources) {
+            return m_resources->m_partitions.size();
         }
+        return 0;
     }
 
     size_t smallSize() const {
@@ -246,16 +740,77 @@ public:
         return 0;
     }
 
+    /**
+     * @brief Return the number of labels which can be used
+     */
+    size_t maxLabels() const {
+        if (m_resources) {
+            return m_resources->m_mailboxes.size();
+        }
+        return 0;
+    }
+
 private:
+    /**
+     * @brief Allocate shared resources, with m_mutex held
+     *
+     * @return false - already initialized or allocation failed
+     */
+    bool initializeLocked(const Options &options) {
+        if (m_initialized) {
+            return false;
+        }
+        try {
+            SetDefaultArenaConfig(ArenaConfig::FromOptions(options));
+            m_resources = std::make_unique<Resources>(options);
+            m_initialized = true;
+        } catch (std::exception &e) {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Set or clear a subscription's bit in the Receivers of each configured label it
+     *        matches, with m_mutex held. Matching labels are enumerated directly (value plus each combination of
+     *        the bits outside the mask, in increasing order) rather than tested one by one.
+     */
+    void updateSubscribed(const Subscription &subscription, uint32_t bit, bool set) {
+        auto update = [this, bit, set](size_t label) {
+            auto &receivers = m_resources->m_mailboxes[label];
+            receivers.m_subscribed = set ? (receivers.m_subscribed | bit) : (receivers.m_subscribed & ~bit);
+        };
+        const size_t last = std::min<size_t>(subscription.m_last, m_resources->m_mailboxes.size() - 1);
+        if (subscription.m_mask == 0) {
+            for (size_t label = subscription.m_first; label <= last; label++) {
+                update(label);
+            }
+            return;
+        }
+        const auto free = static_cast<uint16_t>(~subscription.m_mask);
+        uint16_t bits = 0;
+        do {
+            const auto label = static_cast<uint16_t>(subscription.m_value | bits);
+            if (label > last) {
+                break;
+            }
+            if (label >= subscription.m_first) {
+                update(label);
+            }
+            bits = static_cast<uint16_t>((bits - free) & free);
+        } while (bits != 0);
+    }
+
     /**
      * @brief Mutex protecting Mailbox resources
      */
     std::mutex m_mutex;
 
     /**
-     * @brief State information for mailbox registration
+     * @brief State information for mailbox registration. Written with m_mutex held, but read
+     *        without it (e.g. by poolFor() and the allocators), after which m_resources is used.
      */
-    bool m_initialized = false;
+    std::atomic<bool> m_initialized {false};
 
     /**
      * @brief Dynamically allocated resources
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+namespace msglib::detail {
+
+/**
+ * @brief Bounded lock-free multi-producer/multi-consumer queue. Each slot carries a sequence
+ *        number which tells producers and consumers whether it is ready to be written or read,
+ *        so a push or pop is a single compare-and-swap on the shared position plus a release
+ *        store of the slot's sequence number. The slot array is allocated once at construction.
+ *
+ *        This queue never blocks; waiting is left to the caller (see BlockingWait, SpinWait).
+ *
+ * @tparam T - data type for elements in the queue
+ */
+template <class T>
+class MpmcQueue {
+public:
+    /**
+     * @brief Queue element together with its sequence number
+     */
+    struct Slot {
+        std::atomic<size_t> m_seq;
+        T m_value;
+    };
+
+    /**
+     * @brief Construct a new MpmcQueue object with specified capacity. A capacity of 1 is
+     *        raised to 2: with a single slot, the sequence number of a full slot is the same as
+     *        that of an empty slot one lap later, so pushes would overwrite it and pops spin.
+     *
+     * @param cap - queue capacity
+     * @param resource - memory resource from which the slots are allocated
+     */
+    MpmcQueue(size_t cap, std::pmr::memory_resource *resource)
+        : m_alloc(resource), m_capacity((cap < 2) ? 2 : cap), m_slots(m_alloc.allocate(m_capacity)) {
+        for (size_t i = 0; i < m_capacity; i++) {
+            new (&m_slots[i]) Slot {{i}, T()};
+        }
+    }
+
+    ~MpmcQueue() {
+        for (size_t i = 0; i < m_capacity; i++) {
+            m_slots[i].~Slot();
+        }
+        m_alloc.deallocate(m_slots, m_capacity);
+    }
+
+    // Disallow copy and move constructors
+    MpmcQueue(const MpmcQueue &other) = delete;
+    MpmcQueue(MpmcQueue &&other) = delete;
+
+    // Disallow asignment and move assignment
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(MpmcQueue &&) = delete;
+
+    /**
+     * @brief Push a new value onto the queue if there is available space
+     *
+     * @param value - value to be pushed on the queue
+     * @return true - value added successfully
+     * @return false - queue full
+     */
+    bool tryPush(const T &value) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = m_slots[pos % m_capacity];
+            const size_t seq = slot.m_seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.m_value = value;
+                    slot.m_seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Try to pop a value off of the queue, returning false if the queue is empty
+     *
+     * @param value - value returned from the queue
+     * @return true - value was returned from the queue
+     * @return false - queue is empty
+     */
+    bool tryPop(T &value) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = m_slots[pos % m_capacity];
+            const size_t seq = slot.m_seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = slot.m_value;
+                    slot.m_seq.store(pos + m_capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Return true if the queue is empty
+     */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Return the (approximate, if there are concurrent operations) queue size
+     */
+    size_t size() const {
+        const size_t dequeuePos = m_dequeuePos.load(std::memory_order_acquire);
+        const size_t enqueuePos = m_enqueuePos.load(std::memory_order_acquire);
+        return (enqueuePos > dequeuePos) ? enqueuePos - dequeuePos : 0;
+    }
+
+    /**
+     * @brief Return the queue capacity
+     */
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+private:
+    /**
+     * @brief Polymorphic allocator for the slot array
+     */
+    std::pmr::polymorphic_allocator<Slot> m_alloc;
+
+    /**
+     * @brief Capacity of the queue
+     */
+    size_t m_capacity;
+
+    /**
+     * @brief Slot array
+     */
+    Slot *m_slots;
+
+    /**
+     * @brief Position of the next push; shared by producers
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueuePos {0};
+
+    /**
+     * @brief Position of the next pop; shared by consumers
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeuePos {0};
+};
+
+}  // namespace msglib::detail
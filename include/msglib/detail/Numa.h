@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace msglib::detail {
+
+/**
+ * @brief Maximum number of NUMA nodes supported for node-local pools
+ */
+static constexpr size_t MAX_NUMA_NODES = 64;
+
+/**
+ * @brief Return the number of possible NUMA nodes (1 if NUMA isn't supported)
+ *
+ * @return size_t - highest possible node id + 1
+ */
+inline size_t NumaNodeCount() {
+    FILE *fp = fopen("/sys/devices/system/node/possible", "r");
+    if (fp == nullptr) {
+        return 1;
+    }
+    char buf[256] = {};  // NOLINT
+    size_t count = 1;
+    if (fgets(buf, sizeof(buf), fp) != nullptr) {
+        // Format is a list of ranges (e.g. "0", "0-1", "0,2-3"); the last number is the highest node id
+        char *ptr = buf;
+        while (*ptr != '\0') {
+            char *end = nullptr;
+            unsigned long node = strtoul(ptr, &end, 10);  // NOLINT
+            if (end == ptr) {
+                ptr++;
+            } else {
+                count = node + 1;
+                ptr = end;
+            }
+        }
+    }
+    fclose(fp);
+    return (count < MAX_NUMA_NODES) ? count : MAX_NUMA_NODES;
+}
+
+/**
+ * @brief Return the nodes in order of their distance from a node (as reported by the kernel in
+ *        /sys/devices/system/node/node<N>/distance), starting with the node itself. Nodes whose
+ *        distance can't be read follow in order of their ids.
+ *
+ * @param node - NUMA node to measure from
+ * @param nodes - number of nodes, as returned by NumaNodeCount()
+ * @return std::vector<size_t> - node ids, nearest first
+ */
+inline std::vector<size_t> NumaNodesByDistance(size_t node, size_t nodes) {
+    std::vector<unsigned long> distance(nodes, static_cast<unsigned long>(-1));  // NOLINT
+    char path[64] = {};  // NOLINT
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/distance", node);
+    FILE *fp = fopen(path, "r");
+    if (fp != nullptr) {
+        char buf[1024] = {};  // NOLINT
+        if (fgets(buf, sizeof(buf), fp) != nullptr) {
+            // Format is one distance per node, separated by spaces (e.g. "10 21")
+            char *ptr = buf;
+            for (size_t i = 0; i < nodes; i++) {
+                char *end = nullptr;
+                const unsigned long value = strtoul(ptr, &end, 10);  // NOLINT
+                if (end == ptr) {
+                    break;
+                }
+                distance[i] = value;
+                ptr = end;
+            }
+        }
+        fclose(fp);
+    }
+    std::vector<size_t> order(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [node, &distance](size_t lhs, size_t rhs) {
+        if ((lhs == node) != (rhs == node)) {
+            return lhs == node;
+        }
+        return distance[lhs] < distance[rhs];
+    });
+    return order;
+}
+
+/**
+ * @brief Return the NUMA node of the CPU the calling thread is running on
+ *
+ * @return size_t - NUMA node, or 0 if it can't be determined
+ */
+inline size_t CurrentNumaNode() {
+    unsigned cpu = 0;
+    unsigned node = 0;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+    if (getcpu(&cpu, &node) != 0) {
+        return 0;
+    }
+#else
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return 0;
+    }
+#endif
+    return node;
+}
+
+/**
+ * @brief Set the memory policy of a page-aligned range so that its pages are placed on a
+ *        particular NUMA node when first touched. MPOL_PREFERRED is used so that allocation
+ *        falls back to other nodes rather than failing if the node runs out of memory.
+ *
+ * @param addr - page-aligned start of the range
+ * @param len - length of the range
+ * @param node - NUMA node
+ * @return true - memory policy applied
+ * @return false - failure (e.g. NUMA not supported by the kernel)
+ */
+inline bool BindToNumaNode(void *addr, size_t len, size_t node) {
+    if (node >= MAX_NUMA_NODES) {
+        return false;
+    }
+    unsigned long nodemask = 1UL << node;  // NOLINT
+    return syscall(SYS_mbind, addr, len, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8 + 1, 0) == 0;
+}
+
+}  // namespace msglib::detail
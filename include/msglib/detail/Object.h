@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace msglib::detail {
+
+/**
+ * @brief ObjectHeader starts the data block of a message carrying an object (see
+ *        Message::OBJECT). The object follows it, and for types which use a pmr allocator a
+ *        monotonic_buffer_resource over the rest of the block follows the object, so that the
+ *        object's nested allocations are made inside the block rather than on the heap.
+ */
+struct ObjectHeader {
+    /**
+     * @brief Destroys the object, and its memory resource if any
+     */
+    void (*m_destroy)(ObjectHeader *);
+
+    /**
+     * @brief Identifies the object's type (the address of TYPE_TAG<T>)
+     */
+    const void *m_type;
+
+    void *m_object;
+
+    std::pmr::monotonic_buffer_resource *m_resource;
+};
+
+/**
+ * @brief Type tag whose address identifies T. It isn't const, so that identical code/data folding
+ *        can't merge the tags of different types (as it can merge DestroyObject<T> thunks with the
+ *        same code), and its vague linkage gives it a single address across shared objects.
+ */
+template <class T>
+inline char TYPE_TAG = 0;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+/**
+ * @brief Return true if T is constructed with a pmr allocator over the rest of its data block
+ */
+template <class T>
+inline constexpr bool USES_POOL_ALLOCATOR = std::uses_allocator_v<T, std::pmr::polymorphic_allocator<std::byte>>;
+
+inline constexpr size_t AlignUp(size_t offset, size_t alignment) {
+    return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+/**
+ * @brief Offset of an object of type T within its data block
+ */
+template <class T>
+inline constexpr size_t OBJECT_OFFSET = AlignUp(sizeof(ObjectHeader), alignof(T));
+
+/**
+ * @brief Offset of the memory resource for an object of type T within its data block
+ */
+template <class T>
+inline constexpr size_t RESOURCE_OFFSET = AlignUp(OBJECT_OFFSET<T> + sizeof(T), alignof(std::pmr::monotonic_buffer_resource));
+
+/**
+ * @brief Minimum size of the data block for an object of type T (not counting room for its
+ *        nested allocations)
+ */
+template <class T>
+inline constexpr size_t OBJECT_BLOCK_SIZE =
+    USES_POOL_ALLOCATOR<T> ? (RESOURCE_OFFSET<T> + sizeof(std::pmr::monotonic_buffer_resource)) : (OBJECT_OFFSET<T> + sizeof(T));
+
+/**
+ * @brief Destroy thunk for an object of type T
+ */
+template <class T>
+void DestroyObject(ObjectHeader *header) {
+    static_cast<T *>(header->m_object)->~T();
+    if (header->m_resource != nullptr) {
+        header->m_resource->~monotonic_buffer_resource();
+    }
+}
+
+/**
+ * @brief Construct an object of type T from arg in a data block
+ *
+ * @param block - data block of at least OBJECT_BLOCK_SIZE<T> bytes
+ * @param blockSize - size of the data block
+ * @param arg - value to copy or move from
+ * @return false - T's constructor threw (e.g. its nested allocations didn't fit in the block)
+ */
+template <class T, class Arg>
+bool ConstructObject(std::byte *block, size_t blockSize, Arg &&arg) {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "Message objects can't be over-aligned");
+    auto *header = new (block) ObjectHeader {&DestroyObject<T>, &TYPE_TAG<T>, block + OBJECT_OFFSET<T>, nullptr};
+    try {
+        if constexpr (USES_POOL_ALLOCATOR<T>) {
+            std::byte *buffer = block + RESOURCE_OFFSET<T> + sizeof(std::pmr::monotonic_buffer_resource);
+            header->m_resource = new (block + RESOURCE_OFFSET<T>) std::pmr::monotonic_buffer_resource(
+                buffer, blockSize - (RESOURCE_OFFSET<T> + sizeof(std::pmr::monotonic_buffer_resource)),
+                std::pmr::null_memory_resource());
+            // Uses-allocator construction passes the allocator on to T's constructor
+            std::pmr::polymorphic_allocator<T> alloc(header->m_resource);
+            alloc.construct(static_cast<T *>(header->m_object), std::forward<Arg>(arg));
+        } else {
+            new (header->m_object) T(std::forward<Arg>(arg));
+        }
+    } catch (...) {
+        if (header->m_resource != nullptr) {
+            header->m_resource->~monotonic_buffer_resource();
+        }
+        return false;
+    }
+    return true;
+}
+
+}  // namespace msglib::detail
@@ -4,44 +4,163 @@
 #include <cstdint>
 
 namespace msglib {
-class Mailbox;
+class MailboxBase;
+
+/**
+ * @brief How a mailbox subscribes to a label
+ */
+enum class Mode : uint8_t {
+    /**
+     * @brief Receive a copy of every message sent with the label
+     */
+    Broadcast,
+
+    /**
+     * @brief Join the label's competing-consumer group, whose members share the messages sent
+     *        with the label so that each message is received by exactly one of them
+     */
+    Shared
+};
 
 namespace detail {
 static constexpr size_t MAX_RECEIVERS = 3;
+
 /**
- * @brief Receivers is a struct holding up to X (default 3) mailbox receivers for a particular event label
+ * @brief Maximum number of members of a label's shared (competing-consumer) group
  */
-struct Receivers {
-    std::array<Mailbox *, MAX_RECEIVERS> m_receivers;
+static constexpr size_t MAX_SHARED_RECEIVERS = 16;
+
+/**
+ * @brief Mix the bits of a 64-bit value (the splitmix64 finalizer), giving a well-distributed
+ *        hash of keys which may themselves be poorly distributed (e.g. sequential IDs)
+ */
+inline uint64_t MixHash(uint64_t value) {
+    value ^= value >> 30U;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27U;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31U;
+    return value;
+}
 
+/**
+ * @brief Maximum number of label range and mask subscriptions
+ */
+static constexpr size_t MAX_SUBSCRIPTIONS = 32;
+
+/**
+ * @brief A mailbox's subscription to every label in [m_first, m_last] for which
+ *        (label & m_mask) == m_value
+ */
+struct Subscription {
+    MailboxBase *m_mbox;
+    uint16_t m_first;
+    uint16_t m_last;
+    uint16_t m_mask;
+    uint16_t m_value;
+
+    [[nodiscard]] bool matches(uint16_t label) const {
+        return label >= m_first && label <= m_last && (label & m_mask) == m_value;
+    }
+
+    [[nodiscard]] bool operator==(const Subscription &rhs) const {
+        return m_mbox == rhs.m_mbox && m_first == rhs.m_first && m_last == rhs.m_last && m_mask == rhs.m_mask &&
+            m_value == rhs.m_value;
+    }
+};
+
+/**
+ * @brief Subscriptions is the table of label range and mask subscriptions. Each label's Receivers
+ *        has a bit set for every subscription matching it, so that senders find a label's
+ *        subscribers without searching this table.
+ */
+class Subscriptions {
+public:
     /**
-     * @brief Construct a new Receivers object
+     * @brief Add a subscription
+     *
+     * @return size_t - index of the subscription, or MAX_SUBSCRIPTIONS if the table is full
      */
-    Receivers() : m_receivers({nullptr, nullptr, nullptr}) {
+    size_t add(const Subscription &subscription) {
+        for (size_t i = 0; i < MAX_SUBSCRIPTIONS; i++) {
+            if (m_table[i].m_mbox == nullptr) {
+                m_table[i] = subscription;
+                return i;
+            }
+        }
+        return MAX_SUBSCRIPTIONS;
     }
 
-    Receivers &operator=(const Receivers &rhs) {
-        if (&rhs != this) {
-            m_receivers = rhs.m_receivers;
+    /**
+     * @brief Find a subscription
+     *
+     * @return size_t - index of the subscription, or MAX_SUBSCRIPTIONS if there is none
+     */
+    [[nodiscard]] size_t find(const Subscription &subscription) const {
+        for (size_t i = 0; i < MAX_SUBSCRIPTIONS; i++) {
+            if (m_table[i].m_mbox != nullptr && m_table[i] == subscription) {
+                return i;
+            }
         }
-        return *this;
+        return MAX_SUBSCRIPTIONS;
     }
 
+    void remove(size_t index) {
+        m_table[index] = Subscription {};
+    }
+
+    [[nodiscard]] const Subscription &operator[](size_t index) const {
+        return m_table[index];
+    }
+
+private:
+    std::array<Subscription, MAX_SUBSCRIPTIONS> m_table {};
+};
+
+/**
+ * @brief Receivers is a struct holding up to X (default 3) mailbox receivers for a particular event label,
+ *        plus a group of up to MAX_SHARED_RECEIVERS mailboxes sharing the label's messages.
+ *        It is a trivial type so that tables of Receivers can be committed lazily; a zero-initialized
+ *        (e.g. `Receivers r {};`) instance has no receivers.
+ */
+struct Receivers {
+    std::array<MailboxBase *, MAX_RECEIVERS> m_receivers;
+
+    /**
+     * @brief Members of the shared group
+     */
+    std::array<MailboxBase *, MAX_SHARED_RECEIVERS> m_shared;
+
+    /**
+     * @brief Index of the shared group member to be offered the next message. Protected by the
+     *        shared mailbox mutex like the rest of the routing table.
+     */
+    mutable uint32_t m_next;
+
+    /**
+     * @brief Bit i is set if subscription i in the Subscriptions table matches this label
+     */
+    uint32_t m_subscribed;
+
     /**
      * @brief Add a receiver for this label
      *
      * @param mbox - receiver to be added
+     * @param mode - whether to receive every message or join the shared group
      * @return true - receiver was added successfully
      * @return false - receiver was not added (capacity reached)
      */
-    bool add(Mailbox *mbox) {
-        for (auto &r : m_receivers) {
-            if (r == nullptr) {
-                r = mbox;
-                return true;
+    bool add(MailboxBase *mbox, Mode mode = Mode::Broadcast) {
+        auto add = [mbox](auto &receivers) {
+            for (auto &r : receivers) {
+                if (r == nullptr) {
+                    r = mbox;
+                    return true;
+                }
             }
-        }
-        return false;
+            return false;
+        };
+        return (mode == Mode::Shared) ? add(m_shared) : add(m_receivers);
     }
 
     /**
@@ -51,7 +170,7 @@ struct Receivers {
      * @return true - this was the last receiver for this label
      * @return false - one or more receivers remain for this label
      */
-    bool remove(Mailbox *mbox) {
+    bool remove(MailboxBase *mbox) {
         bool remove = true;
         for (size_t i = 0; i < MAX_RECEIVERS; i++) {
             if (m_receivers[i] == mbox) {
@@ -60,9 +179,126 @@ struct Receivers {
             // If no mailboxes remain for this label then it should be removed
             remove &= (m_receivers[i] == nullptr);
         }
-        return remove;
+        for (auto &r : m_shared) {
+            if (r == mbox) {
+                r = nullptr;
+            }
+            remove &= (r == nullptr);
+        }
+        return remove && m_subscribed == 0;
+    }
+
+    /**
+     * @brief Return the mailbox of subscription index if it matches this label and isn't already
+     *        receiving the label's messages, either as a broadcast receiver or by an earlier
+     *        subscription, otherwise nullptr
+     */
+    [[nodiscard]] MailboxBase *subscriber(const Subscriptions &subscriptions, size_t index) const {
+        if ((m_subscribed & (1U << index)) == 0) {
+            return nullptr;
+        }
+        MailboxBase *mbox = subscriptions[index].m_mbox;
+        for (const auto *r : m_receivers) {
+            if (r == mbox) {
+                return nullptr;
+            }
+        }
+        for (size_t i = 0; i < index; i++) {
+            if ((m_subscribed & (1U << i)) != 0 && subscriptions[i].m_mbox == mbox) {
+                return nullptr;
+            }
+        }
+        return mbox;
+    }
+
+    /**
+     * @brief Call fn for each mailbox receiving a copy of every message with this label: the
+     *        broadcast receivers, then the subscribers
+     */
+    template <class Fn>
+    void forEachReceiver(const Subscriptions &subscriptions, Fn &&fn) const {
+        for (auto *r : m_receivers) {
+            if (r != nullptr) {
+                fn(r);
+            }
+        }
+        for (uint32_t bits = m_subscribed; bits != 0; bits &= bits - 1) {
+            MailboxBase *r = subscriber(subscriptions, static_cast<size_t>(__builtin_ctz(bits)));
+            if (r != nullptr) {
+                fn(r);
+            }
+        }
+    }
+
+    /**
+     * @brief Return true if the shared group has any members
+     */
+    [[nodiscard]] bool hasShared() const {
+        for (const auto *r : m_shared) {
+            if (r != nullptr) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Return the shared group member due to be offered the next message, or nullptr
+     */
+    [[nodiscard]] MailboxBase *nextShared() const {
+        for (size_t i = 0; i < MAX_SHARED_RECEIVERS; i++) {
+            MailboxBase *r = m_shared[(m_next + i) % MAX_SHARED_RECEIVERS];
+            if (r != nullptr) {
+                return r;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Return the shared group member which owns a key, or nullptr if there are no members.
+     *        Ownership is decided by rendezvous (highest random weight) hashing, so when a member
+     *        leaves only its keys move, and a member joining only takes over keys from others.
+     *
+     * @param key - partitioning key
+     */
+    [[nodiscard]] MailboxBase *partition(uint64_t key) const {
+        MailboxBase *owner = nullptr;
+        uint64_t best = 0;
+        const uint64_t hash = MixHash(key);
+        for (auto *r : m_shared) {
+            if (r == nullptr) {
+                continue;
+            }
+            const uint64_t weight = MixHash(hash ^ reinterpret_cast<uintptr_t>(r));
+            if (owner == nullptr || weight > best) {
+                owner = r;
+                best = weight;
+            }
+        }
+        return owner;
+    }
+
+    /**
+     * @brief Offer a message to the shared group round-robin, moving on past members whose
+     *        queues are full, until one accepts it
+     *
+     * @param deliver - callable taking a MailboxBase* and returning true if it accepted the message
+     * @return true - a member accepted the message
+     * @return false - no members, or every member's queue is full
+     */
+    template <class Deliver>
+    bool deliverShared(Deliver &&deliver) const {
+        for (size_t i = 0; i < MAX_SHARED_RECEIVERS; i++) {
+            const size_t index = (m_next + i) % MAX_SHARED_RECEIVERS;
+            if (m_shared[index] != nullptr && deliver(m_shared[index])) {
+                m_next = static_cast<uint32_t>((index + 1) % MAX_SHARED_RECEIVERS);
+                return true;
+            }
+        }
+        return false;
     }
 };
 
 }  // namespace detail
-}  // namespace msglib
\ No newline at end of file
+}  // namespace msglib
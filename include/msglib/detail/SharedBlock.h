@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace msglib::detail {
+
+/**
+ * @brief SharedHeader is stored at the start of a reference-counted pool block, whose data is
+ *        delivered to many receivers (e.g. the payload of a timer, on each expiry) without being
+ *        copied. The data follows the header at SHARED_HEADER_SIZE bytes, and the block is freed
+ *        when the last reference is released.
+ */
+struct SharedHeader {
+    /**
+     * @brief Number of references: one for the owner plus one for each message delivered
+     */
+    std::atomic<uint32_t> m_refs;
+
+    /**
+     * @brief True if the block came from the "large" pool
+     */
+    bool m_large;
+};
+
+/**
+ * @brief Offset of the data within a shared block, keeping it suitably aligned
+ */
+static constexpr size_t SHARED_HEADER_SIZE =
+    ((sizeof(SharedHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) * alignof(std::max_align_t);
+
+/**
+ * @brief Return the header of a shared block given its data
+ *
+ * @param data - data of a shared block, as held in Message::m_data
+ * @return SharedHeader* - header at the start of the block
+ */
+inline SharedHeader *SharedHeaderOf(std::byte *data) {
+    return reinterpret_cast<SharedHeader *>(data - SHARED_HEADER_SIZE);
+}
+
+}  // namespace msglib::detail
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "CpuRelax.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+namespace msglib::detail {
+
+/**
+ * @brief Cache line size used to keep producer and consumer state apart
+ */
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Bounded single-producer/single-consumer ring buffer. Exactly one thread may push and
+ *        exactly one thread may pop; the two sides synchronize using only acquire/release loads
+ *        and stores of the head and tail indices (no read-modify-write atomics or locks).
+ *
+ * @tparam T - data type for elements in the queue
+ * @tparam Capacity - number of elements, which must be a power of 2
+ */
+template <class T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of 2");
+
+public:
+    SpscQueue() = default;
+
+    // Disallow copy and move constructors
+    SpscQueue(const SpscQueue &other) = delete;
+    SpscQueue(SpscQueue &&other) = delete;
+
+    // Disallow asignment and move assignment
+    SpscQueue &operator=(const SpscQueue &) = delete;
+    SpscQueue &operator=(SpscQueue &&) = delete;
+
+    /**
+     * @brief Push a new value onto the queue if there is available space (producer only)
+     *
+     * @param value - value to be pushed on the queue
+     * @return true - value added successfully
+     * @return false - queue full
+     */
+    bool tryPush(const T &value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache == Capacity) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache == Capacity) {
+                return false;
+            }
+        }
+        m_ring[tail & MASK] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Try to pop a value off of the queue, returning false if the queue is empty (consumer only)
+     *
+     * @param value - value returned from the queue
+     * @return true - value was returned from the queue
+     * @return false - queue is empty
+     */
+    bool tryPop(T &value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache) {
+                return false;
+            }
+        }
+        value = m_ring[head & MASK];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pop a value off of the queue, spinning (then yielding) until one is available (consumer only)
+     *
+     * @param value - value returned from the queue
+     */
+    void pop(T &value) {
+        unsigned spins = 0;
+        while (!tryPop(value)) {
+            backoff(spins);
+        }
+    }
+
+    /**
+     * @brief Wait for up to a specified duration to pop an element from the queue (consumer only)
+     *
+     * @param value - value returned from the queue
+     * @param duration - how long to wait before returning false
+     * @return true - element was dequeued
+     * @return false - pop() operation timed out
+     */
+    template <class Rep, class Period>
+    bool popWait(T &value, const std::chrono::duration<Rep, Period> &duration) {
+        const auto deadline = std::chrono::steady_clock::now() + duration;
+        unsigned spins = 0;
+        while (!tryPop(value)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            backoff(spins);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Return true if the queue is empty
+     */
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Return the queue size
+     */
+    size_t size() const {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    /**
+     * @brief Return the queue capacity
+     */
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    /**
+     * @brief Number of pause-spins before a waiting consumer starts yielding its timeslice
+     */
+    static constexpr unsigned SPIN_LIMIT = 1024;
+
+    static void backoff(unsigned &spins) {
+        if (spins < SPIN_LIMIT) {
+            spins++;
+            CpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Index of the next element to pop; written only by the consumer
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head {0};
+
+    /**
+     * @brief Consumer's cached copy of m_tail, refreshed only when the queue appears empty
+     */
+    size_t m_tailCache = 0;
+
+    /**
+     * @brief Index of the next element to push; written only by the producer
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail {0};
+
+    /**
+     * @brief Producer's cached copy of m_head, refreshed only when the queue appears full
+     */
+    size_t m_headCache = 0;
+
+    /**
+     * @brief Ring buffer storage
+     */
+    alignas(CACHE_LINE_SIZE) std::array<T, Capacity> m_ring {};
+};
+
+}  // namespace msglib::detail
@@ -1,5 +1,6 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 
 namespace msglib::detail {
@@ -41,4 +42,53 @@ inline bool Timeval2Timespec( const timeval tv, timespec &ts)
     return false;
 }
 
-}   // namespace msglib::detail
\ No newline at end of file
+/**
+ * @brief Convert from a POSIX timespec to nanoseconds
+ * 
+ * @param ts - POSIX timespec to convert
+ * @return int64_t - nanoseconds
+ */
+inline int64_t Timespec2Ns(const timespec &ts)
+{
+    constexpr int64_t NSEC_PER_SEC = 1000000000;
+    return (static_cast<int64_t>(ts.tv_sec) * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+/**
+ * @brief Clock ID standing for the TimerManager's virtual clock, which has no POSIX clock
+ */
+static constexpr clockid_t VIRTUAL_CLOCK_ID = -1;
+
+/**
+ * @brief ClockTraits maps a std::chrono clock to the POSIX clock used for absolute timers
+ *
+ * @tparam C - std::chrono clock (steady_clock or system_clock)
+ */
+template <class C>
+struct ClockTraits;
+
+template <>
+struct ClockTraits<std::chrono::steady_clock> {
+    static constexpr clockid_t CLOCK_ID = CLOCK_MONOTONIC;
+};
+
+template <>
+struct ClockTraits<std::chrono::system_clock> {
+    static constexpr clockid_t CLOCK_ID = CLOCK_REALTIME;
+};
+
+/**
+ * @brief Convert from a std::chrono::time_point to a POSIX timespec measured from the clock's epoch
+ * 
+ * @tparam C - clock type
+ * @tparam D - duration type
+ * @param time - time point to be converted
+ * @return timespec - POSIX timespec representation
+ */
+template <class C, class D>
+timespec TimePoint2Timespec(std::chrono::time_point<C, D> time)
+{
+    return Chrono2Timespec(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()));
+}
+
+}   // namespace msglib::detail
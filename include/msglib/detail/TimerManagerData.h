@@ -1,13 +1,23 @@
 #pragma once
 
+#include "Arena.h"
+#include "LazyTable.h"
+#include "TimeConv.h"
 #include "msglib/Mailbox.h"
+#include "msglib/ThreadPolicy.h"
 #include "msglib/TimerManager.h"
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <csignal>
 #include <ctime>
+#include <functional>
+#include <limits>
 #include <mutex>
+#include <new>
+#include <optional>
 #include <thread>
+#include <vector>
 
 namespace msglib {
 
@@ -24,38 +34,94 @@ class TimerManagerData;
  */
 class Timer {
 public:
-    Timer(Mailbox &mailbox, TimerManagerData &timerMgrData, Label label, timespec time, TimerType_e type)
-        : m_mailbox(mailbox), m_timerManagerData(timerMgrData), m_label(label), m_type(type) {
+    /**
+     * @brief Schedule of a timer on the virtual clock (see TimerClock::VIRTUAL), in nanoseconds of
+     *        virtual time
+     */
+    struct VirtualSchedule {
+        int64_t m_deadline;
+        int64_t m_interval;
+
+        /**
+         * @brief Identifies the timer's current expiry among those queued by TimerResources
+         */
+        uint64_t m_sequence;
+    };
+
+    /**
+     * @brief Create and arm a POSIX timer
+     *
+     * @param clock - clock the timer measures (CLOCK_MONOTONIC or CLOCK_REALTIME)
+     * @param flags - 0 for a relative expiry or TIMER_ABSTIME for an absolute one
+     * @param spec - first expiry and, for PERIODIC timers, the interval
+     * @param type - type of timer
+     * @param payload - shared block delivered on each expiry, whose reference the Timer takes
+     *                  over once constructed, or nullptr to send a signal
+     * @param size - payload size
+     */
+    Timer(Mailbox &mailbox, TimerManagerData &timerMgrData, Label label, clockid_t clock, int flags,
+        const itimerspec &spec, TimerType_e type, std::byte *payload = nullptr, uint32_t size = 0)
+        : m_mailbox(mailbox)
+        , m_timerManagerData(timerMgrData)
+        , m_label(label)
+        , m_type(type)
+        , m_spec(spec)
+        , m_payload(payload)
+        , m_size(size) {
         m_sev.sigev_notify = SIGEV_SIGNAL;
         m_sev.sigev_signo = SIGRTMIN;
         m_sev.sigev_value.sival_ptr = this;
-        if (timer_create(CLOCK_MONOTONIC, &m_sev, &m_timer) == -1) {
+        if (timer_create(clock, &m_sev, &m_timer) == -1) {
             throw std::runtime_error("Couldn't create timer");
         }
 
-        switch (type) {
-        case PERIODIC:
-            m_spec.it_value = time;
-            m_spec.it_interval = time;
-            break;
-        case ONE_SHOT:
-            m_spec.it_value = time;
+        if (type == ONE_SHOT) {
             m_spec.it_interval.tv_sec = m_spec.it_interval.tv_nsec = 0;
-            break;
         }
-        if (timer_settime(m_timer, 0, &m_spec, nullptr) == -1) {
+        // A zero it_value disarms rather than arms the timer, so an expiry at the clock's epoch
+        // (which is long past) is moved on by a nanosecond
+        if ((flags & TIMER_ABSTIME) != 0 && m_spec.it_value.tv_sec == 0 && m_spec.it_value.tv_nsec == 0) {
+            m_spec.it_value.tv_nsec = 1;
+        }
+        if (timer_settime(m_timer, flags, &m_spec, nullptr) == -1) {
+            timer_delete(m_timer);
             throw std::runtime_error("Couldn't start timer");
         }
     }
 
+    /**
+     * @brief Create a timer on the virtual clock, which TimerManagerData fires as virtual time is
+     *        advanced
+     */
+    Timer(Mailbox &mailbox, TimerManagerData &timerMgrData, Label label, const VirtualSchedule &schedule,
+        TimerType_e type, std::byte *payload = nullptr, uint32_t size = 0)
+        : m_mailbox(mailbox)
+        , m_timerManagerData(timerMgrData)
+        , m_label(label)
+        , m_type(type)
+        , m_payload(payload)
+        , m_size(size)
+        , m_virtual(true)
+        , m_schedule(schedule) {
+    }
+
     ~Timer() {
-        timer_delete(m_timer);
+        if (!m_virtual) {
+            timer_delete(m_timer);
+        }
+        if (m_payload != nullptr) {
+            MailboxBase::s_mailboxData.releaseShared(m_payload);
+        }
     }
 
     /**
      * @brief Cancel a timer
      */
     void cancel() {
+        if (m_virtual) {
+            // Its queued expiry is discarded once the timer is gone
+            return;
+        }
         itimerspec itsnew {};
         itsnew.it_value.tv_sec = itsnew.it_value.tv_nsec = 0;
         itsnew.it_interval.tv_sec = itsnew.it_interval.tv_nsec = 0;
@@ -66,8 +132,27 @@ public:
      * @brief Handle a timer event firing.
      *
      * NOTE: Implementation separate to break circular dependency with TimerManagerData
+     *
+     * @return false - the signal (or payload) couldn't be delivered, e.g. a receiver's queue was
+     *                 full
      */
-    void timerEvent();
+    bool timerEvent();
+
+    [[nodiscard]] TimerType_e type() const {
+        return m_type;
+    }
+
+    [[nodiscard]] bool isVirtual() const {
+        return m_virtual;
+    }
+
+    VirtualSchedule &schedule() {
+        return m_schedule;
+    }
+
+    [[nodiscard]] const VirtualSchedule &schedule() const {
+        return m_schedule;
+    }
 
 private:
     Mailbox &m_mailbox;
@@ -77,6 +162,16 @@ private:
     TimerType_e m_type = ONE_SHOT;
     struct sigevent m_sev { };
     struct itimerspec m_spec { };
+
+    /**
+     * @brief Payload delivered on each expiry, or nullptr for a signal. Its one block is shared by
+     *        every message sent, and is freed once the timer and all of them are released.
+     */
+    std::byte *m_payload = nullptr;
+    uint32_t m_size = 0;
+
+    bool m_virtual = false;
+    VirtualSchedule m_schedule {};
 };
 
 /**
@@ -117,30 +212,174 @@ struct TimerResources {
         }
     }
 
-    TimerResources(std::recursive_mutex &mutex)
-        : m_bytes(std::make_unique<std::byte[]>(65536 * sizeof(Timer)))
-        , m_byteResource(m_bytes.get(), 65536 * sizeof(Timer), std::pmr::null_memory_resource())
-        , m_timerResource(&m_byteResource)
+    /**
+     * @brief Construct a new TimerResources object. Memory for timers is reserved but only
+     *        committed as it's used, and the signal handling thread isn't started until the
+     *        first timer is.
+     *
+     * @param mutex - mutex protecting timer resources
+     * @param options - number of labels and timers, memory configuration and thread policy
+     */
+    TimerResources(std::recursive_mutex &mutex, const Options &options)
+        : m_arena(((options.m_maxTimers != 0) ? options.m_maxTimers : 1) * sizeof(Timer), timerConfig(options))
+        , m_maxTimers(options.m_maxTimers)
+        , m_timers((options.m_maxLabels < MAX_LABELS) ? options.m_maxLabels : MAX_LABELS,
+              ArenaConfig::FromOptions(options))
+        , m_virtual(options.m_timerClock == TimerClock::VIRTUAL)
         , m_mutex(mutex)
-        , m_thread(std::thread(&TimerResources::HandleSignals, this)) {
+        , m_threadPolicy(options.m_timerThread) {
     }
 
     ~TimerResources() {
-        m_shutdown = true;
-        m_thread.join();
+        if (m_thread.joinable()) {
+            m_shutdown = true;
+            m_thread.join();
+        }
+    }
+
+    // Disallow copy and move
+    TimerResources(const TimerResources &) = delete;
+    TimerResources(TimerResources &&) = delete;
+    TimerResources &operator=(const TimerResources &) = delete;
+    TimerResources &operator=(TimerResources &&) = delete;
+
+    /**
+     * @brief Start the signal handling thread if it isn't already running, applying its
+     *        ThreadPolicy. Called with m_mutex held, which HandleSignals() takes to handle each
+     *        expiry, so none is handled before the policy is applied.
+     */
+    void startThread() {
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&TimerResources::HandleSignals, this);
+            m_threadStatus = ApplyThreadPolicy(m_threadPolicy, m_thread);
+        }
+    }
+
+    /**
+     * @brief Allocate storage for a Timer. Called with m_mutex held.
+     *
+     * @return Timer* - uninitialized storage, or nullptr if m_maxTimers are outstanding
+     */
+    Timer *allocateTimer() {
+        if (m_free != nullptr) {
+            FreeSlot *slot = m_free;
+            m_free = slot->m_next;
+            return reinterpret_cast<Timer *>(slot);
+        }
+        if (m_used < m_maxTimers) {
+            return reinterpret_cast<Timer *>(m_arena.data() + (sizeof(Timer) * m_used++));
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Return storage for a (destroyed) Timer. Called with m_mutex held.
+     */
+    void freeTimer(Timer *timer) {
+        m_free = new (timer) FreeSlot {m_free};
+    }
+
+    /**
+     * @brief Queue a virtual timer's next expiry. Called with m_mutex held.
+     */
+    void scheduleVirtual(Label label, const Timer::VirtualSchedule &schedule) {
+        m_due.push_back(VirtualExpiry {schedule.m_deadline, schedule.m_sequence, label});
+        std::push_heap(m_due.begin(), m_due.end(), std::greater<>());
+    }
+
+    /**
+     * @brief Dequeue the earliest virtual timer expiry due by limit, skipping those of timers
+     *        since cancelled. Called with m_mutex held.
+     *
+     * @param limit - virtual time in nanoseconds
+     * @param label - set to the label of the timer due
+     * @return Timer* - timer due, or nullptr if none is due by limit
+     */
+    Timer *nextVirtual(int64_t limit, Label &label) {
+        while (!m_due.empty() && m_due.front().m_deadline <= limit) {
+            const VirtualExpiry expiry = m_due.front();
+            std::pop_heap(m_due.begin(), m_due.end(), std::greater<>());
+            m_due.pop_back();
+            if (!stale(expiry)) {
+                label = expiry.m_label;
+                return m_timers[expiry.m_label];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Drop the queued expiries of cancelled virtual timers once they outnumber the live
+     *        ones (each outstanding virtual timer has one), so that restarting timers which never
+     *        expire doesn't grow m_due without bound. Called with m_mutex held.
+     */
+    void compactVirtual() {
+        if (m_due.size() <= 2 * m_virtualTimers) {
+            return;
+        }
+        m_due.erase(std::remove_if(m_due.begin(), m_due.end(), [this](const VirtualExpiry &expiry) { return stale(expiry); }),
+            m_due.end());
+        std::make_heap(m_due.begin(), m_due.end(), std::greater<>());
+    }
+
+    /**
+     * @brief Expiry of a virtual timer, ordered by deadline and then by when it was scheduled
+     */
+    struct VirtualExpiry {
+        int64_t m_deadline;
+        uint64_t m_sequence;
+        Label m_label;
+
+        bool operator>(const VirtualExpiry &rhs) const {
+            return (m_deadline != rhs.m_deadline) ? (m_deadline > rhs.m_deadline) : (m_sequence > rhs.m_sequence);
+        }
+    };
+
+    /**
+     * @brief Return true if a queued expiry belongs to a timer since cancelled (or restarted)
+     */
+    bool stale(const VirtualExpiry &expiry) {
+        const Timer *timer = m_timers[expiry.m_label];
+        return timer == nullptr || timer->schedule().m_sequence != expiry.m_sequence;
+    }
+
+    /**
+     * @brief Free-list link stored in unused Timer storage
+     */
+    struct FreeSlot {
+        FreeSlot *m_next;
+    };
+
+    static_assert(sizeof(FreeSlot) <= sizeof(Timer), "Timer storage must be able to hold a free-list link");
+
+    /**
+     * @brief Timer storage is committed as timers are first used, unless it is locked into RAM
+     */
+    static ArenaConfig timerConfig(const Options &options) {
+        ArenaConfig config = ArenaConfig::FromOptions(options);
+        config.m_prefault = false;
+        return config;
     }
 
     /**
-     * @brief Byte array supporting the byteResource
+     * @brief Arena holding storage for up to m_maxTimers Timers
      */
-    std::unique_ptr<std::byte[]> m_bytes;
+    Arena m_arena;
 
     /**
-     * @brief Monotonic buffer resource using byte array
+     * @brief Maximum number of outstanding timers
      */
-    std::pmr::monotonic_buffer_resource m_byteResource;
+    size_t m_maxTimers;
 
-    std::pmr::polymorphic_allocator<Timer> m_timerResource;
+    /**
+     * @brief Number of Timer slots handed out from the arena so far
+     */
+    size_t m_used = 0;
+
+    /**
+     * @brief Previously used Timer slots available for reuse
+     */
+    FreeSlot *m_free = nullptr;
 
     /**
      * @brief Mailbox to use for timer signals
@@ -148,9 +387,45 @@ struct TimerResources {
     Mailbox m_mailbox;
 
     /**
-     * @brief Collection of current outstanding timers
+     * @brief Current outstanding timers indexed by Label, committed as labels are used
+     */
+    LazyTable<Timer *> m_timers;
+
+    /**
+     * @brief True if timers run on the virtual clock rather than as POSIX timers
+     */
+    bool m_virtual;
+
+    /**
+     * @brief Current virtual time in nanoseconds
+     */
+    int64_t m_now = 0;
+
+    /**
+     * @brief Last sequence number given to a virtual timer expiry
+     */
+    uint64_t m_sequence = 0;
+
+    /**
+     * @brief Number of outstanding virtual ONE_SHOT timers
+     */
+    size_t m_oneShots = 0;
+
+    /**
+     * @brief Number of outstanding virtual timers
      */
-    std::array<Timer *, 65536> m_timers;
+    size_t m_virtualTimers = 0;
+
+    /**
+     * @brief Number of virtual timer expiries whose signal (or payload) couldn't be delivered
+     */
+    size_t m_dropped = 0;
+
+    /**
+     * @brief Min-heap of queued virtual timer expiries, including those of cancelled timers until
+     *        they are reached or compacted away (see compactVirtual())
+     */
+    std::vector<VirtualExpiry> m_due;
 
     /**
      * @brief Flag indicating that shutdown has been triggered
@@ -163,7 +438,17 @@ struct TimerResources {
     std::recursive_mutex &m_mutex;
 
     /**
-     * @brief Thread handling SIGRTMIN signals
+     * @brief Scheduling and CPU affinity for m_thread
+     */
+    ThreadPolicy m_threadPolicy;
+
+    /**
+     * @brief What took effect of m_threadPolicy when m_thread was started
+     */
+    ThreadStatus m_threadStatus;
+
+    /**
+     * @brief Thread handling SIGRTMIN signals, started with the first timer
      */
     std::thread m_thread;
 };
@@ -178,12 +463,16 @@ public:
 
     ~TimerManagerData() = default;
 
-    bool Initialize() {
+    bool Initialize(const Options &options) {
         try {
             std::lock_guard<std::recursive_mutex> guard(m_mutex);
             if (!m_initialized) {
-                m_resources = std::make_unique<TimerResources>(m_mutex);
+                m_resources = std::make_unique<TimerResources>(m_mutex, options);
                 m_initialized = true;
+                if (options.m_timerThread.requested() && options.m_timerClock == TimerClock::REAL) {
+                    // Start the thread now so that its policy is verified at startup
+                    m_resources->startThread();
+                }
             }
             return true;
         } catch (...) {
@@ -191,30 +480,234 @@ public:
         }
     }
 
+    /**
+     * @brief Start a timer relative to now on CLOCK_MONOTONIC, firing after time and, for PERIODIC
+     *        timers, every time thereafter
+     */
     bool startTimer(const Label &label, const timespec &time, const TimerType_e type) {
+        return startTimer(label, CLOCK_MONOTONIC, 0, itimerspec {time, time}, type);
+    }
+
+    /**
+     * @brief Start a timer
+     *
+     * @param label - label to signal
+     * @param clock - clock the timer measures
+     * @param flags - 0 for a relative first expiry or TIMER_ABSTIME for an absolute one
+     * @param spec - first expiry (it_value) and, for PERIODIC timers, the interval (it_interval)
+     * @param type - type of timer
+     * @param payload - data copied once into a pool block and delivered on each expiry, or nullptr
+     *                  to send a signal
+     * @param size - payload size
+     */
+    bool startTimer(const Label &label, clockid_t clock, int flags, const itimerspec &spec, const TimerType_e type,
+        const void *payload = nullptr, uint32_t size = 0) {
         std::lock_guard<std::recursive_mutex> guard(m_mutex);
-        if (m_resources->m_timers[label] == nullptr) {
-            m_resources->m_timers[label] = m_resources->m_timerResource.allocate(1);
-            m_resources->m_timerResource.construct<Timer>(
-                m_resources->m_timers[label], m_resources->m_mailbox, *this, label, time, type);
-            return true;
+        if (!m_resources || label >= m_resources->m_timers.size() || m_resources->m_timers[label] != nullptr) {
+            return false;
         }
-        return false;
+        const bool isVirtual = m_resources->m_virtual;
+        Timer::VirtualSchedule schedule {};
+        if (isVirtual ? !virtualSchedule(clock, flags, spec, type, schedule) : (clock == VIRTUAL_CLOCK_ID)) {
+            return false;
+        }
+        Timer *timer = m_resources->allocateTimer();
+        if (timer == nullptr) {
+            return false;
+        }
+        std::byte *shared = nullptr;
+        if (payload != nullptr) {
+            shared = MailboxBase::s_mailboxData.allocateShared(payload, size);
+            if (shared == nullptr) {
+                m_resources->freeTimer(timer);
+                return false;
+            }
+        }
+        if (!isVirtual) {
+            m_resources->startThread();
+        }
+        try {
+            Mailbox &mailbox = m_resources->m_mailbox;
+            m_resources->m_timers[label] = isVirtual
+                ? new (timer) Timer(mailbox, *this, label, schedule, type, shared, size)
+                : new (timer) Timer(mailbox, *this, label, clock, flags, spec, type, shared, size);
+        } catch (...) {
+            if (shared != nullptr) {
+                MailboxBase::s_mailboxData.releaseShared(shared);
+            }
+            m_resources->freeTimer(timer);
+            throw;
+        }
+        if (isVirtual) {
+            m_resources->scheduleVirtual(label, schedule);
+            m_resources->m_oneShots += (type == ONE_SHOT) ? 1 : 0;
+            m_resources->m_virtualTimers++;
+        }
+        return true;
     }
 
     bool cancelTimer(const Label &label) {
         std::lock_guard<std::recursive_mutex> guard(m_mutex);
-        if (m_resources->m_timers[label] != nullptr) {
-            m_resources->m_timers[label]->cancel();
-            m_resources->m_timerResource.destroy<Timer>(m_resources->m_timers[label]);
-            m_resources->m_timerResource.deallocate(m_resources->m_timers[label], 1);
+        if (!m_resources || label >= m_resources->m_timers.size()) {
+            return false;
+        }
+        Timer *timer = m_resources->m_timers[label];
+        if (timer != nullptr) {
+            const bool isVirtual = timer->isVirtual();
+            if (isVirtual && timer->type() == ONE_SHOT) {
+                m_resources->m_oneShots--;
+            }
+            timer->cancel();
+            timer->~Timer();
+            m_resources->freeTimer(timer);
             m_resources->m_timers[label] = nullptr;
+            if (isVirtual) {
+                m_resources->m_virtualTimers--;
+                m_resources->compactVirtual();
+            }
             return true;
         }
         return false;
     }
 
+    /**
+     * @brief Advance the virtual clock to time, firing each timer due by then in deadline order
+     *
+     * @param time - virtual time; the clock never goes backwards
+     * @param maxExpiries - stop after this many expiries, leaving the clock at the last one's
+     *                      deadline so that a further call continues from there
+     * @return size_t - number of timer expiries delivered (see dropped() for those which weren't)
+     */
+    size_t advanceTo(std::chrono::nanoseconds time, size_t maxExpiries = std::numeric_limits<size_t>::max()) {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        if (!m_resources || !m_resources->m_virtual) {
+            return 0;
+        }
+        size_t delivered = 0;
+        Label label = 0;
+        for (size_t expiries = 0; expiries < maxExpiries; expiries++) {
+            Timer *timer = m_resources->nextVirtual(time.count(), label);
+            if (timer == nullptr) {
+                m_resources->m_now = std::max(m_resources->m_now, static_cast<int64_t>(time.count()));
+                break;
+            }
+            delivered += fireVirtual(timer, label) ? 1 : 0;
+        }
+        return delivered;
+    }
+
+    /**
+     * @brief Advance the virtual clock from deadline to deadline until no ONE_SHOT timers are
+     *        outstanding. PERIODIC timers fire along the way but don't keep the clock running.
+     *
+     * @param maxExpiries - stop after this many expiries
+     * @return size_t - number of timer expiries delivered (see dropped() for those which weren't)
+     */
+    size_t runUntilIdle(size_t maxExpiries = std::numeric_limits<size_t>::max()) {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        if (!m_resources || !m_resources->m_virtual) {
+            return 0;
+        }
+        size_t delivered = 0;
+        Label label = 0;
+        for (size_t expiries = 0; expiries < maxExpiries && m_resources->m_oneShots > 0; expiries++) {
+            Timer *timer = m_resources->nextVirtual(std::numeric_limits<int64_t>::max(), label);
+            if (timer == nullptr) {
+                break;
+            }
+            delivered += fireVirtual(timer, label) ? 1 : 0;
+        }
+        return delivered;
+    }
+
+    /**
+     * @brief Return the number of virtual timer expiries which couldn't be delivered (e.g. the
+     *        receiver's queue was full because it isn't drained while the clock is advanced)
+     */
+    size_t dropped() {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        return m_resources ? m_resources->m_dropped : 0;
+    }
+
+    /**
+     * @brief Return the number of virtual timer expiries queued, including those of cancelled
+     *        timers not yet discarded
+     */
+    size_t queuedVirtual() {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        return m_resources ? m_resources->m_due.size() : 0;
+    }
+
+    /**
+     * @brief Return the current virtual time (zero when not using the virtual clock)
+     */
+    std::chrono::nanoseconds now() {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        return std::chrono::nanoseconds(m_resources ? m_resources->m_now : 0);
+    }
+
+    /**
+     * @brief Return true if the signal handling thread has been started
+     */
+    bool threadStarted() {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        return m_resources && m_resources->m_thread.joinable();
+    }
+
+    /**
+     * @brief Return what took effect of the signal handling thread's ThreadPolicy, or nullopt if
+     *        the thread hasn't been started
+     */
+    std::optional<ThreadStatus> threadStatus() {
+        std::lock_guard<std::recursive_mutex> guard(m_mutex);
+        if (m_resources && m_resources->m_thread.joinable()) {
+            return m_resources->m_threadStatus;
+        }
+        return std::nullopt;
+    }
+
 private:
+    /**
+     * @brief Compute a virtual timer's schedule. Deadlines are relative to the current virtual
+     *        time unless absolute on the virtual clock; real clock deadlines aren't supported.
+     */
+    bool virtualSchedule(clockid_t clock, int flags, const itimerspec &spec, const TimerType_e type,
+        Timer::VirtualSchedule &schedule) {
+        const bool absolute = (flags & TIMER_ABSTIME) != 0;
+        if (absolute && clock != VIRTUAL_CLOCK_ID) {
+            return false;
+        }
+        const int64_t interval = (type == PERIODIC) ? Timespec2Ns(spec.it_interval) : 0;
+        if (type == PERIODIC && interval <= 0) {
+            return false;
+        }
+        const int64_t value = Timespec2Ns(spec.it_value);
+        schedule = Timer::VirtualSchedule {absolute ? value : m_resources->m_now + value, interval,
+            ++m_resources->m_sequence};
+        return true;
+    }
+
+    /**
+     * @brief Fire a virtual timer, moving the clock to its deadline and queueing its next expiry if
+     *        it is PERIODIC. Called with m_mutex held.
+     *
+     * @return false - the expiry couldn't be delivered, and was counted in m_dropped
+     */
+    bool fireVirtual(Timer *timer, Label label) {
+        Timer::VirtualSchedule &schedule = timer->schedule();
+        m_resources->m_now = std::max(m_resources->m_now, schedule.m_deadline);
+        if (timer->type() == PERIODIC) {
+            schedule.m_deadline += schedule.m_interval;
+            schedule.m_sequence = ++m_resources->m_sequence;
+            m_resources->scheduleVirtual(label, schedule);
+        }
+        if (!timer->timerEvent()) {
+            m_resources->m_dropped++;
+            return false;
+        }
+        return true;
+    }
+
     /**
      * @brief Mutex protecting Timer resources
      */
@@ -233,14 +726,16 @@ private:
 };
 
 /**
- * @brief Handle a timer firing by sending the appropriate mailbox signal and
+ * @brief Handle a timer firing by sending the appropriate mailbox signal (or its payload) and
  *        cancelling the timer from recurring if it is a ONE_SHOT
  */
-void Timer::timerEvent() {
-    m_mailbox.SendSignal(m_label);
+inline bool Timer::timerEvent() {
+    const bool delivered = (m_payload != nullptr) ? m_mailbox.sendShared(m_label, m_payload, m_size)
+                                                  : m_mailbox.SendSignal(m_label);
     if (m_type == ONE_SHOT) {
         m_timerManagerData.cancelTimer(m_label);
     }
+    return delivered;
 }
 
 }  // namespace detail
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace msglib::detail {
+
+/**
+ * @brief Bounded work-stealing deque (Chase-Lev). The owning thread pushes and pops at the
+ *        bottom without contention, while other threads steal from the top; only taking the
+ *        last element, or stealing, needs a compare-and-swap. The element array is allocated
+ *        once at construction.
+ *
+ * @tparam T - trivially copyable element type (typically a pointer)
+ */
+template <class T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque requires trivially copyable types");
+
+public:
+    /**
+     * @brief Construct a new WorkStealingDeque object
+     *
+     * @param cap - minimum capacity, rounded up to a power of 2
+     */
+    explicit WorkStealingDeque(size_t cap) : m_capacity(roundUp(cap)), m_items(std::make_unique<std::atomic<T>[]>(m_capacity)) {
+    }
+
+    // Disallow copy and move constructors
+    WorkStealingDeque(const WorkStealingDeque &other) = delete;
+    WorkStealingDeque(WorkStealingDeque &&other) = delete;
+
+    // Disallow asignment and move assignment
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(WorkStealingDeque &&) = delete;
+
+    ~WorkStealingDeque() = default;
+
+    /**
+     * @brief Push a value at the bottom. Owner thread only.
+     *
+     * @return false - deque full
+     */
+    bool push(const T &value) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(m_capacity)) {
+            return false;
+        }
+        m_items[static_cast<size_t>(bottom) & (m_capacity - 1)].store(value, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pop the most recently pushed value from the bottom. Owner thread only.
+     *
+     * @return false - deque empty (or its last value was stolen)
+     */
+    bool pop(T &value) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = m_items[static_cast<size_t>(bottom) & (m_capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last value, so race any thieves for it
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Steal the least recently pushed value from the top. Any thread.
+     *
+     * @return false - deque empty, or lost a race with the owner or another thief
+     */
+    bool steal(T &value) {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        value = m_items[static_cast<size_t>(top) & (m_capacity - 1)].load(std::memory_order_relaxed);
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the (approximate, if there are concurrent operations) number of values
+     */
+    [[nodiscard]] size_t size() const {
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        return (bottom > top) ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    /**
+     * @brief Return the deque capacity
+     */
+    [[nodiscard]] size_t capacity() const {
+        return m_capacity;
+    }
+
+private:
+    static size_t roundUp(size_t cap) {
+        size_t result = 1;
+        while (result < cap) {
+            result <<= 1U;
+        }
+        return result;
+    }
+
+    size_t m_capacity;
+    std::unique_ptr<std::atomic<T>[]> m_items;
+
+    /**
+     * @brief Index of the next value to be stolen; shared by thieves
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_top {0};
+
+    /**
+     * @brief Index of the next value to be pushed; written by the owner
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_bottom {0};
+};
+
+}  // namespace msglib::detail
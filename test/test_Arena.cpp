@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+#include "msglib/Mailbox.h"
+#include "msglib/detail/Arena.h"
+#include "msglib/detail/MailboxData.h"
+#include "msglib/detail/Numa.h"
+#include <algorithm>
+#include <sched.h>
+#include <sys/mman.h>
+#include <vector>
+
+using msglib::detail::Arena;
+
+TEST(ArenaTest, Numa) {
+    auto nodes = msglib::detail::NumaNodeCount();
+    EXPECT_GE(nodes, 1U);
+    EXPECT_LE(nodes, msglib::detail::MAX_NUMA_NODES);
+    EXPECT_LT(msglib::detail::CurrentNumaNode(), nodes);
+}
+
+TEST(ArenaTest, Allocation) {
+    Arena arena(100, Arena::NO_NODE);  // NOLINT
+
+    EXPECT_EQ(Arena::pageSize(), arena.size());
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(arena.data()) % Arena::pageSize());
+    EXPECT_EQ(Arena::NO_NODE, arena.node());
+    EXPECT_FALSE(arena.bound());
+
+    EXPECT_TRUE(arena.contains(arena.data()));
+    EXPECT_TRUE(arena.contains(arena.data() + arena.size() - 1));
+    EXPECT_FALSE(arena.contains(arena.data() + arena.size()));
+
+    // Memory is zero-filled and writable
+    EXPECT_EQ(std::byte {0}, arena.data()[arena.size() - 1]);
+    arena.data()[arena.size() - 1] = std::byte {1};
+}
+
+TEST(ArenaTest, NodeLocal) {
+    Arena arena(Arena::pageSize() * 4, msglib::detail::CurrentNumaNode());  // NOLINT
+
+    EXPECT_EQ(Arena::pageSize() * 4, arena.size());
+    EXPECT_EQ(msglib::detail::CurrentNumaNode(), arena.node());
+    // Binding is best-effort; the Arena is usable either way
+    arena.data()[0] = std::byte {1};
+}
+
+TEST(ArenaTest, NumaLocalPools) {
+    // Pin the thread, so that it allocates from the same node throughout
+    cpu_set_t original;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(original), &original));
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(sched_getcpu(), &pinned);
+    ASSERT_EQ(0, sched_setaffinity(0, sizeof(pinned), &pinned));
+
+    msglib::Options options;
+    options.m_smallCap = 16;  // NOLINT
+    options.m_largeCap = 32;  // NOLINT
+    options.m_numaLocal = true;
+
+    const size_t nodes = msglib::detail::NumaNodeCount();
+    msglib::detail::MailboxData data;
+    EXPECT_TRUE(data.Initialize(options));
+    EXPECT_EQ(nodes, data.numaPartitions());
+
+    auto small = data.allocateSmall();
+    auto large = data.allocateLarge();
+    EXPECT_NE(nullptr, small.get());
+    EXPECT_NE(nullptr, large.get());
+    data.freeSmall(small.get());
+    data.freeLarge(large.get());
+
+    // Once the local pool is exhausted blocks come from the other nodes' pools, and each is
+    // freed back to its owning partition so that it can be reallocated
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<std::byte *> blocks(16 * nodes);  // NOLINT
+        for (auto &block : blocks) {
+            block = data.allocateSmall().get();
+            EXPECT_NE(nullptr, block);
+        }
+        EXPECT_EQ(nullptr, data.allocateSmall().get());
+        for (auto *block : blocks) {
+            data.freeSmall(block);
+        }
+    }
+
+    // Nodes are ordered by distance, nearest (i.e. the node itself) first
+    for (size_t node = 0; node < nodes; node++) {
+        const auto order = msglib::detail::NumaNodesByDistance(node, nodes);
+        ASSERT_EQ(nodes, order.size());
+        EXPECT_EQ(node, order[0]);
+    }
+
+    EXPECT_EQ(0, sched_setaffinity(0, sizeof(original), &original));
+}
+
+TEST(ArenaTest, HugePages) {
+    using msglib::HugePages;
+    using msglib::detail::ArenaConfig;
+    using msglib::detail::HUGE_PAGE_SIZE;
+
+    const auto before = msglib::detail::GetMemoryStats();
+    {
+        // Explicit huge pages fall back to transparent huge pages and then to regular pages
+        Arena arena(HUGE_PAGE_SIZE + 1, ArenaConfig {Arena::NO_NODE, HugePages::EXPLICIT, true});
+        EXPECT_GE(arena.size(), HUGE_PAGE_SIZE + 1);
+        if (arena.hugePages() != HugePages::NONE) {
+            EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(arena.data()) % HUGE_PAGE_SIZE);
+            EXPECT_EQ(2 * HUGE_PAGE_SIZE, arena.size());
+        }
+        arena.data()[arena.size() - 1] = std::byte {1};
+
+        // Totals reflect what was actually obtained
+        const auto stats = msglib::detail::GetMemoryStats();
+        EXPECT_EQ(before.m_bytes + arena.size(), stats.m_bytes);
+        EXPECT_EQ(before.m_hugeTlbBytes + ((arena.hugePages() == HugePages::EXPLICIT) ? arena.size() : 0),
+            stats.m_hugeTlbBytes);
+        EXPECT_EQ(before.m_transparentHugeBytes + arena.transparentHugeBytes(), stats.m_transparentHugeBytes);
+        EXPECT_LE(arena.transparentHugeBytes(), arena.size());
+        EXPECT_EQ(arena.hugePages() == HugePages::TRANSPARENT, arena.transparentHugeBytes() > 0);
+        EXPECT_EQ(before.m_lockedBytes + (arena.locked() ? arena.size() : 0), stats.m_lockedBytes);
+    }
+    const auto after = msglib::detail::GetMemoryStats();
+    EXPECT_EQ(before.m_bytes, after.m_bytes);
+    EXPECT_EQ(before.m_transparentHugeBytes, after.m_transparentHugeBytes);
+    EXPECT_EQ(before.m_lockedBytes, after.m_lockedBytes);
+
+    // Every page of a transparent huge page Arena is faulted in, whether or not huge pages back it
+    {
+        Arena arena(2 * HUGE_PAGE_SIZE, ArenaConfig {Arena::NO_NODE, HugePages::TRANSPARENT, false});
+        std::vector<unsigned char> resident(arena.size() / Arena::pageSize());
+        ASSERT_EQ(0, mincore(arena.data(), arena.size(), resident.data()));
+        EXPECT_TRUE(std::all_of(resident.begin(), resident.end(), [](unsigned char page) { return (page & 1) != 0; }));
+    }
+
+    // Arenas smaller than a huge page always use regular pages
+    Arena small(100, ArenaConfig {Arena::NO_NODE, HugePages::TRANSPARENT, false});  // NOLINT
+    EXPECT_EQ(HugePages::NONE, small.hugePages());
+    EXPECT_EQ(Arena::pageSize(), small.size());
+    EXPECT_FALSE(small.locked());
+}
@@ -0,0 +1,283 @@
+#include "msglib/AsyncMailbox.h"
+#include "gtest/gtest.h"
+
+#ifdef MSGLIB_HAS_COROUTINES
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace msglib;  // NOLINT
+
+namespace {
+
+struct Count {
+    int value;
+};
+
+struct Payload {
+    Payload() {
+        s_live++;
+    }
+    Payload(const Payload & /*unused*/) {
+        s_live++;
+    }
+    Payload &operator=(const Payload &) = delete;
+    ~Payload() {
+        s_live--;
+    }
+
+    inline static int s_live = 0;
+};
+
+Task Consumer(AsyncMailbox &mbox, int count, int &received, bool &ordered) {
+    for (int i = 0; i < count; i++) {
+        Message msg = co_await mbox.AsyncReceive();
+        MessageGuard guard(mbox, msg);
+        auto *c = msg.as<Count>();
+        ordered &= (c != nullptr && c->value == i);
+        received++;
+    }
+}
+
+Task Producer(AsyncMailbox &mbox, Label label, int count, int &sent) {
+    for (int i = 0; i < count; i++) {
+        if (co_await mbox.AsyncSend(label, Count {i})) {
+            sent++;
+        }
+    }
+}
+
+Task Worker(AsyncMailbox &mbox, Label stop, int &received) {
+    while (true) {
+        Message msg = co_await mbox.AsyncReceive();
+        MessageGuard guard(mbox, msg);
+        if (msg.m_label == stop) {
+            break;
+        }
+        received++;
+    }
+}
+
+Task SharedProducer(AsyncMailbox &mbox, Label label, Label stop, int count, int &sent) {
+    for (int i = 0; i < count; i++) {
+        if (co_await mbox.AsyncSend(label, Count {i})) {
+            sent++;
+        }
+    }
+    co_await mbox.AsyncSend(stop, Count {-1});
+}
+
+Task Actor(AsyncMailbox &mbox, std::atomic<int> &received) {
+    Message msg = co_await mbox.AsyncReceive();
+    MessageGuard guard(mbox, msg);
+    received++;
+}
+
+Task Counter(AsyncMailbox &mbox, int count, std::atomic<int> &received) {
+    for (int i = 0; i < count; i++) {
+        Message msg = co_await mbox.AsyncReceive();
+        MessageGuard guard(mbox, msg);
+        received++;
+    }
+}
+
+Task Sender(AsyncMailbox &mbox, Label label, int count, std::atomic<int> &sent, std::atomic<int> &failed) {
+    for (int i = 0; i < count; i++) {
+        if (co_await mbox.AsyncSend(label, Count {i})) {
+            sent++;
+        } else {
+            failed++;
+        }
+    }
+}
+
+}  // namespace
+
+class AsyncMailboxTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Mailbox::Initialize();
+    }
+};
+
+TEST_F(AsyncMailboxTest, Backpressure) {
+    const Label label = 1600;  // NOLINT
+    constexpr int COUNT = 100;
+
+    // The producer repeatedly fills the consumer's small queue and is suspended until there's room
+    AsyncMailbox consumerMbox(4);
+    AsyncMailbox producerMbox;
+    consumerMbox.RegisterForLabel(label);
+
+    int received = 0;
+    int sent = 0;
+    bool ordered = true;
+    SingleThreadExecutor executor;
+    EXPECT_TRUE(executor.Spawn(Producer(producerMbox, label, COUNT, sent)));
+    EXPECT_TRUE(executor.Spawn(Consumer(consumerMbox, COUNT, received, ordered)));
+    executor.Run();
+
+    EXPECT_EQ(0U, executor.Live());
+    EXPECT_EQ(COUNT, sent);
+    EXPECT_EQ(COUNT, received);
+    EXPECT_TRUE(ordered);
+    consumerMbox.UnregisterForLabel(label);
+}
+
+TEST_F(AsyncMailboxTest, SharedGroup) {
+    const Label label = 1602;  // NOLINT
+    const Label stop = 1603;   // NOLINT
+    constexpr int COUNT = 100;
+
+    // Each message goes to one of the workers, with the producer suspended while both are full
+    AsyncMailbox worker1(2);
+    AsyncMailbox worker2(2);
+    AsyncMailbox producerMbox;
+    for (auto *worker : {&worker1, &worker2}) {
+        worker->RegisterForLabel(label, Mode::Shared);
+        worker->RegisterForLabel(stop);
+    }
+
+    int received1 = 0;
+    int received2 = 0;
+    int sent = 0;
+    SingleThreadExecutor executor;
+    EXPECT_TRUE(executor.Spawn(SharedProducer(producerMbox, label, stop, COUNT, sent)));
+    EXPECT_TRUE(executor.Spawn(Worker(worker1, stop, received1)));
+    EXPECT_TRUE(executor.Spawn(Worker(worker2, stop, received2)));
+    executor.Run();
+
+    EXPECT_EQ(COUNT, sent);
+    EXPECT_EQ(COUNT, received1 + received2);
+    EXPECT_GT(received1, 0);
+    EXPECT_GT(received2, 0);
+    for (auto *worker : {&worker1, &worker2}) {
+        worker->UnregisterForLabel(label);
+        worker->UnregisterForLabel(stop);
+    }
+}
+
+TEST_F(AsyncMailboxTest, ThreadPool) {
+    const Label base = 2000;  // NOLINT
+    constexpr int ACTORS = 1000;
+
+    std::vector<std::unique_ptr<AsyncMailbox>> mailboxes;
+    std::atomic<int> received {0};
+    ThreadPoolExecutor executor(2);
+    for (int i = 0; i < ACTORS; i++) {
+        mailboxes.push_back(std::make_unique<AsyncMailbox>(2));
+        mailboxes.back()->RegisterForLabel(static_cast<Label>(base + i));
+        EXPECT_TRUE(executor.Spawn(Actor(*mailboxes.back(), received)));
+    }
+
+    // Plain (non-coroutine) senders wake the suspended actors. There are more actors than pool
+    // blocks, so wait for the actors to release blocks as needed.
+    Mailbox sender;
+    for (int i = 0; i < ACTORS; i++) {
+        while (!sender.SendMessage(static_cast<Label>(base + i), Count {i})) {
+            std::this_thread::yield();
+        }
+    }
+    executor.WaitIdle();
+    EXPECT_EQ(ACTORS, received.load());
+
+    for (int i = 0; i < ACTORS; i++) {
+        mailboxes[i]->UnregisterForLabel(static_cast<Label>(base + i));
+    }
+}
+
+TEST_F(AsyncMailboxTest, ThreadPoolSuspendResume) {
+    const Label base = 1604;  // NOLINT
+    constexpr int ACTORS = 4;
+    constexpr int MESSAGES = 5000;
+
+    // Senders on other threads race each actor suspending against being woken and resumed on
+    // another pool thread, which finishes (and frees) the coroutine after its last message
+    std::vector<std::unique_ptr<AsyncMailbox>> mailboxes;
+    std::atomic<int> received {0};
+    ThreadPoolExecutor executor(4);
+    for (int i = 0; i < ACTORS; i++) {
+        mailboxes.push_back(std::make_unique<AsyncMailbox>(4));
+        mailboxes.back()->RegisterForLabel(static_cast<Label>(base + i));
+        EXPECT_TRUE(executor.Spawn(Counter(*mailboxes.back(), MESSAGES, received)));
+    }
+
+    std::vector<std::thread> senders;
+    for (int i = 0; i < ACTORS; i++) {
+        senders.emplace_back([i]() {
+            Mailbox sender;
+            for (int j = 0; j < MESSAGES; j++) {
+                while (!sender.SendMessage(static_cast<Label>(base + i), Count {j})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &sender : senders) {
+        sender.join();
+    }
+    executor.WaitIdle();
+    EXPECT_EQ(ACTORS * MESSAGES, received.load());
+
+    for (int i = 0; i < ACTORS; i++) {
+        mailboxes[i]->UnregisterForLabel(static_cast<Label>(base + i));
+    }
+}
+
+TEST_F(AsyncMailboxTest, Destroyed) {
+    const Label label = 1608;  // NOLINT
+
+    // Messages which were never received are released
+    Mailbox sender;
+    {
+        AsyncMailbox mbox;
+        mbox.RegisterForLabel(label);
+        EXPECT_TRUE(sender.SendMessage(label, Payload()));
+        EXPECT_TRUE(sender.SendMessage(label, Count {1}));
+        EXPECT_EQ(1, Payload::s_live);
+        mbox.UnregisterForLabel(label);
+    }
+    EXPECT_EQ(0, Payload::s_live);
+
+    // A Task waiting for space in a mailbox which is destroyed fails its send and carries on
+    auto dest = std::make_unique<AsyncMailbox>(2);
+    dest->RegisterForLabel(label);
+    AsyncMailbox senderMbox;
+    std::atomic<int> sent {0};
+    std::atomic<int> failed {0};
+    ThreadPoolExecutor executor(1);
+    EXPECT_TRUE(executor.Spawn(Sender(senderMbox, label, 3, sent, failed)));
+    while (sent.load() < 2) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(0, failed.load());
+    dest->UnregisterForLabel(label);
+    dest.reset();
+    executor.WaitIdle();
+    EXPECT_EQ(2, sent.load());
+    EXPECT_EQ(1, failed.load());
+}
+
+TEST_F(AsyncMailboxTest, Capacity) {
+    const Label label = 1601;  // NOLINT
+    AsyncMailbox mbox;
+    mbox.RegisterForLabel(label);
+    std::atomic<int> received {0};
+
+    // A Task which can't be spawned is destroyed without running
+    SingleThreadExecutor executor(1);
+    EXPECT_TRUE(executor.Spawn(Actor(mbox, received)));
+    EXPECT_FALSE(executor.Spawn(Actor(mbox, received)));
+
+    Mailbox sender;
+    EXPECT_TRUE(sender.SendSignal(label));
+    executor.Run();
+    EXPECT_EQ(1, received.load());
+    mbox.UnregisterForLabel(label);
+}
+
+#endif
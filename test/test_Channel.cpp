@@ -0,0 +1,128 @@
+#include "msglib/Channel.h"
+#include "gtest/gtest.h"
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace msglib;  // NOLINT
+
+namespace {
+
+struct Quote {
+    int id;
+    double price;
+};
+
+struct Bulk {
+    char data[1000];
+};
+
+struct Huge {
+    char data[1 << 20];
+};
+
+using Quotes = Channel<3100, Quote>;
+using Bulks = Channel<3101, Bulk>;
+using Huges = Channel<3102, Huge>;
+
+template <class C, class U, class = void>
+struct CanSend : std::false_type {};
+
+template <class C, class U>
+struct CanSend<C, U, std::void_t<decltype(std::declval<C &>().Send(std::declval<const U &>()))>> : std::true_type {};
+
+static_assert(CanSend<Quotes, Quote>::value);
+static_assert(!CanSend<Quotes, Bulk>::value);
+static_assert(!CanSend<Quotes, int>::value);
+
+}  // namespace
+
+class ChannelTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Mailbox::Initialize();
+    }
+};
+
+TEST_F(ChannelTest, SendReceive) {
+    Mailbox sender;
+    Mailbox receiver;
+    Quotes quotesOut(sender);
+    Bulks bulksOut(sender);
+    Quotes quotesIn(receiver);
+    Bulks bulksIn(receiver);
+    EXPECT_TRUE(quotesIn.Register());
+    EXPECT_TRUE(bulksIn.Register());
+
+    EXPECT_TRUE(quotesOut.Send(Quote {7, 1.5}));
+    Bulk bulk {};
+    bulk.data[999] = 'z';
+    EXPECT_TRUE(bulksOut.Send(bulk));
+
+    Message msg;
+    ASSERT_TRUE(receiver.TryReceive(msg));
+    ASSERT_TRUE(Quotes::Is(msg));
+    EXPECT_FALSE(Bulks::Is(msg));
+    const Quote &quote = Quotes::Data(msg);
+    EXPECT_EQ(7, quote.id);
+    EXPECT_EQ(1.5, quote.price);
+    // Channel messages are ordinary messages to the rest of the library
+    ASSERT_NE(nullptr, msg.as<Quote>());
+    quotesIn.Release(msg);
+    EXPECT_EQ(nullptr, msg.m_data);
+
+    ASSERT_TRUE(receiver.TryReceive(msg));
+    ASSERT_TRUE(Bulks::Is(msg));
+    EXPECT_EQ('z', Bulks::Data(msg).data[999]);
+    receiver.ReleaseMessage(msg);
+
+    // Dispatch with the channels' Handlers
+    EXPECT_TRUE(quotesOut.Send(Quote {8, 2.5}));
+    ASSERT_TRUE(receiver.TryReceive(msg));
+    int id = 0;
+    EXPECT_TRUE((Dispatcher<Quotes::Handler, Bulks::Handler>::Dispatch(
+        receiver, msg, Overloaded {[&id](const Quote &q) { id = q.id; }, [](const Bulk &) {}})));
+    EXPECT_EQ(8, id);
+
+    EXPECT_TRUE(quotesIn.Unregister());
+    EXPECT_TRUE(bulksIn.Unregister());
+}
+
+TEST_F(ChannelTest, ForeignMessages) {
+    Mailbox sender;
+    Mailbox receiver;
+    Quotes quotesIn(receiver);
+    EXPECT_TRUE(quotesIn.Register());
+
+    // Messages sent on the channel's label by other means are rejected by Data() and released
+    // to the pools they came from
+    const std::pmr::string text(100, 'x');
+    EXPECT_TRUE(sender.SendMessage(Quotes::LABEL, text));
+    EXPECT_TRUE(sender.SendMessage(Quotes::LABEL, Bulk {}));
+    EXPECT_TRUE(sender.SendSignal(Quotes::LABEL));
+    Message msg;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(receiver.TryReceive(msg));
+        EXPECT_TRUE(Quotes::Is(msg));
+        EXPECT_THROW(Quotes::Data(std::as_const(msg)), std::invalid_argument);
+        EXPECT_THROW(Quotes::Data(msg), std::invalid_argument);
+        quotesIn.Release(msg);
+        EXPECT_EQ(nullptr, msg.m_data);
+    }
+
+    // The pools are intact
+    Quotes quotesOut(sender);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(quotesOut.Send(Quote {i, 0.0}));
+        ASSERT_TRUE(receiver.TryReceive(msg));
+        EXPECT_EQ(i, Quotes::Data(msg).id);
+        quotesIn.Release(msg);
+    }
+    EXPECT_TRUE(quotesIn.Unregister());
+}
+
+TEST_F(ChannelTest, TooLarge) {
+    Mailbox mbox;
+    EXPECT_THROW(Huges huges(mbox), std::length_error);
+}
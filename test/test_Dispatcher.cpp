@@ -0,0 +1,120 @@
+#include "msglib/Dispatcher.h"
+#include "msglib/Mailbox.h"
+#include "gtest/gtest.h"
+
+using namespace msglib;  // NOLINT
+
+namespace {
+
+struct Position {
+    int x;
+    int y;
+};
+
+struct Speed {
+    double value;
+};
+
+struct Big {
+    char data[4096];
+};
+
+constexpr Label POSITION = 3000;
+constexpr Label SPEED = 3001;
+constexpr Label STOP = 3003;
+constexpr Label BIG = 3004;
+constexpr Label FAR = 9000;
+constexpr Label OTHER = 3002;
+
+using DenseDispatcher = Dispatcher<Handler<POSITION, Position>, Handler<SPEED, Speed>, Handler<STOP>, Handler<BIG, Big>>;
+using SparseDispatcher = Dispatcher<Handler<POSITION, Position>, Handler<FAR, Speed>, Handler<10, Position>>;
+
+static_assert(DenseDispatcher::DENSE);
+static_assert(!SparseDispatcher::DENSE);
+
+}  // namespace
+
+class DispatcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Mailbox::Initialize();
+    }
+};
+
+TEST_F(DispatcherTest, Dense) {
+    Mailbox mbox;
+    for (auto label : {POSITION, SPEED, STOP, BIG, OTHER}) {
+        mbox.RegisterForLabel(label);
+    }
+
+    int x = 0;
+    double speed = 0;
+    bool stopped = false;
+    char big = 0;
+    Label other = 0;
+    auto visitor = Overloaded {[&x](const Position &p) { x = p.x; },
+        [&speed](LabelConstant<SPEED>, const Speed &s) { speed = s.value; },
+        [&stopped](LabelConstant<STOP>) { stopped = true; }, [&big](const Big &b) { big = b.data[4095]; },
+        [&other](const Message &msg) { other = msg.m_label; }};
+
+    EXPECT_TRUE(mbox.SendMessage(POSITION, Position {1, 2}));
+    EXPECT_TRUE(mbox.SendMessage(SPEED, Speed {3.5}));
+    EXPECT_TRUE(mbox.SendSignal(STOP));
+    auto bigMsg = std::make_unique<Big>();
+    bigMsg->data[4095] = 'z';
+    EXPECT_TRUE(mbox.SendBytes(BIG, ByteSpan(reinterpret_cast<const std::byte *>(bigMsg.get()), sizeof(Big))));
+    // Wrong size for the label's type
+    EXPECT_TRUE(mbox.SendMessage(SPEED, 5));
+    EXPECT_TRUE(mbox.SendSignal(OTHER));
+
+    EXPECT_EQ(POSITION, DenseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ(1, x);
+    EXPECT_EQ(SPEED, DenseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ(3.5, speed);
+    EXPECT_EQ(STOP, DenseDispatcher::Receive(mbox, visitor));
+    EXPECT_TRUE(stopped);
+    EXPECT_EQ(BIG, DenseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ('z', big);
+
+    // Mismatched and unknown messages go to the fallback, and are released either way
+    Message msg;
+    mbox.Receive(msg);
+    EXPECT_FALSE(DenseDispatcher::Dispatch(mbox, msg, visitor));
+    EXPECT_EQ(SPEED, other);
+    EXPECT_EQ(nullptr, msg.m_data);
+    EXPECT_EQ(SPEED, msg.m_label);
+    EXPECT_EQ(OTHER, DenseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ(OTHER, other);
+
+    for (auto label : {POSITION, SPEED, STOP, BIG, OTHER}) {
+        mbox.UnregisterForLabel(label);
+    }
+}
+
+TEST_F(DispatcherTest, Sparse) {
+    Mailbox mbox;
+    for (auto label : {POSITION, FAR, Label {10}, OTHER}) {
+        mbox.RegisterForLabel(label);
+    }
+
+    int sum = 0;
+    double speed = 0;
+    auto visitor = Overloaded {[&sum](const Position &p) { sum += p.x; }, [&speed](const Speed &s) { speed = s.value; }};
+
+    EXPECT_TRUE(mbox.SendMessage(10, Position {1, 0}));
+    EXPECT_TRUE(mbox.SendMessage(FAR, Speed {2.5}));
+    EXPECT_TRUE(mbox.SendMessage(POSITION, Position {10, 0}));
+    EXPECT_TRUE(mbox.SendMessage(OTHER, Position {100, 0}));
+
+    EXPECT_EQ(10, SparseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ(FAR, SparseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ(POSITION, SparseDispatcher::Receive(mbox, visitor));
+    // No fallback handler, so unknown labels are ignored
+    EXPECT_EQ(OTHER, SparseDispatcher::Receive(mbox, visitor));
+    EXPECT_EQ(11, sum);
+    EXPECT_EQ(2.5, speed);
+
+    for (auto label : {POSITION, FAR, Label {10}, OTHER}) {
+        mbox.UnregisterForLabel(label);
+    }
+}
@@ -0,0 +1,170 @@
+#include "msglib/Journal.h"
+#include "gtest/gtest.h"
+#include <array>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msglib;  // NOLINT
+using namespace std::chrono_literals;
+
+struct JournalMsg {
+    int a;
+    int b;
+    int c;
+};
+
+class JournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        msglib::Mailbox mbox;
+        mbox.Initialize();
+    }
+
+    const std::string m_path = ::testing::TempDir() + "msglib_journal.bin";
+
+    void TearDown() override {
+        std::remove(m_path.c_str());
+    }
+};
+
+TEST_F(JournalTest, CaptureReplay) {
+    Label Msg1 = 1800;  // NOLINT
+    Label Sig1 = 1801;  // NOLINT
+    Label Bytes1 = 1802;  // NOLINT
+
+    // Larger than a "large" pool block, so sent as a chain of blocks
+    std::vector<std::byte> big(3000);
+    for (size_t i = 0; i < big.size(); i++) {
+        big[i] = static_cast<std::byte>(i);
+    }
+
+    Mailbox sender;
+    {
+        Journal journal(m_path);
+        Mailbox consumer;
+        for (Label label : {Msg1, Sig1, Bytes1}) {
+            EXPECT_TRUE(journal.RegisterForLabel(label));
+            EXPECT_TRUE(consumer.RegisterForLabel(label));
+        }
+        EXPECT_EQ(0, journal.Size());
+
+        EXPECT_TRUE(sender.SendMessage(Msg1, JournalMsg {1, 2, 3}));
+        EXPECT_TRUE(sender.SendSignal(Sig1));
+        EXPECT_TRUE(sender.SendBytes(Bytes1, ByteSpan(big.data(), big.size())));
+        EXPECT_TRUE(sender.SendMessage(Msg1, JournalMsg {4, 5, 6}));
+
+        // The other receivers are unaffected
+        Message msg;
+        size_t received = 0;
+        while (consumer.TryReceive(msg)) {
+            MessageGuard guard(consumer, msg);
+            received++;
+        }
+        EXPECT_EQ(4, received);
+
+        EXPECT_EQ(detail::JournalRecordSize(sizeof(JournalMsg)) * 2 + detail::JournalRecordSize(0) +
+                      detail::JournalRecordSize(big.size()),
+            journal.Size());
+        EXPECT_EQ(0, journal.Dropped());
+        EXPECT_TRUE(journal.Sync());
+        for (Label label : {Msg1, Sig1, Bytes1}) {
+            journal.UnregisterForLabel(label);
+            consumer.UnregisterForLabel(label);
+        }
+    }
+
+    JournalReader reader(m_path);
+    JournalReader::Entry entry {};
+    ASSERT_TRUE(reader.Next(entry));
+    EXPECT_EQ(Msg1, entry.m_label);
+    ASSERT_EQ(sizeof(JournalMsg), entry.m_data.size());
+    EXPECT_EQ(1, reinterpret_cast<const JournalMsg *>(entry.m_data.data())->a);
+    const uint64_t first = entry.m_timestamp;
+    ASSERT_TRUE(reader.Next(entry));
+    EXPECT_EQ(Sig1, entry.m_label);
+    EXPECT_TRUE(entry.m_data.empty());
+    EXPECT_GE(entry.m_timestamp, first);
+    ASSERT_TRUE(reader.Next(entry));
+    EXPECT_EQ(Bytes1, entry.m_label);
+    ASSERT_EQ(big.size(), entry.m_data.size());
+    EXPECT_EQ(0, std::memcmp(big.data(), entry.m_data.data(), big.size()));
+    ASSERT_TRUE(reader.Next(entry));
+    EXPECT_EQ(4, reinterpret_cast<const JournalMsg *>(entry.m_data.data())->a);
+    EXPECT_FALSE(reader.Next(entry));
+
+    // Replay into a fresh mailbox, with a smaller queue than the journal to exercise retries
+    reader.Rewind();
+    Mailbox replayed(2);
+    for (Label label : {Msg1, Sig1, Bytes1}) {
+        EXPECT_TRUE(replayed.RegisterForLabel(label));
+    }
+    std::vector<Label> labels;
+    std::vector<int> values;
+    std::thread consumer([&replayed, &labels, &values]() {
+        for (int i = 0; i < 4; i++) {
+            Message msg;
+            replayed.Receive(msg);
+            MessageGuard guard(replayed, msg);
+            labels.push_back(msg.m_label);
+            if (auto *m = msg.as<JournalMsg>(); m != nullptr) {
+                values.push_back(m->a);
+            }
+        }
+    });
+    EXPECT_EQ(4, ReplayJournal(reader, sender));
+    consumer.join();
+    EXPECT_EQ((std::vector<Label> {Msg1, Sig1, Bytes1, Msg1}), labels);
+    EXPECT_EQ((std::vector<int> {1, 4}), values);
+
+    for (Label label : {Msg1, Sig1, Bytes1}) {
+        replayed.UnregisterForLabel(label);
+    }
+}
+
+TEST_F(JournalTest, PacingAndCapacity) {
+    Label Sig1 = 1803;  // NOLINT
+    Label Req1 = 1804;  // NOLINT
+
+    Mailbox sender;
+    {
+        Journal journal(m_path, detail::JournalRecordSize(0) * 2);
+        EXPECT_TRUE(journal.RegisterForLabel(Sig1));
+        EXPECT_TRUE(sender.SendSignal(Sig1));
+        std::this_thread::sleep_for(50ms);
+        EXPECT_TRUE(sender.SendSignal(Sig1));
+        // Full, so counted as dropped without failing the send
+        EXPECT_TRUE(sender.SendSignal(Sig1));
+        EXPECT_EQ(1, journal.Dropped());
+        journal.UnregisterForLabel(Sig1);
+
+        // Requests go to the responder, not the journal registered before it
+        Mailbox responder;
+        EXPECT_TRUE(journal.RegisterForLabel(Req1));
+        EXPECT_TRUE(responder.RegisterForLabel(Req1));
+        EXPECT_FALSE((sender.Call<JournalMsg, int>(Req1, JournalMsg {41, 0, 0}, 10ms)));
+        Message msg;
+        ASSERT_TRUE(responder.TryReceive(msg));
+        EXPECT_TRUE(msg.request());
+        responder.ReleaseMessage(msg);
+        EXPECT_EQ(1, journal.Dropped());
+        journal.UnregisterForLabel(Req1);
+        responder.UnregisterForLabel(Req1);
+    }
+
+    JournalReader reader(m_path);
+    Mailbox replayed;
+    EXPECT_TRUE(replayed.RegisterForLabel(Sig1));
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(2, ReplayJournal(reader, sender, ReplayPacing::ORIGINAL));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 40ms);
+    Message msg;
+    EXPECT_TRUE(replayed.TryReceive(msg));
+    EXPECT_TRUE(replayed.TryReceive(msg));
+    EXPECT_FALSE(replayed.TryReceive(msg));
+    replayed.UnregisterForLabel(Sig1);
+
+    EXPECT_THROW(JournalReader("/nonexistent/msglib_journal.bin"), std::runtime_error);
+    EXPECT_THROW(Journal("/nonexistent/msglib_journal.bin"), std::runtime_error);
+}
@@ -1,8 +1,15 @@
 #include "msglib/Mailbox.h"
+#include "msglib/SpscMailbox.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace msglib;  // NOLINT
+using namespace std::chrono_literals;
 
 struct MsgStruct {
     int a;
@@ -31,6 +38,30 @@ struct MsgBig {
     }
 };
 
+struct Tracked {
+    explicit Tracked(std::string name) : m_name(std::move(name)) {
+        s_live++;
+    }
+    Tracked(const Tracked &rhs) : m_name(rhs.m_name) {
+        s_live++;
+    }
+    Tracked(Tracked &&rhs) noexcept : m_name(std::move(rhs.m_name)) {
+        s_live++;
+    }
+    Tracked &operator=(const Tracked &) = delete;
+    Tracked &operator=(Tracked &&) = delete;
+    ~Tracked() {
+        s_live--;
+    }
+
+    std::string m_name;
+    inline static int s_live = 0;
+};
+
+struct TrackedAlias : Tracked {
+    using Tracked::Tracked;
+};
+
 struct HugeMsg {
     char data[8192];
 
@@ -114,7 +145,7 @@ TEST_F(MailboxTest, MessageTest) {
 #endif
 
 TEST_F(MailboxTest, Receivers) {
-    detail::Receivers r;
+    detail::Receivers r {};
     Mailbox mbox1;
     Mailbox mbox2;
     Mailbox mbox3;
@@ -242,6 +273,32 @@ TEST(MailboxTest, MailboxDataRegister) {
 }
 #endif
 
+TEST_F(MailboxTest, MailboxDataMaxLabels) {
+    Mailbox mbox;
+    {
+        msglib::Options options;
+        options.m_maxLabels = 16;  // NOLINT
+        detail::MailboxData data;
+        EXPECT_TRUE(data.Initialize(options));
+        EXPECT_EQ(16U, data.maxLabels());
+
+        EXPECT_TRUE(data.RegisterForLabel(15, &mbox));
+        EXPECT_EQ(&mbox, data.GetReceivers(15).m_receivers[0]);
+        EXPECT_FALSE(data.RegisterForLabel(16, &mbox));
+        EXPECT_EQ(nullptr, data.GetReceivers(16).m_receivers[0]);
+        EXPECT_TRUE(data.UnregisterForLabel(15, &mbox));
+        EXPECT_FALSE(data.UnregisterForLabel(16, &mbox));
+    }
+    {
+        // Registering before Initialize() initializes with default options
+        detail::MailboxData data;
+        EXPECT_EQ(nullptr, data.GetReceivers(1).m_receivers[0]);
+        EXPECT_TRUE(data.RegisterForLabel(1, &mbox));
+        EXPECT_EQ(msglib::detail::MAX_LABELS, data.maxLabels());
+        EXPECT_EQ(&mbox, data.GetReceivers(1).m_receivers[0]);
+    }
+}
+
 TEST_F(MailboxTest, SendFail) {
     Mailbox mbx;
     Label Msg1 = 555;  // NOLINT
@@ -319,3 +376,719 @@ TEST_F(MailboxTest, MailboxTest) {
     mbox2.UnregisterForLabel(Msg2);
     mbox2.UnregisterForLabel(Msg3);
 }
+
+TEST_F(MailboxTest, SendBytes) {
+    Label Msg1 = 1555;  // NOLINT
+
+    Mailbox mbox1;
+    Mailbox mbox2;
+    mbox1.RegisterForLabel(Msg1);
+
+    const char text[] = "variable length payload";  // NOLINT
+    EXPECT_TRUE(mbox2.SendBytes(Msg1, ByteSpan(reinterpret_cast<const std::byte *>(text), sizeof(text))));
+    {
+        Message msg;
+        mbox1.Receive(msg);
+        MessageGuard guard(mbox1, msg);
+
+        EXPECT_EQ(Msg1, msg.m_label);
+        EXPECT_EQ(sizeof(text), msg.m_size);
+        auto bytes = msg.bytes();
+        EXPECT_EQ(sizeof(text), bytes.size());
+        EXPECT_EQ(0, memcmp(text, bytes.data(), sizeof(text)));
+    }
+
+    // Payload larger than the small pool goes to the large pool
+    std::array<std::byte, 1000> body {};  // NOLINT
+    body.fill(std::byte {0x5a});
+    EXPECT_TRUE(mbox2.SendBytes(Msg1, ByteSpan(body.data(), body.size())));
+    {
+        Message msg;
+        mbox1.Receive(msg);
+        MessageGuard guard(mbox1, msg);
+
+        EXPECT_EQ(body.size(), msg.bytes().size());
+        EXPECT_EQ(0, memcmp(body.data(), msg.bytes().data(), body.size()));
+    }
+
+    // Empty payload is delivered without a data block
+    EXPECT_TRUE(mbox2.SendBytes(Msg1, ByteSpan()));
+    {
+        Message msg;
+        mbox1.Receive(msg);
+        MessageGuard guard(mbox1, msg);
+
+        EXPECT_EQ(Msg1, msg.m_label);
+        EXPECT_EQ(nullptr, msg.m_data);
+        EXPECT_TRUE(msg.bytes().empty());
+    }
+
+    mbox1.UnregisterForLabel(Msg1);
+}
+
+TEST_F(MailboxTest, SendBytesGather) {
+    Label Msg1 = 1556;  // NOLINT
+
+    Mailbox mbox1;
+    Mailbox mbox2;
+    mbox1.RegisterForLabel(Msg1);
+
+    TestMessage header {1, 2, 3};
+    const char body[] = "body";  // NOLINT
+    EXPECT_TRUE(mbox2.SendBytes(Msg1, {ByteSpan(reinterpret_cast<const std::byte *>(&header), sizeof(header)),
+                                          ByteSpan(reinterpret_cast<const std::byte *>(body), sizeof(body))}));
+    {
+        Message msg;
+        mbox1.Receive(msg);
+        MessageGuard guard(mbox1, msg);
+
+        EXPECT_EQ(sizeof(header) + sizeof(body), msg.m_size);
+        auto bytes = msg.bytes();
+        TestMessage rxHeader {};
+        memcpy(&rxHeader, bytes.data(), sizeof(rxHeader));
+        EXPECT_EQ(1, rxHeader.a);
+        EXPECT_EQ(2, rxHeader.b);
+        EXPECT_EQ(3, rxHeader.c);
+        EXPECT_EQ(0, memcmp(body, bytes.data() + sizeof(header), sizeof(body)));
+    }
+
+    mbox1.UnregisterForLabel(Msg1);
+}
+
+TEST_F(MailboxTest, SendBytesChained) {
+    Label Msg1 = 1557;  // NOLINT
+
+    Mailbox mbox1;
+    Mailbox mbox2;
+    mbox1.RegisterForLabel(Msg1);
+
+    // Payload larger than the large pool is split across a chain of large blocks
+    std::vector<std::byte> snapshot(100000);  // NOLINT
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        snapshot[i] = static_cast<std::byte>(i % 251);  // NOLINT
+    }
+    EXPECT_TRUE(mbox2.SendBytes(Msg1, ByteSpan(snapshot.data(), snapshot.size())));
+    {
+        Message msg;
+        mbox1.Receive(msg);
+        MessageGuard guard(mbox1, msg);
+
+        EXPECT_TRUE(msg.chained());
+        EXPECT_EQ(snapshot.size(), msg.m_size);
+        EXPECT_TRUE(msg.bytes().empty());
+        EXPECT_EQ(nullptr, msg.as<TestMessage>());
+        EXPECT_GT(msg.segments().count(), 1U);
+
+        size_t total = 0;
+        for (auto segment : msg.segments()) {
+            EXPECT_EQ(0, memcmp(snapshot.data() + total, segment.data(), segment.size()));
+            total += segment.size();
+        }
+        EXPECT_EQ(snapshot.size(), total);
+
+        std::vector<std::byte> copy(snapshot.size());
+        EXPECT_EQ(snapshot.size(), msg.copyTo(copy.data(), copy.size()));
+        EXPECT_EQ(snapshot, copy);
+    }
+
+    // Chain blocks were returned to the pool, so the same payload can be sent again
+    EXPECT_TRUE(mbox2.SendBytes(Msg1, ByteSpan(snapshot.data(), snapshot.size())));
+    {
+        Message msg;
+        mbox1.Receive(msg);
+        MessageGuard guard(mbox1, msg);
+        EXPECT_EQ(snapshot.size(), msg.m_size);
+    }
+
+    // Payload needing more blocks than the large pool holds is rejected
+    std::vector<std::byte> tooBig(detail::LARGE_SIZE * (detail::LARGE_CAP + 1));
+    EXPECT_FALSE(mbox2.SendBytes(Msg1, ByteSpan(tooBig.data(), tooBig.size())));
+
+    mbox1.UnregisterForLabel(Msg1);
+}
+
+TEST_F(MailboxTest, Call) {
+    Label Req1 = 1570;  // NOLINT
+    constexpr int COUNT = 100;
+
+    Mailbox client;
+    // No receiver for the request label
+    EXPECT_FALSE((client.Call<MsgStruct, TestMessage>(Req1, MsgStruct {1}, 10ms)));
+
+    std::atomic<bool> ready {false};
+    std::thread server([&ready, Req1]() {
+        Mailbox mbox;
+        mbox.RegisterForLabel(Req1);
+        ready = true;
+        for (int i = 0; i <= COUNT; i++) {
+            Message rx;
+            mbox.Receive(rx);
+            MessageGuard guard(mbox, rx);
+            auto *req = rx.as<MsgStruct>();
+            if (rx.request() && req != nullptr && req->a >= 0) {
+                EXPECT_TRUE(mbox.Reply(rx, TestMessage {req->a, req->a + 1, req->a + 2}));
+            } else if (req != nullptr) {
+                // Reply only after the caller has given up
+                std::this_thread::sleep_for(50ms);
+                EXPECT_FALSE(mbox.Reply(rx, TestMessage {}));
+            }
+        }
+        mbox.UnregisterForLabel(Req1);
+    });
+    while (!ready) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < COUNT; i++) {
+        auto resp = client.Call<MsgStruct, TestMessage>(Req1, MsgStruct {i}, 1s);
+        ASSERT_TRUE(resp.has_value());
+        EXPECT_EQ(i, resp->a);
+        EXPECT_EQ(i + 2, resp->c);
+    }
+    // Timed out calls release their correlation slot, and late replies are discarded
+    EXPECT_FALSE((client.Call<MsgStruct, TestMessage>(Req1, MsgStruct {-1}, 10ms)));
+    server.join();
+
+    // Replying to an ordinary message fails
+    Message plain(Req1);
+    EXPECT_FALSE(client.Reply(plain, TestMessage {}));
+}
+
+TEST_F(MailboxTest, SharedGroup) {
+    Label Work = 1590;  // NOLINT
+    Label Stop = 1591;  // NOLINT
+    constexpr int COUNT = 30;
+
+    Mailbox sender;
+    Mailbox observer;
+    Mailbox worker1;
+    Mailbox worker2;
+    Mailbox worker3(2);
+
+    EXPECT_TRUE(observer.RegisterForLabel(Work));
+    for (auto *worker : {&worker1, &worker2, &worker3}) {
+        EXPECT_TRUE(worker->RegisterForLabel(Work, Mode::Shared));
+        EXPECT_TRUE(worker->RegisterForLabel(Stop, Mode::Shared));
+    }
+
+    // Each message goes to one worker (round-robin, skipping worker3 once its queue is full)
+    // and to the broadcast observer
+    for (int i = 0; i < COUNT; i++) {
+        EXPECT_TRUE(sender.SendMessage(Work, MsgStruct {i}));
+    }
+    auto drain = [](Mailbox &mbox) {
+        std::vector<int> values;
+        Message msg;
+        while (mbox.TryReceive(msg)) {
+            MessageGuard guard(mbox, msg);
+            values.push_back(msg.as<MsgStruct>()->a);
+        }
+        return values;
+    };
+    auto values1 = drain(worker1);
+    auto values2 = drain(worker2);
+    auto values3 = drain(worker3);
+    EXPECT_EQ(2U, values3.size());
+    EXPECT_EQ(COUNT, static_cast<int>(values1.size() + values2.size() + values3.size()));
+    EXPECT_EQ(0, values1[0]);
+    EXPECT_EQ(1, values2[0]);
+    EXPECT_EQ(2, values3[0]);
+    EXPECT_EQ(3, values1[1]);
+    EXPECT_EQ(static_cast<size_t>(COUNT), drain(observer).size());
+
+    // Signals go to one worker too
+    EXPECT_TRUE(sender.SendSignal(Stop));
+    Message msg;
+    int stops = 0;
+    for (auto *worker : {&worker1, &worker2, &worker3}) {
+        while (worker->TryReceive(msg)) {
+            EXPECT_EQ(Stop, msg.m_label);
+            stops++;
+        }
+    }
+    EXPECT_EQ(1, stops);
+
+    // Leaving the group stops delivery to that member
+    worker1.UnregisterForLabel(Work);
+    worker2.UnregisterForLabel(Work);
+    for (int i = 0; i < 2; i++) {
+        EXPECT_TRUE(sender.SendMessage(Work, MsgStruct {i}));
+    }
+    EXPECT_EQ(2U, drain(worker3).size());
+    EXPECT_TRUE(drain(worker1).empty());
+    drain(observer);
+
+    worker3.UnregisterForLabel(Work);
+    observer.UnregisterForLabel(Work);
+    for (auto *worker : {&worker1, &worker2, &worker3}) {
+        worker->UnregisterForLabel(Stop);
+    }
+}
+
+TEST_F(MailboxTest, PartitionedSend) {
+    Label Work = 1592;  // NOLINT
+    constexpr int KEYS = 40;
+    constexpr int ROUNDS = 5;
+
+    Mailbox sender;
+    std::array<std::unique_ptr<Mailbox>, 3> workers;
+    for (auto &worker : workers) {
+        worker = std::make_unique<Mailbox>(KEYS * ROUNDS);
+        EXPECT_TRUE(worker->RegisterForLabel(Work, Mode::Shared));
+    }
+
+    // Returns the worker which received each key, checking that each key's messages arrived in order
+    auto receive = [&workers](size_t count) {
+        std::array<int, KEYS> owner {};
+        std::array<int, KEYS> next {};
+        owner.fill(-1);
+        for (size_t w = 0; w < count; w++) {
+            Message msg;
+            while (workers[w]->TryReceive(msg)) {
+                MessageGuard guard(*workers[w], msg);
+                auto *m = msg.as<TestMessage>();
+                EXPECT_TRUE(owner[m->a] == -1 || owner[m->a] == static_cast<int>(w));
+                owner[m->a] = static_cast<int>(w);
+                EXPECT_EQ(next[m->a]++, m->b);
+            }
+        }
+        return owner;
+    };
+
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int key = 0; key < KEYS; key++) {
+            EXPECT_TRUE(sender.SendMessage(Work, static_cast<uint64_t>(key), TestMessage {key, round, 0}));
+        }
+    }
+    auto before = receive(workers.size());
+    std::array<int, 3> perWorker {};
+    for (int owner : before) {
+        ASSERT_NE(-1, owner);
+        perWorker[owner]++;
+    }
+    for (int count : perWorker) {
+        EXPECT_GT(count, 0);
+    }
+
+    // When the last worker leaves only its keys move
+    workers[2]->UnregisterForLabel(Work);
+    for (int key = 0; key < KEYS; key++) {
+        EXPECT_TRUE(sender.SendMessage(Work, static_cast<uint64_t>(key), TestMessage {key, 0, 0}));
+    }
+    auto after = receive(2);
+    for (int key = 0; key < KEYS; key++) {
+        if (before[key] != 2) {
+            EXPECT_EQ(before[key], after[key]);
+        }
+    }
+
+    // And when it rejoins it takes the same keys back
+    EXPECT_TRUE(workers[2]->RegisterForLabel(Work, Mode::Shared));
+    for (int key = 0; key < KEYS; key++) {
+        EXPECT_TRUE(sender.SendMessage(Work, static_cast<uint64_t>(key), TestMessage {key, 0, 0}));
+    }
+    EXPECT_EQ(before, receive(workers.size()));
+
+    for (auto &worker : workers) {
+        worker->UnregisterForLabel(Work);
+    }
+}
+
+TEST_F(MailboxTest, SpscMailbox) {
+    Label Msg1 = 1558;  // NOLINT
+    Label Sig1 = 1559;  // NOLINT
+    constexpr int COUNT = 1000;
+
+    SpscMailbox<8> mbox;
+    Message msg;
+    EXPECT_FALSE(mbox.TryReceive(msg));
+    EXPECT_FALSE(mbox.Receive(msg, 10ms));
+
+    std::thread producer([&mbox, Msg1, Sig1]() {
+        for (int i = 0; i < COUNT; i++) {
+            TestMessage m {i, i + 1, i + 2};
+            while (!mbox.Send(Msg1, m)) {
+                std::this_thread::yield();
+            }
+        }
+        while (!mbox.SendSignal(Sig1)) {
+            std::this_thread::yield();
+        }
+    });
+
+    bool ordered = true;
+    for (int i = 0; i < COUNT; i++) {
+        Message rx;
+        mbox.Receive(rx);
+        MessageGuard guard(mbox, rx);
+        auto *m = rx.as<TestMessage>();
+        ordered &= (rx.m_label == Msg1 && m != nullptr && m->a == i && m->c == i + 2);
+    }
+    {
+        Message rx;
+        mbox.Receive(rx);
+        EXPECT_EQ(Sig1, rx.m_label);
+        EXPECT_EQ(nullptr, rx.m_data);
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+
+    // Messages still queued at destruction are released back to the pools
+    {
+        SpscMailbox<4> pending;
+        EXPECT_TRUE(pending.Send(Msg1, TestMessage {1, 2, 3}));
+        const char text[] = "pending";  // NOLINT
+        EXPECT_TRUE(pending.SendBytes(Msg1, ByteSpan(reinterpret_cast<const std::byte *>(text), sizeof(text))));
+    }
+
+    HugeMsg huge;
+    EXPECT_FALSE(mbox.Send(Msg1, huge));
+}
+
+template <class MailboxType>
+class MailboxPolicyTest : public MailboxTest {};
+
+using MailboxPolicyTypes = ::testing::Types<BasicMailbox<LockedQueue, BlockingWait, HeapStorage>,
+    BasicMailbox<LockedQueue, SpinWait, InlineStorage<16>>, BasicMailbox<LockFreeQueue, BlockingWait, HeapStorage>,
+    BasicMailbox<LockFreeQueue, SpinWait, InlineStorage<16>>, BasicMailbox<LockFreeQueue, BlockingWait, NumaStorage>>;
+TYPED_TEST_SUITE(MailboxPolicyTest, MailboxPolicyTypes);
+
+TYPED_TEST(MailboxPolicyTest, SendReceive) {
+    Label Msg1 = 1560;  // NOLINT
+    Label Sig1 = 1561;  // NOLINT
+    constexpr int COUNT = 1000;
+
+    TypeParam mbox;
+    Mailbox sender;
+    EXPECT_TRUE(mbox.RegisterForLabel(Msg1));
+    EXPECT_TRUE(mbox.RegisterForLabel(Sig1));
+
+    Message msg;
+    EXPECT_FALSE(mbox.TryReceive(msg));
+    EXPECT_FALSE(mbox.Receive(msg, 10ms));
+
+    // Blocking/spinning receive woken by another thread's sends
+    std::thread producer([&sender, Msg1, Sig1]() {
+        for (int i = 0; i < COUNT; i++) {
+            TestMessage m {i, i + 1, i + 2};
+            while (!sender.SendMessage(Msg1, m)) {
+                std::this_thread::yield();
+            }
+        }
+        sender.SendSignal(Sig1);
+    });
+
+    bool ordered = true;
+    for (int i = 0; i < COUNT; i++) {
+        Message rx;
+        mbox.Receive(rx);
+        MessageGuard guard(mbox, rx);
+        auto *m = rx.as<TestMessage>();
+        ordered &= (rx.m_label == Msg1 && m != nullptr && m->a == i);
+    }
+    {
+        Message rx;
+        EXPECT_TRUE(mbox.Receive(rx, 1s));
+        EXPECT_EQ(Sig1, rx.m_label);
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+
+    mbox.UnregisterForLabel(Msg1);
+    mbox.UnregisterForLabel(Sig1);
+}
+
+TYPED_TEST(MailboxPolicyTest, ReceiveIf) {
+    Label MsgA = 1563;  // NOLINT
+    Label MsgB = 1564;  // NOLINT
+    Label MsgC = 1565;  // NOLINT
+    Label Reply = 1566;  // NOLINT
+
+    TypeParam mbox;
+    Mailbox sender;
+    for (Label label : {MsgA, MsgB, MsgC, Reply}) {
+        EXPECT_TRUE(mbox.RegisterForLabel(label));
+    }
+
+    // Queued A1 B1 A2 C1 B2
+    EXPECT_TRUE(sender.SendMessage(MsgA, TestMessage {1, 0, 0}));
+    EXPECT_TRUE(sender.SendMessage(MsgB, TestMessage {1, 0, 0}));
+    EXPECT_TRUE(sender.SendMessage(MsgA, TestMessage {2, 0, 0}));
+    EXPECT_TRUE(sender.SendSignal(MsgC));
+    EXPECT_TRUE(sender.SendMessage(MsgB, TestMessage {2, 0, 0}));
+
+    Message msg;
+    EXPECT_TRUE(mbox.ReceiveIf({MsgB}, msg, 10ms));
+    EXPECT_EQ(MsgB, msg.m_label);
+    EXPECT_EQ(1, msg.as<TestMessage>()->a);
+    mbox.ReleaseMessage(msg);
+
+    // C1 is found in the queue, setting A2 aside
+    EXPECT_TRUE(mbox.ReceiveIf({MsgC, Reply}, msg, 10ms));
+    EXPECT_EQ(MsgC, msg.m_label);
+
+    // A2 is found among the messages set aside
+    EXPECT_TRUE(mbox.ReceiveIf(
+        [MsgA](const Message &m) { return m.m_label == MsgA && m.as<TestMessage>()->a == 2; }, msg, 10ms));
+    EXPECT_EQ(2, msg.as<TestMessage>()->a);
+    mbox.ReleaseMessage(msg);
+
+    EXPECT_FALSE(mbox.ReceiveIf({MsgC}, msg, 10ms));
+
+    // Wait for a reply sent by another thread while other messages keep arriving
+    std::thread producer([&sender, MsgC, Reply]() {
+        sender.SendSignal(MsgC);
+        std::this_thread::sleep_for(20ms);
+        sender.SendSignal(Reply);
+    });
+    EXPECT_TRUE(mbox.ReceiveIf({Reply}, msg, 1s));
+    EXPECT_EQ(Reply, msg.m_label);
+    producer.join();
+
+    // The remaining messages are received in their original order: A1 B2 C
+    const std::array<std::pair<Label, int>, 3> expected {{{MsgA, 1}, {MsgB, 2}, {MsgC, 0}}};
+    for (const auto &[label, value] : expected) {
+        EXPECT_TRUE(mbox.TryReceive(msg));
+        EXPECT_EQ(label, msg.m_label);
+        if (value != 0) {
+            EXPECT_EQ(value, msg.as<TestMessage>()->a);
+            mbox.ReleaseMessage(msg);
+        }
+    }
+    EXPECT_FALSE(mbox.TryReceive(msg));
+
+    // Only as many messages as the queue capacity can be set aside
+    for (size_t i = 0; i < mbox.QUEUE_SIZE; i++) {
+        EXPECT_TRUE(sender.SendSignal(MsgA));
+    }
+    EXPECT_FALSE(mbox.ReceiveIf({MsgB}, msg, 10ms));
+    EXPECT_TRUE(sender.SendSignal(MsgB));
+    EXPECT_FALSE(mbox.ReceiveIf({MsgB}, msg, 10ms));
+    size_t count = 0;
+    while (mbox.TryReceive(msg)) {
+        count++;
+    }
+    EXPECT_EQ(mbox.QUEUE_SIZE + 1, count);
+    EXPECT_EQ(MsgB, msg.m_label);
+
+    for (Label label : {MsgA, MsgB, MsgC, Reply}) {
+        mbox.UnregisterForLabel(label);
+    }
+}
+
+TEST_F(MailboxTest, WaitAny) {
+    Label High = 1567;  // NOLINT
+    Label Low = 1568;  // NOLINT
+
+    Mailbox high;
+    BasicMailbox<LockFreeQueue, SpinWait, InlineStorage<16>> low;
+    Mailbox sender;
+    EXPECT_TRUE(high.RegisterForLabel(High));
+    EXPECT_TRUE(low.RegisterForLabel(Low));
+
+    EXPECT_FALSE(WaitAny({&high, &low}, 10ms).has_value());
+
+    // Mailboxes are checked in order
+    EXPECT_TRUE(sender.SendSignal(Low));
+    EXPECT_EQ(1, WaitAny({&high, &low}, 10ms));
+    EXPECT_TRUE(sender.SendSignal(High));
+    EXPECT_EQ(0, WaitAny({&high, &low}));
+
+    Message msg;
+    EXPECT_TRUE(high.TryReceive(msg));
+    EXPECT_EQ(1, WaitAny({&high, &low}));
+    EXPECT_TRUE(low.TryReceive(msg));
+
+    // Woken by a message sent from another thread
+    std::thread producer([&sender, Low]() {
+        std::this_thread::sleep_for(20ms);
+        sender.SendSignal(Low);
+    });
+    EXPECT_EQ(1, WaitAny({&high, &low}, 1s));
+    producer.join();
+    EXPECT_TRUE(low.TryReceive(msg));
+
+    // A message set aside by ReceiveIf() is ready to receive
+    EXPECT_TRUE(sender.SendSignal(Low));
+    EXPECT_FALSE(low.ReceiveIf({High}, msg, 1ms));
+    EXPECT_EQ(1, WaitAny({&high, &low}, 10ms));
+    EXPECT_TRUE(low.TryReceive(msg));
+    EXPECT_EQ(Low, msg.m_label);
+
+    high.UnregisterForLabel(High);
+    low.UnregisterForLabel(Low);
+
+    // Only mailboxes which can report a pending message can be waited on
+    static_assert(std::is_convertible_v<BasicMailbox<LockFreeQueue, SpinWait, InlineStorage<16>> *, Waitable>);
+    static_assert(!std::is_convertible_v<SpscMailbox<4> *, Waitable>);
+    static_assert(!std::is_convertible_v<MailboxBase *, Waitable>);
+}
+
+TEST_F(MailboxTest, LabelRangeAndMask) {
+    Label First = 1900;  // NOLINT
+    Label Last = 1915;   // NOLINT
+
+    Mailbox sender;
+    Mailbox range;
+    Mailbox direct;
+    Mailbox masked;
+    EXPECT_TRUE(range.RegisterForLabelRange(First, Last));
+    EXPECT_FALSE(range.RegisterForLabelRange(First, Last));
+    EXPECT_FALSE(range.RegisterForLabelRange(Last, First));
+    // Registered individually as well, but still receives one copy
+    EXPECT_TRUE(range.RegisterForLabel(First + 1));
+    EXPECT_TRUE(direct.RegisterForLabel(First + 5));
+    // 0x0780-0x078F, i.e. 1920-1935
+    EXPECT_TRUE(masked.RegisterForLabelMask(0xFFF0, 0x0780));
+
+    EXPECT_TRUE(sender.SendSignal(First));
+    EXPECT_TRUE(sender.SendSignal(First + 1));
+    EXPECT_TRUE(sender.SendMessage(First + 5, TestMessage {1, 2, 3}));
+    EXPECT_TRUE(sender.SendSignal(Last + 1));
+    EXPECT_TRUE(sender.SendSignal(1930));
+    EXPECT_TRUE(sender.SendSignal(1936));
+
+    Message msg;
+    for (Label label : {First, static_cast<Label>(First + 1), static_cast<Label>(First + 5)}) {
+        ASSERT_TRUE(range.TryReceive(msg));
+        EXPECT_EQ(label, msg.m_label);
+        range.ReleaseMessage(msg);
+    }
+    EXPECT_FALSE(range.TryReceive(msg));
+    ASSERT_TRUE(direct.TryReceive(msg));
+    EXPECT_EQ(First + 5, msg.m_label);
+    EXPECT_EQ(3, msg.as<TestMessage>()->c);
+    direct.ReleaseMessage(msg);
+    ASSERT_TRUE(masked.TryReceive(msg));
+    EXPECT_EQ(1930, msg.m_label);
+    EXPECT_FALSE(masked.TryReceive(msg));
+
+    // A range subscriber takes requests for labels with no other receiver
+    EXPECT_FALSE((sender.Call<TestMessage, TestMessage>(First + 2, TestMessage {}, 10ms)));
+    ASSERT_TRUE(range.TryReceive(msg));
+    EXPECT_TRUE(msg.request());
+    range.ReleaseMessage(msg);
+
+    EXPECT_TRUE(range.UnregisterForLabelRange(First, Last));
+    EXPECT_FALSE(range.UnregisterForLabelRange(First, Last));
+    EXPECT_TRUE(masked.UnregisterForLabelMask(0xFFF0, 0x0780));
+    EXPECT_TRUE(sender.SendSignal(First));
+    EXPECT_TRUE(sender.SendSignal(1930));
+    EXPECT_FALSE(range.TryReceive(msg));
+    EXPECT_FALSE(masked.TryReceive(msg));
+
+    range.UnregisterForLabel(First + 1);
+    direct.UnregisterForLabel(First + 5);
+}
+
+TEST_F(MailboxTest, ObjectMessages) {
+    Label Obj1 = 1571;  // NOLINT
+    Label Obj2 = 1572;  // NOLINT
+
+    Mailbox sender;
+    Mailbox mbox1;
+    Mailbox mbox2;
+    mbox1.RegisterForLabel(Obj1);
+    mbox2.RegisterForLabel(Obj1);
+    mbox1.RegisterForLabel(Obj2);
+
+    // Each receiver gets its own copy, with the string's data in the message's block
+    const std::pmr::string text(100, 'x');
+    EXPECT_TRUE(sender.SendMessage(Obj1, text));
+    for (auto *mbox : {&mbox1, &mbox2}) {
+        Message msg;
+        ASSERT_TRUE(mbox->TryReceive(msg));
+        EXPECT_TRUE(msg.object());
+        EXPECT_EQ(nullptr, msg.as<Tracked>());
+        EXPECT_EQ(nullptr, msg.as<TestMessage>());
+        const auto *str = msg.as<std::pmr::string>();
+        ASSERT_NE(nullptr, str);
+        EXPECT_EQ(text, *str);
+        EXPECT_GE(str->data(), reinterpret_cast<const char *>(msg.m_data));
+        EXPECT_LT(str->data(), reinterpret_cast<const char *>(msg.m_data + msg.m_size));
+        MessageGuard guard(*mbox, msg);
+    }
+
+    // Nested allocations which don't fit in the block fail the send
+    EXPECT_FALSE(sender.SendMessage(Obj1, std::pmr::string(4096, 'y')));
+    Message msg;
+    EXPECT_FALSE(mbox1.TryReceive(msg));
+
+    // Moved into the only receiver; the destructor runs on release
+    {
+        EXPECT_TRUE(sender.SendMessage(Obj2, Tracked("moved")));
+        EXPECT_EQ(1, Tracked::s_live);
+        ASSERT_TRUE(mbox1.TryReceive(msg));
+        MessageGuard guard(mbox1, msg);
+        ASSERT_NE(nullptr, msg.as<Tracked>());
+        EXPECT_EQ("moved", msg.as<Tracked>()->m_name);
+        // A type with the same layout (and destructor code) doesn't match
+        EXPECT_EQ(nullptr, msg.as<TrackedAlias>());
+    }
+    EXPECT_EQ(0, Tracked::s_live);
+
+    // A const rvalue is copied, and received as the unqualified type
+    {
+        const Tracked constant("constant");
+        EXPECT_TRUE(sender.SendMessage(Obj2, std::move(constant)));  // NOLINT
+        ASSERT_TRUE(mbox1.TryReceive(msg));
+        MessageGuard guard(mbox1, msg);
+        ASSERT_NE(nullptr, msg.as<Tracked>());
+        EXPECT_EQ("constant", msg.as<Tracked>()->m_name);
+        EXPECT_EQ("constant", constant.m_name);
+    }
+    EXPECT_EQ(0, Tracked::s_live);
+
+    // Move-only types can be sent to one receiver
+    EXPECT_TRUE(sender.SendMessage(Obj2, std::make_unique<int>(42)));
+    ASSERT_TRUE(mbox1.TryReceive(msg));
+    ASSERT_NE(nullptr, msg.as<std::unique_ptr<int>>());
+    EXPECT_EQ(42, **msg.as<std::unique_ptr<int>>());
+    mbox1.ReleaseMessage(msg);
+    // ... but not to several, where nothing is delivered
+    auto moveOnly = std::make_unique<int>(1);
+    EXPECT_FALSE(sender.SendMessage(Obj1, std::move(moveOnly)));
+    EXPECT_FALSE(mbox1.TryReceive(msg));
+    EXPECT_FALSE(mbox2.TryReceive(msg));
+
+    // Messages still queued, or set aside, are released when the mailbox is destroyed
+    {
+        Mailbox pending;
+        pending.RegisterForLabel(Obj2);
+        EXPECT_TRUE(sender.SendMessage(Obj2, Tracked("deferred")));
+        EXPECT_TRUE(sender.SendMessage(Obj2, Tracked("queued")));
+        EXPECT_FALSE(pending.ReceiveIf({Obj1}, msg, 1ms));
+        EXPECT_TRUE(sender.SendMessage(Obj2, Tracked("queued")));
+        pending.UnregisterForLabel(Obj2);
+        while (mbox1.TryReceive(msg)) {
+            mbox1.ReleaseMessage(msg);
+        }
+        EXPECT_EQ(3, Tracked::s_live);
+    }
+    EXPECT_EQ(0, Tracked::s_live);
+
+    mbox1.UnregisterForLabel(Obj1);
+    mbox2.UnregisterForLabel(Obj1);
+    mbox1.UnregisterForLabel(Obj2);
+}
+
+TEST_F(MailboxTest, InlineStorageCapacity) {
+    Label Msg1 = 1562;  // NOLINT
+
+    BasicMailbox<LockFreeQueue, SpinWait, InlineStorage<4>> mbox;
+    Mailbox sender;
+    EXPECT_EQ(4, mbox.QUEUE_SIZE);
+    mbox.RegisterForLabel(Msg1);
+
+    TestMessage m {1, 2, 3};
+    for (size_t i = 0; i < mbox.QUEUE_SIZE; i++) {
+        EXPECT_TRUE(sender.SendMessage(Msg1, m));
+    }
+    EXPECT_FALSE(sender.SendMessage(Msg1, m));
+
+    Message msg;
+    while (mbox.TryReceive(msg)) {
+        mbox.ReleaseMessage(msg);
+    }
+    mbox.UnregisterForLabel(Msg1);
+}
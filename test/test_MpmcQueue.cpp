@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "msglib/detail/MpmcQueue.h"
+#include "TestResource.h"
+#include <array>
+#include <atomic>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+using msglib::detail::MpmcQueue;
+
+struct TestStruct {
+    TestStruct() = default;
+
+    TestStruct(int a, int b, int c) : m_a(a), m_b(b), m_c(c) {
+    }
+
+    int m_a = 0;
+    int m_b = 0;
+    int m_c = 0;
+};
+
+class MpmcQueueTest : public ::testing::Test {
+protected:
+    MpmcQueueTest()
+        : m_defaultResource(std::pmr::get_default_resource())
+        , m_storage(std::make_unique<std::byte[]>(16384))           // NOLINT
+        , m_bufferResource(m_storage.get(), 16384, &m_oomResource)  // NOLINT
+    {
+    }
+
+    ~MpmcQueueTest() noexcept override = default;
+
+    void SetUp() override {
+        // Install the rogue resource as the default to track any stray
+        // allocations
+        std::pmr::set_default_resource(&m_rogueResource);
+    }
+
+    void TearDown() override {
+        // Restore the default resource
+        std::pmr::set_default_resource(m_defaultResource);
+    }
+
+    std::pmr::memory_resource *m_defaultResource;
+
+    TestResource m_rogueResource;
+    TestResource m_oomResource;
+    std::unique_ptr<std::byte[]> m_storage;
+    std::pmr::monotonic_buffer_resource m_bufferResource;
+};
+
+TEST_F(MpmcQueueTest, pushPopTests) {
+    MpmcQueue<TestStruct> queue(3, &m_bufferResource);
+
+    EXPECT_EQ(3, queue.capacity());
+    EXPECT_EQ(0, queue.size());
+    EXPECT_TRUE(queue.empty());
+
+    TestStruct msg;
+    EXPECT_FALSE(queue.tryPop(msg));
+
+    EXPECT_TRUE(queue.tryPush(TestStruct(1, 2, 3)));
+    EXPECT_TRUE(queue.tryPush(TestStruct(4, 5, 6)));  // NOLINT
+    EXPECT_TRUE(queue.tryPush(TestStruct(7, 8, 9)));  // NOLINT
+    EXPECT_EQ(3, queue.size());
+    EXPECT_FALSE(queue.tryPush(TestStruct(10, 11, 12)));  // NOLINT
+
+    EXPECT_TRUE(queue.tryPop(msg));
+    EXPECT_EQ(1, msg.m_a);
+    EXPECT_EQ(2, msg.m_b);
+    EXPECT_EQ(3, msg.m_c);
+
+    // Capacity which isn't a power of 2 wraps correctly
+    EXPECT_TRUE(queue.tryPush(TestStruct(10, 11, 12)));  // NOLINT
+    EXPECT_TRUE(queue.tryPop(msg));
+    EXPECT_EQ(4, msg.m_a);
+    EXPECT_TRUE(queue.tryPop(msg));
+    EXPECT_EQ(7, msg.m_a);
+    EXPECT_TRUE(queue.tryPop(msg));
+    EXPECT_EQ(10, msg.m_a);
+    EXPECT_TRUE(queue.empty());
+
+    EXPECT_FALSE(m_rogueResource.allocatorInvoked());
+    EXPECT_FALSE(m_oomResource.allocatorInvoked());
+}
+
+TEST_F(MpmcQueueTest, minimumCapacity) {
+    // A single slot can't tell full from empty, so a capacity of 1 holds 2
+    MpmcQueue<int> queue(1, &m_bufferResource);
+    EXPECT_EQ(2, queue.capacity());
+    for (int lap = 0; lap < 3; lap++) {
+        EXPECT_TRUE(queue.tryPush(lap));
+        EXPECT_TRUE(queue.tryPush(lap + 1));
+        EXPECT_FALSE(queue.tryPush(lap + 2));
+        int value = -1;
+        EXPECT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(lap, value);
+        EXPECT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(lap + 1, value);
+        EXPECT_FALSE(queue.tryPop(value));
+    }
+}
+
+TEST_F(MpmcQueueTest, multiProducerMultiConsumer) {
+    constexpr int PRODUCERS = 3;
+    constexpr int CONSUMERS = 2;
+    constexpr int COUNT = 20000;
+    MpmcQueue<int> queue(64, &m_bufferResource);  // NOLINT
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; p++) {
+        threads.emplace_back([&queue]() {
+            for (int i = 1; i <= COUNT; i++) {
+                while (!queue.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::atomic<int64_t> sum {0};
+    std::atomic<int> received {0};
+    for (int c = 0; c < CONSUMERS; c++) {
+        threads.emplace_back([&queue, &sum, &received]() {
+            while (received.load() < PRODUCERS * COUNT) {
+                int value = 0;
+                if (queue.tryPop(value)) {
+                    sum += value;
+                    received++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(PRODUCERS * COUNT, received.load());
+    EXPECT_EQ(static_cast<int64_t>(PRODUCERS) * COUNT * (COUNT + 1) / 2, sum.load());
+    EXPECT_TRUE(queue.empty());
+}
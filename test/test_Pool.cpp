@@ -4,6 +4,7 @@
 #include <array>
 #include <memory_resource>
 #include <thread>
+#include <vector>
 
 struct TestStruct {
     TestStruct() = default;
@@ -119,6 +120,100 @@ TEST_F(BytePoolTest, DataBlockPut)
 }
 
 
+TEST_F(BytePoolTest, FreedBlocksAvailableToAnyThread)
+{
+    msglib::detail::BytePool pool(sizeof(TestStruct), 4, &m_syncResource);
+    std::array<std::byte *, 4> blocks {};
+    for (auto &block : blocks) {
+        block = pool.alloc().get();
+        ASSERT_NE(nullptr, block);
+    }
+    EXPECT_EQ(nullptr, pool.alloc().get());
+    for (auto *block : blocks) {
+        pool.free(block);
+    }
+
+    std::thread other([&pool]() {
+        std::array<std::byte *, 4> blocks {};
+        for (auto &block : blocks) {
+            block = pool.alloc().get();
+            EXPECT_NE(nullptr, block);
+        }
+        for (auto *block : blocks) {
+            pool.free(block);
+        }
+    });
+    other.join();
+    EXPECT_EQ(4, pool.size());
+}
+
+TEST_F(BytePoolTest, Growth)
+{
+    msglib::detail::BytePool pool(64, 4, &m_syncResource);
+    const size_t stride = msglib::detail::BytePool::Stride(64);
+    msglib::PoolGrowth growth;
+    growth.m_budget = 8 * stride;
+    growth.m_slabSize = 4 * stride;
+    growth.m_lowWaterPercent = 50;
+    growth.m_cooldown = std::chrono::seconds(1);
+    int wakes = 0;
+    pool.enableGrowth(growth, msglib::detail::ArenaConfig {}, [&wakes]() { wakes++; });
+
+    std::vector<std::byte *> blocks;
+    for (int i = 0; i < 3; i++) {
+        blocks.push_back(pool.alloc().get());
+    }
+    EXPECT_EQ(1, wakes);
+    EXPECT_TRUE(pool.needsGrowth());
+    EXPECT_TRUE(pool.grow());
+    EXPECT_EQ(8, pool.capacity());
+    EXPECT_EQ(5, pool.size());
+
+    // Once exhausted, the allocating thread adds the last slab the budget allows
+    while (blocks.size() < 12) {
+        auto *block = pool.alloc().get();
+        ASSERT_NE(nullptr, block);
+        blocks.push_back(block);
+    }
+    EXPECT_EQ(12, pool.capacity());
+    EXPECT_EQ(8 * stride, pool.grown());
+    EXPECT_EQ(nullptr, pool.alloc().get());
+    EXPECT_FALSE(pool.grow());
+
+    // Slabs are returned once they have been idle for the cooldown
+    for (auto *block : blocks) {
+        pool.free(block);
+    }
+    EXPECT_EQ(0, pool.shrink());
+    EXPECT_EQ(2, pool.shrink(std::chrono::steady_clock::now() + growth.m_cooldown));
+    EXPECT_EQ(4, pool.capacity());
+    EXPECT_EQ(4, pool.size());
+    EXPECT_EQ(0, pool.grown());
+}
+
+TEST_F(BytePoolTest, BackgroundGrowth)
+{
+    msglib::detail::BytePool pool(64, 4, &m_syncResource);
+    msglib::PoolGrowth growth;
+    growth.m_budget = 1024 * 1024;
+    growth.m_slabSize = 4 * msglib::detail::BytePool::Stride(64);
+    growth.m_lowWaterPercent = 50;
+    msglib::detail::PoolGrower grower({&pool}, growth.m_cooldown);
+    pool.enableGrowth(growth, msglib::detail::ArenaConfig {}, [&grower]() { grower.wake(); });
+
+    std::vector<std::byte *> blocks;
+    for (int i = 0; i < 3; i++) {
+        blocks.push_back(pool.alloc().get());
+    }
+    for (int i = 0; i < 1000 && pool.capacity() == 4; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(8, pool.capacity());
+    for (auto *block : blocks) {
+        pool.free(block);
+    }
+}
+
 #if 0
 TEST(BytePoolTest, allocFree) {
     msglib::BytePool<TestStruct> BytePool(3);
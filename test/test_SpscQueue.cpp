@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "msglib/detail/SpscQueue.h"
+#include <thread>
+
+using msglib::detail::SpscQueue;
+using namespace std::chrono_literals;
+
+struct TestStruct {
+    TestStruct() = default;
+
+    TestStruct(int a, int b, int c) : m_a(a), m_b(b), m_c(c) {
+    }
+
+    int m_a = 0;
+    int m_b = 0;
+    int m_c = 0;
+};
+
+TEST(SpscQueueTest, pushPopTests) {
+    SpscQueue<TestStruct, 2> queue;
+
+    EXPECT_EQ(2, queue.capacity());
+    EXPECT_EQ(0, queue.size());
+    EXPECT_TRUE(queue.empty());
+
+    TestStruct msg;
+    EXPECT_FALSE(queue.tryPop(msg));
+
+    EXPECT_TRUE(queue.tryPush(TestStruct(1, 2, 3)));
+    EXPECT_EQ(1, queue.size());
+    EXPECT_FALSE(queue.empty());
+
+    EXPECT_TRUE(queue.tryPush(TestStruct(4, 5, 6)));  // NOLINT
+    EXPECT_EQ(2, queue.size());
+
+    EXPECT_FALSE(queue.tryPush(TestStruct(7, 8, 9)));  // NOLINT
+
+    EXPECT_TRUE(queue.tryPop(msg));
+    EXPECT_EQ(1, msg.m_a);
+    EXPECT_EQ(2, msg.m_b);
+    EXPECT_EQ(3, msg.m_c);
+
+    // Space freed by the pop is reused
+    EXPECT_TRUE(queue.tryPush(TestStruct(7, 8, 9)));  // NOLINT
+
+    queue.pop(msg);
+    EXPECT_EQ(4, msg.m_a);
+    queue.pop(msg);
+    EXPECT_EQ(7, msg.m_a);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, popWaitTests) {
+    SpscQueue<TestStruct, 4> queue;
+    TestStruct msg;
+    EXPECT_FALSE(queue.popWait(msg, 100ms));
+
+    queue.tryPush(TestStruct(1, 2, 3));
+    EXPECT_TRUE(queue.popWait(msg, 100ms));
+    EXPECT_EQ(1, msg.m_a);
+}
+
+TEST(SpscQueueTest, producerConsumer) {
+    constexpr int COUNT = 100000;
+    SpscQueue<int, 64> queue;  // NOLINT
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < COUNT; i++) {
+            while (!queue.tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    bool ordered = true;
+    for (int i = 0; i < COUNT; i++) {
+        int value = -1;
+        queue.pop(value);
+        ordered &= (value == i);
+    }
+    producer.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(queue.empty());
+}
@@ -0,0 +1,196 @@
+#include "gtest/gtest.h"
+
+#include "msglib/ThreadPolicy.h"
+#include "msglib/TimerManager.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <sched.h>
+#include <thread>
+
+using msglib::ApplyThreadPolicy;
+using msglib::SchedPolicy;
+using msglib::ThreadPolicy;
+using msglib::ThreadStatus;
+
+namespace {
+
+/**
+ * @brief Return the first CPU the calling thread may run on
+ */
+int FirstAllowedCpu() {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpus)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief A thread which waits until told to finish, to have policies applied to it
+ */
+class IdleThread {
+public:
+    IdleThread() : m_thread([this]() {
+        while (!m_done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }) {
+    }
+
+    IdleThread(const IdleThread &) = delete;
+    IdleThread(IdleThread &&) = delete;
+    IdleThread &operator=(const IdleThread &) = delete;
+    IdleThread &operator=(IdleThread &&) = delete;
+
+    ~IdleThread() {
+        m_done = true;
+        m_thread.join();
+    }
+
+    std::thread &get() {
+        return m_thread;
+    }
+
+private:
+    std::atomic<bool> m_done {false};
+    std::thread m_thread;
+};
+
+}  // namespace
+
+TEST(ThreadPolicyTest, NothingRequested) {
+    const ThreadPolicy policy;
+    EXPECT_FALSE(policy.requested());
+    IdleThread thread;
+    const ThreadStatus status = ApplyThreadPolicy(policy, thread.get());
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(0, status.m_error);
+}
+
+TEST(ThreadPolicyTest, Affinity) {
+    const int cpu = FirstAllowedCpu();
+    ASSERT_GE(cpu, 0);
+    ThreadPolicy policy;
+    policy.m_cpus = {cpu};
+    EXPECT_TRUE(policy.requested());
+
+    IdleThread thread;
+    const ThreadStatus status = ApplyThreadPolicy(policy, thread.get());
+    EXPECT_TRUE(status.ok());
+
+    cpu_set_t actual;
+    CPU_ZERO(&actual);
+    ASSERT_EQ(0, pthread_getaffinity_np(thread.get().native_handle(), sizeof(actual), &actual));
+    EXPECT_EQ(1, CPU_COUNT(&actual));
+    EXPECT_TRUE(CPU_ISSET(cpu, &actual));
+}
+
+TEST(ThreadPolicyTest, InvalidRequestsReported) {
+    IdleThread thread;
+
+    // No CPU in range
+    ThreadPolicy cpus;
+    cpus.m_cpus = {-1};
+    ThreadStatus status = ApplyThreadPolicy(cpus, thread.get());
+    EXPECT_TRUE(status.m_scheduling);
+    EXPECT_FALSE(status.m_affinity);
+    EXPECT_EQ(EINVAL, status.m_error);
+
+    // Priority out of range
+    ThreadPolicy priority;
+    priority.m_policy = SchedPolicy::FIFO;
+    priority.m_priority = sched_get_priority_max(SCHED_FIFO) + 1;
+    status = ApplyThreadPolicy(priority, thread.get());
+    EXPECT_FALSE(status.m_scheduling);
+    EXPECT_TRUE(status.m_affinity);
+    EXPECT_NE(0, status.m_error);
+
+    int actual = SCHED_FIFO;
+    sched_param param {};
+    ASSERT_EQ(0, pthread_getschedparam(thread.get().native_handle(), &actual, &param));
+    EXPECT_EQ(SCHED_OTHER, actual);
+}
+
+TEST(ThreadPolicyTest, FailureLeavesThreadAsItWas) {
+    IdleThread thread;
+    const pthread_t handle = thread.get().native_handle();
+    cpu_set_t before;
+    CPU_ZERO(&before);
+    ASSERT_EQ(0, pthread_getaffinity_np(handle, sizeof(before), &before));
+
+    // A real-time policy (if permitted) is restored when the affinity then fails
+    ThreadPolicy badCpus;
+    badCpus.m_policy = SchedPolicy::RR;
+    badCpus.m_priority = sched_get_priority_min(SCHED_RR);
+    badCpus.m_cpus = {-1};
+    ThreadStatus status = ApplyThreadPolicy(badCpus, thread.get());
+    EXPECT_FALSE(status.m_scheduling);
+    EXPECT_FALSE(status.m_affinity);
+    EXPECT_NE(0, status.m_error);
+    int actual = SCHED_FIFO;
+    sched_param param {};
+    ASSERT_EQ(0, pthread_getschedparam(handle, &actual, &param));
+    EXPECT_EQ(SCHED_OTHER, actual);
+
+    // The affinity isn't applied when the scheduling policy fails
+    const int cpu = FirstAllowedCpu();
+    ASSERT_GE(cpu, 0);
+    ThreadPolicy badPriority;
+    badPriority.m_policy = SchedPolicy::FIFO;
+    badPriority.m_priority = sched_get_priority_max(SCHED_FIFO) + 1;
+    badPriority.m_cpus = {cpu};
+    status = ApplyThreadPolicy(badPriority, thread.get());
+    EXPECT_FALSE(status.m_scheduling);
+    EXPECT_FALSE(status.m_affinity);
+    EXPECT_NE(0, status.m_error);
+    cpu_set_t after;
+    CPU_ZERO(&after);
+    ASSERT_EQ(0, pthread_getaffinity_np(handle, sizeof(after), &after));
+    EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+
+TEST(ThreadPolicyTest, RealTimeReportsOutcome) {
+    ThreadPolicy policy;
+    policy.m_policy = SchedPolicy::RR;
+    policy.m_priority = sched_get_priority_min(SCHED_RR);
+
+    IdleThread thread;
+    const ThreadStatus status = ApplyThreadPolicy(policy, thread.get());
+
+    // Whether it is permitted depends on the privileges the tests run with, but the status must
+    // match the thread's actual policy
+    int actual = SCHED_OTHER;
+    sched_param param {};
+    ASSERT_EQ(0, pthread_getschedparam(thread.get().native_handle(), &actual, &param));
+    EXPECT_EQ(status.m_scheduling, actual == SCHED_RR);
+    EXPECT_EQ(status.m_scheduling, status.m_error == 0);
+}
+
+TEST(ThreadPolicyTest, TimerThread) {
+    const int cpu = FirstAllowedCpu();
+    ASSERT_GE(cpu, 0);
+    msglib::Options options;
+    options.m_maxLabels = 16;  // NOLINT
+    options.m_maxTimers = 2;
+    options.m_timerThread.m_cpus = {cpu};
+    msglib::detail::TimerManagerData data;
+
+    // A requested policy starts the timer thread at initialization and reports its outcome
+    EXPECT_TRUE(data.Initialize(options));
+    EXPECT_TRUE(data.threadStarted());
+    auto status = data.threadStatus();
+    ASSERT_TRUE(status.has_value());
+    EXPECT_TRUE(status->ok());
+
+    msglib::detail::TimerManagerData lazy;
+    options.m_timerThread = ThreadPolicy();
+    EXPECT_TRUE(lazy.Initialize(options));
+    EXPECT_FALSE(lazy.threadStatus().has_value());
+}
@@ -3,6 +3,7 @@
 #include "msglib/TimerManager.h"
 #include <chrono>
 #include <thread>
+#include <utility>
 
 using namespace std::chrono_literals;
 using msglib::Message;
@@ -109,23 +110,62 @@ TEST_F(TimeManagerTest, OneShotChrono) {
     EXPECT_TRUE(tester.received);
 }
 
-#if 0
 TEST_F(TimeManagerTest, OneShotTimePoint) {
     EventTester tester;
 
-    auto now = std::chrono::system_clock::now();
-    auto time = now + 1s;
+    auto time = std::chrono::system_clock::now() + 500ms;
 
     std::thread evt(EventTestThread, std::ref(tester));
 
-    TimerManager::StartTimer(OneShotEvent, time, msglib::ONE_SHOT);
+    EXPECT_TRUE(TimerManager::StartTimer(OneShotEvent, time));
 
-    std::this_thread::sleep_for(2s);
+    std::this_thread::sleep_for(1s);
 
     evt.join();
     EXPECT_TRUE(tester.received);
 }
-#endif
+
+TEST_F(TimeManagerTest, OneShotSteadyDeadline) {
+    Mailbox mbox;
+    ASSERT_TRUE(mbox.RegisterForLabel(OneShotEvent));
+
+    // The deadline is absolute: it isn't pushed back by the time taken to start the timer
+    const auto deadline = std::chrono::steady_clock::now() + 200ms;
+    ASSERT_TRUE(TimerManager::StartTimer(OneShotEvent, deadline));
+
+    Message msg;
+    ASSERT_TRUE(mbox.Receive(msg, 2s));
+    EXPECT_EQ(OneShotEvent, msg.m_label);
+    EXPECT_GE(std::chrono::steady_clock::now(), deadline);
+    EXPECT_LT(std::chrono::steady_clock::now(), deadline + 500ms);
+
+    // A deadline already passed fires straight away rather than at epoch + (deadline - epoch)
+    ASSERT_TRUE(TimerManager::StartTimer(OneShotEvent, std::chrono::steady_clock::now() - 1s));
+    ASSERT_TRUE(mbox.Receive(msg, 500ms));
+    EXPECT_EQ(OneShotEvent, msg.m_label);
+    mbox.UnregisterForLabel(OneShotEvent);
+}
+
+TEST_F(TimeManagerTest, RecurringAnchored) {
+    Mailbox mbox;
+    ASSERT_TRUE(mbox.RegisterForLabel(PeriodicEvent));
+
+    constexpr int FIRINGS = 5;
+    const auto first = std::chrono::steady_clock::now() + 100ms;
+    ASSERT_TRUE(TimerManager::StartTimer(PeriodicEvent, first, 50ms));
+
+    Message msg;
+    for (int i = 0; i < FIRINGS; i++) {
+        ASSERT_TRUE(mbox.Receive(msg, 2s));
+        EXPECT_EQ(PeriodicEvent, msg.m_label);
+        // Each expiry is on the phase set by the first, however late the previous one was handled
+        EXPECT_GE(std::chrono::steady_clock::now(), first + (i * 50ms));
+        std::this_thread::sleep_for(10ms);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now(), first + ((FIRINGS - 1) * 50ms) + 500ms);
+    EXPECT_TRUE(TimerManager::CancelTimer(PeriodicEvent));
+    mbox.UnregisterForLabel(PeriodicEvent);
+}
 
 TEST_F(TimeManagerTest, RecurringPOSIX) {
     const time_t PERIOD = 500L;
@@ -145,3 +185,241 @@ TEST_F(TimeManagerTest, RecurringPOSIX) {
     evt.join();
     EXPECT_EQ(3, tester.count);
 }
+
+struct SessionTimeout {
+    uint64_t session;
+    uint32_t attempt;
+};
+
+TEST_F(TimeManagerTest, OneShotPayload) {
+    Mailbox mbox;
+    Mailbox other;
+    ASSERT_TRUE(mbox.RegisterForLabel(OneShotEvent));
+    ASSERT_TRUE(other.RegisterForLabel(OneShotEvent));
+
+    ASSERT_TRUE(TimerManager::StartTimer(OneShotEvent, 100ms, SessionTimeout {42, 3}));
+
+    Message msg;
+    ASSERT_TRUE(mbox.Receive(msg, 2s));
+    Message otherMsg;
+    ASSERT_TRUE(other.Receive(otherMsg, 2s));
+    // Both receivers share the payload's one block
+    EXPECT_EQ(msg.m_data, otherMsg.m_data);
+    other.ReleaseMessage(otherMsg);
+    other.UnregisterForLabel(OneShotEvent);
+    EXPECT_EQ(OneShotEvent, msg.m_label);
+    EXPECT_TRUE(msg.shared());
+    const auto *timeout = std::as_const(msg).as<SessionTimeout>();
+    ASSERT_NE(nullptr, timeout);
+    EXPECT_EQ(42U, timeout->session);
+    EXPECT_EQ(3U, timeout->attempt);
+    mbox.ReleaseMessage(msg);
+
+    // A one-shot timer is finished with once it fires
+    EXPECT_FALSE(TimerManager::CancelTimer(OneShotEvent));
+    mbox.UnregisterForLabel(OneShotEvent);
+}
+
+TEST_F(TimeManagerTest, RecurringPayload) {
+    Mailbox mbox;
+    Mailbox other;
+    ASSERT_TRUE(mbox.RegisterForLabel(PeriodicEvent));
+    ASSERT_TRUE(other.RegisterForLabel(PeriodicEvent));
+
+    ASSERT_TRUE(TimerManager::StartTimer(PeriodicEvent, 50ms, SessionTimeout {7, 0}, msglib::PERIODIC));
+
+    // Both receivers of a tick, and every later tick, get the same block, which stays valid while
+    // messages hold it even after the timer is cancelled
+    Message first;
+    ASSERT_TRUE(mbox.Receive(first, 2s));
+    Message otherFirst;
+    ASSERT_TRUE(other.Receive(otherFirst, 2s));
+    EXPECT_EQ(first.m_data, otherFirst.m_data);
+    Message second;
+    ASSERT_TRUE(mbox.Receive(second, 2s));
+    EXPECT_EQ(first.m_data, second.m_data);
+    EXPECT_TRUE(TimerManager::CancelTimer(PeriodicEvent));
+
+    // The shared payload is only handed out read-only, so one receiver can't change it under the
+    // others
+    EXPECT_EQ(nullptr, otherFirst.as<SessionTimeout>());
+    const auto *timeout = std::as_const(otherFirst).as<SessionTimeout>();
+    ASSERT_NE(nullptr, timeout);
+    EXPECT_EQ(7U, timeout->session);
+    other.ReleaseMessage(otherFirst);
+    mbox.ReleaseMessage(first);
+    ASSERT_NE(nullptr, std::as_const(second).as<SessionTimeout>());
+    EXPECT_EQ(7U, std::as_const(second).as<SessionTimeout>()->session);
+    mbox.ReleaseMessage(second);
+
+    // Drain any tick sent before the timer was cancelled
+    Message msg;
+    for (auto *receiver : {&mbox, &other}) {
+        while (receiver->Receive(msg, 100ms)) {
+            receiver->ReleaseMessage(msg);
+        }
+    }
+    other.UnregisterForLabel(PeriodicEvent);
+    mbox.UnregisterForLabel(PeriodicEvent);
+}
+
+TEST(TimerManagerDataTest, LazyLimits) {
+    msglib::Options options;
+    options.m_maxLabels = 16;  // NOLINT
+    options.m_maxTimers = 2;
+    msglib::detail::TimerManagerData data;
+    EXPECT_TRUE(data.Initialize(options));
+
+    // The signal thread isn't started until a timer is
+    EXPECT_FALSE(data.threadStarted());
+    const timespec ts {10, 0};  // NOLINT
+    EXPECT_FALSE(data.startTimer(16, ts, msglib::ONE_SHOT));
+    EXPECT_FALSE(data.threadStarted());
+
+    EXPECT_TRUE(data.startTimer(1, ts, msglib::ONE_SHOT));
+    EXPECT_TRUE(data.threadStarted());
+    EXPECT_FALSE(data.startTimer(1, ts, msglib::ONE_SHOT));
+    EXPECT_TRUE(data.startTimer(2, ts, msglib::ONE_SHOT));
+
+    // At most m_maxTimers can be outstanding; cancelled timers' storage is reused
+    EXPECT_FALSE(data.startTimer(3, ts, msglib::ONE_SHOT));
+    EXPECT_TRUE(data.cancelTimer(1));
+    EXPECT_TRUE(data.startTimer(3, ts, msglib::ONE_SHOT));
+
+    EXPECT_FALSE(data.cancelTimer(1));
+    EXPECT_TRUE(data.cancelTimer(2));
+    EXPECT_TRUE(data.cancelTimer(3));
+}
+
+namespace {
+
+constexpr Label VirtualFirst = 10;
+constexpr Label VirtualSecond = 11;
+constexpr Label VirtualPeriodic = 12;
+
+msglib::Options VirtualOptions() {
+    msglib::Options options;
+    options.m_maxLabels = 16;  // NOLINT
+    options.m_maxTimers = 4;
+    options.m_timerClock = msglib::TimerClock::VIRTUAL;
+    return options;
+}
+
+}  // namespace
+
+TEST(TimerManagerDataTest, VirtualDeadlineOrder) {
+    Mailbox mbox;
+    mbox.Initialize();
+    ASSERT_TRUE(mbox.RegisterForLabelRange(VirtualFirst, VirtualPeriodic));
+
+    msglib::detail::TimerManagerData data;
+    ASSERT_TRUE(data.Initialize(VirtualOptions()));
+    ASSERT_TRUE(data.startTimer(VirtualFirst, timespec {3, 0}, msglib::ONE_SHOT));
+    ASSERT_TRUE(data.startTimer(VirtualSecond, timespec {1, 0}, msglib::ONE_SHOT));
+    ASSERT_TRUE(data.startTimer(VirtualPeriodic, timespec {1, 0}, msglib::PERIODIC));
+
+    // Nothing fires, and no thread is needed, until virtual time is advanced
+    EXPECT_FALSE(data.threadStarted());
+    Message msg;
+    EXPECT_FALSE(mbox.TryReceive(msg));
+
+    // Due timers fire within the call, in deadline order (ties in the order they were scheduled)
+    EXPECT_EQ(3U, data.advanceTo(2500ms));
+    EXPECT_EQ(2500ms, data.now());
+    for (Label expected : {VirtualSecond, VirtualPeriodic, VirtualPeriodic}) {
+        ASSERT_TRUE(mbox.TryReceive(msg));
+        EXPECT_EQ(expected, msg.m_label);
+    }
+    EXPECT_FALSE(mbox.TryReceive(msg));
+
+    // Virtual time doesn't go backwards
+    EXPECT_EQ(0U, data.advanceTo(1s));
+    EXPECT_EQ(2500ms, data.now());
+
+    // Runs to the last one-shot timer; the periodic timer due at the same time was rescheduled
+    // after it, so doesn't fire
+    EXPECT_EQ(1U, data.runUntilIdle());
+    EXPECT_EQ(3s, data.now());
+    ASSERT_TRUE(mbox.TryReceive(msg));
+    EXPECT_EQ(VirtualFirst, msg.m_label);
+    EXPECT_FALSE(mbox.TryReceive(msg));
+    EXPECT_EQ(0U, data.runUntilIdle());
+
+    EXPECT_TRUE(data.cancelTimer(VirtualPeriodic));
+    EXPECT_EQ(0U, data.advanceTo(10s));
+    EXPECT_FALSE(mbox.TryReceive(msg));
+    mbox.UnregisterForLabelRange(VirtualFirst, VirtualPeriodic);
+}
+
+TEST(TimerManagerDataTest, VirtualDeliveryLimits) {
+    Mailbox mbox(4);
+    mbox.Initialize();
+    ASSERT_TRUE(mbox.RegisterForLabel(VirtualPeriodic));
+
+    msglib::detail::TimerManagerData data;
+    ASSERT_TRUE(data.Initialize(VirtualOptions()));
+    ASSERT_TRUE(data.startTimer(VirtualPeriodic, timespec {1, 0}, msglib::PERIODIC));
+
+    // Expiries which find the receiver's queue full are dropped and counted as such
+    EXPECT_EQ(4U, data.advanceTo(6s));
+    EXPECT_EQ(2U, data.dropped());
+    EXPECT_EQ(6s, data.now());
+
+    // In steps, with the queue drained between them, nothing is dropped
+    auto drain = [&mbox]() {
+        size_t received = 0;
+        Message msg;
+        while (mbox.TryReceive(msg)) {
+            mbox.ReleaseMessage(msg);
+            received++;
+        }
+        return received;
+    };
+    EXPECT_EQ(4U, drain());
+    size_t received = 0;
+    while (data.now() < 16s) {
+        EXPECT_LE(data.advanceTo(16s, 3), 3U);
+        received += drain();
+    }
+    EXPECT_EQ(10U, received);
+    EXPECT_EQ(2U, data.dropped());
+
+    // Restarting a timer which never expires doesn't grow the queued expiries without bound
+    for (int i = 0; i < 1000; i++) {  // NOLINT
+        ASSERT_TRUE(data.startTimer(VirtualFirst, timespec {3600, 0}, msglib::ONE_SHOT));  // NOLINT
+        ASSERT_TRUE(data.cancelTimer(VirtualFirst));
+    }
+    EXPECT_LE(data.queuedVirtual(), 2U);
+    EXPECT_TRUE(data.cancelTimer(VirtualPeriodic));
+    EXPECT_EQ(0U, data.queuedVirtual());
+    mbox.UnregisterForLabel(VirtualPeriodic);
+}
+
+TEST(TimerManagerDataTest, VirtualHours) {
+    msglib::detail::TimerManagerData data;
+    ASSERT_TRUE(data.Initialize(VirtualOptions()));
+
+    // An hour of a 10ms periodic timer, and an absolute deadline on the virtual clock, without
+    // waiting for any of it
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(data.startTimer(VirtualPeriodic, timespec {0, 10000000}, msglib::PERIODIC));  // NOLINT
+    const itimerspec deadline {timespec {0, 0}, timespec {1800, 0}};                           // NOLINT
+    ASSERT_TRUE(data.startTimer(VirtualFirst, msglib::detail::VIRTUAL_CLOCK_ID, TIMER_ABSTIME, deadline, msglib::ONE_SHOT));
+    EXPECT_EQ(360001U, data.advanceTo(1h));
+    EXPECT_EQ(1h, data.now());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 30s);
+    EXPECT_FALSE(data.cancelTimer(VirtualFirst));
+    EXPECT_TRUE(data.cancelTimer(VirtualPeriodic));
+
+    // Real clock deadlines and zero periods aren't supported on the virtual clock
+    EXPECT_FALSE(data.startTimer(VirtualFirst, CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, msglib::ONE_SHOT));
+    EXPECT_FALSE(data.startTimer(VirtualPeriodic, timespec {0, 0}, msglib::PERIODIC));
+
+    // ...nor virtual deadlines on the real one
+    msglib::Options options = VirtualOptions();
+    options.m_timerClock = msglib::TimerClock::REAL;
+    msglib::detail::TimerManagerData real;
+    ASSERT_TRUE(real.Initialize(options));
+    EXPECT_FALSE(real.startTimer(VirtualFirst, msglib::detail::VIRTUAL_CLOCK_ID, TIMER_ABSTIME, deadline, msglib::ONE_SHOT));
+    EXPECT_EQ(0U, real.advanceTo(1s));
+}
@@ -0,0 +1,114 @@
+#include "msglib/Mailbox.h"
+#include "msglib/TraceJson.h"
+#include "msglib/Tracer.h"
+#include "gtest/gtest.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace msglib;  // NOLINT
+
+struct TraceMsg {
+    int a;
+    int b;
+};
+
+TEST(TracerTest, RecordWriteConvert) {
+    Label Msg1 = 1700;  // NOLINT
+    Label Sig1 = 1701;  // NOLINT
+
+    Mailbox mbox;
+    mbox.Initialize();
+    Mailbox sender;
+    EXPECT_TRUE(mbox.RegisterForLabel(Msg1));
+    EXPECT_TRUE(mbox.RegisterForLabel(Sig1));
+
+    const std::string path = ::testing::TempDir() + "msglib_trace.bin";
+    EXPECT_FALSE(Tracer::Enabled());
+    ASSERT_TRUE(Tracer::Enable(4, 1024));
+    EXPECT_FALSE(Tracer::Enable());
+    EXPECT_TRUE(Tracer::Enabled());
+
+    EXPECT_TRUE(sender.SendMessage(Msg1, TraceMsg {1, 2}));
+    Message msg;
+    EXPECT_TRUE(mbox.TryReceive(msg));
+    mbox.ReleaseMessage(msg);
+    EXPECT_TRUE(sender.SendSignal(Sig1));
+    EXPECT_TRUE(mbox.TryReceive(msg));
+
+    Tracer::Disable();
+    EXPECT_FALSE(Tracer::Enabled());
+    // Not recorded
+    EXPECT_TRUE(sender.SendSignal(Sig1));
+    EXPECT_TRUE(mbox.TryReceive(msg));
+    ASSERT_TRUE(Tracer::Write(path.c_str()));
+
+    // Read back this thread's records
+    std::ifstream in(path, std::ios::binary);
+    TraceFileHeader header {};
+    ASSERT_TRUE(in.read(reinterpret_cast<char *>(&header), sizeof(header)));
+    EXPECT_EQ(TraceFileHeader::VERSION, header.m_version);
+    ASSERT_EQ(1, header.m_threads);
+    EXPECT_GE(header.m_endTimestamp, header.m_startTimestamp);
+    TraceThreadHeader thread {};
+    ASSERT_TRUE(in.read(reinterpret_cast<char *>(&thread), sizeof(thread)));
+    EXPECT_EQ(0, thread.m_thread);
+    EXPECT_EQ(0, thread.m_overwritten);
+    std::vector<TraceRecord> records(thread.m_count);
+    ASSERT_TRUE(in.read(reinterpret_cast<char *>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TraceRecord))));
+
+    struct Expected {
+        TraceEvent m_event;
+        Label m_label;
+        uint32_t m_mailbox;
+    };
+    const std::vector<Expected> expected {{TraceEvent::SEND_BEGIN, Msg1, sender.TraceId()},
+        {TraceEvent::SEND_LOCKED, Msg1, sender.TraceId()}, {TraceEvent::ENQUEUE, Msg1, mbox.TraceId()},
+        {TraceEvent::SEND_END, Msg1, sender.TraceId()}, {TraceEvent::RECEIVE, Msg1, mbox.TraceId()},
+        {TraceEvent::RELEASE, Msg1, mbox.TraceId()}, {TraceEvent::SEND_BEGIN, Sig1, sender.TraceId()},
+        {TraceEvent::SEND_LOCKED, Sig1, sender.TraceId()}, {TraceEvent::ENQUEUE, Sig1, mbox.TraceId()},
+        {TraceEvent::SEND_END, Sig1, sender.TraceId()}, {TraceEvent::RECEIVE, Sig1, mbox.TraceId()}};
+    ASSERT_EQ(expected.size(), records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(expected[i].m_event, records[i].m_event);
+        EXPECT_EQ(expected[i].m_label, records[i].m_label);
+        EXPECT_EQ(expected[i].m_mailbox, records[i].m_mailbox);
+        if (i > 0) {
+            EXPECT_GE(records[i].m_timestamp, records[i - 1].m_timestamp);
+        }
+    }
+
+    // Convert to Chrome/Perfetto JSON
+    std::ifstream trace(path, std::ios::binary);
+    std::ostringstream json;
+    ASSERT_TRUE(TraceToJson(trace, json));
+    const std::string text = json.str();
+    EXPECT_EQ(0, text.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    for (const char *name : {"\"send 1700\"", "\"lock wait 1700\"", "\"enqueue 1700\"", "\"handle 1700\"", "\"receive 1701\"",
+             "\"ph\":\"s\"", "\"ph\":\"f\""}) {
+        EXPECT_NE(std::string::npos, text.find(name)) << name;
+    }
+    EXPECT_EQ(std::string::npos, text.find("\"handle 1701\""));
+
+    std::istringstream invalid("not a trace file");
+    std::ostringstream ignored;
+    EXPECT_FALSE(TraceToJson(invalid, ignored));
+
+    // Recording resumes into the same rings once re-enabled
+    EXPECT_TRUE(Tracer::Enable());
+    EXPECT_TRUE(Tracer::Enabled());
+    EXPECT_TRUE(sender.SendSignal(Sig1));
+    EXPECT_TRUE(mbox.TryReceive(msg));
+    Tracer::Disable();
+    ASSERT_TRUE(Tracer::Write(path.c_str()));
+    std::ifstream resumed(path, std::ios::binary);
+    ASSERT_TRUE(resumed.read(reinterpret_cast<char *>(&header), sizeof(header)));
+    ASSERT_EQ(1, header.m_threads);
+    ASSERT_TRUE(resumed.read(reinterpret_cast<char *>(&thread), sizeof(thread)));
+    EXPECT_EQ(expected.size() + 5, thread.m_count);
+
+    std::remove(path.c_str());
+    mbox.UnregisterForLabel(Msg1);
+    mbox.UnregisterForLabel(Sig1);
+}
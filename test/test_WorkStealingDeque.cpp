@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "msglib/detail/WorkStealingDeque.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using msglib::detail::WorkStealingDeque;
+
+TEST(WorkStealingDequeTest, pushPopSteal) {
+    WorkStealingDeque<int> deque(3);
+
+    // Capacity is rounded up to a power of 2
+    EXPECT_EQ(4, deque.capacity());
+    EXPECT_EQ(0, deque.size());
+
+    int value = 0;
+    EXPECT_FALSE(deque.pop(value));
+    EXPECT_FALSE(deque.steal(value));
+
+    for (int i = 1; i <= 4; i++) {
+        EXPECT_TRUE(deque.push(i));
+    }
+    EXPECT_FALSE(deque.push(5));  // NOLINT
+    EXPECT_EQ(4, deque.size());
+
+    // The owner pops the newest value, thieves steal the oldest
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(4, value);
+    EXPECT_TRUE(deque.steal(value));
+    EXPECT_EQ(1, value);
+
+    // Wraps around
+    EXPECT_TRUE(deque.push(5));  // NOLINT
+    EXPECT_TRUE(deque.push(6));  // NOLINT
+    EXPECT_TRUE(deque.steal(value));
+    EXPECT_EQ(2, value);
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(6, value);
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(5, value);
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(3, value);
+    EXPECT_FALSE(deque.pop(value));
+    EXPECT_EQ(0, deque.size());
+}
+
+TEST(WorkStealingDequeTest, ownerAndThieves) {
+    constexpr int THIEVES = 3;
+    constexpr int COUNT = 100000;
+    WorkStealingDeque<int> deque(64);  // NOLINT
+
+    std::atomic<int64_t> sum {0};
+    std::atomic<int> taken {0};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < THIEVES; t++) {
+        thieves.emplace_back([&deque, &sum, &taken]() {
+            while (taken.load() < COUNT) {
+                int value = 0;
+                if (deque.steal(value)) {
+                    sum += value;
+                    taken++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Each value is taken exactly once, by either the owner or a thief
+    for (int i = 1; i <= COUNT; i++) {
+        while (!deque.push(i)) {
+            int value = 0;
+            if (deque.pop(value)) {
+                sum += value;
+                taken++;
+            }
+        }
+    }
+    int value = 0;
+    while (deque.pop(value)) {
+        sum += value;
+        taken++;
+    }
+    for (auto &t : thieves) {
+        t.join();
+    }
+
+    EXPECT_EQ(COUNT, taken.load());
+    EXPECT_EQ(static_cast<int64_t>(COUNT) * (COUNT + 1) / 2, sum.load());
+}
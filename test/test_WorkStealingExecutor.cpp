@@ -0,0 +1,134 @@
+#include "msglib/WorkStealingExecutor.h"
+#include "msglib/Dispatcher.h"
+#include "gtest/gtest.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace msglib;  // NOLINT
+
+namespace {
+
+struct Count {
+    int value;
+};
+
+}  // namespace
+
+class WorkStealingExecutorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Mailbox::Initialize();
+    }
+};
+
+TEST_F(WorkStealingExecutorTest, ActorsInOrder) {
+    const Label base = 2600;  // NOLINT
+    constexpr int ACTORS = 50;
+    constexpr int COUNT = 200;
+
+    struct State {
+        std::atomic<int> m_running {0};
+        int m_next = 0;
+        bool m_ordered = true;
+        bool m_exclusive = true;
+    };
+    std::array<State, ACTORS> states;
+    std::atomic<int> handled {0};
+
+    WorkStealingExecutor executor(3);
+    std::vector<std::unique_ptr<ActorMailbox>> actors;
+    for (int i = 0; i < ACTORS; i++) {
+        auto &state = states[i];
+        actors.push_back(std::make_unique<ActorMailbox>(
+            executor,
+            [&state, &handled](ActorMailbox & /*mbox*/, Message &msg) {
+                // A handler never runs concurrently with itself, and sees its messages in order
+                state.m_exclusive &= (state.m_running.fetch_add(1) == 0);
+                auto *c = msg.as<Count>();
+                state.m_ordered &= (c != nullptr && c->value == state.m_next++);
+                state.m_running--;
+                handled++;
+            },
+            COUNT));
+        actors.back()->RegisterForLabel(static_cast<Label>(base + i));
+    }
+
+    // Skewed load: most messages go to a few actors
+    Mailbox sender;
+    for (int n = 0; n < COUNT; n++) {
+        for (int i = 0; i < ACTORS; i++) {
+            if (i < 5 || n < 10) {
+                while (!sender.SendMessage(static_cast<Label>(base + i), Count {n})) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+    const int expected = 5 * COUNT + (ACTORS - 5) * 10;
+    while (handled.load() < expected) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < ACTORS; i++) {
+        EXPECT_TRUE(states[i].m_ordered);
+        EXPECT_TRUE(states[i].m_exclusive);
+        EXPECT_EQ((i < 5) ? COUNT : 10, states[i].m_next);
+        actors[i]->UnregisterForLabel(static_cast<Label>(base + i));
+    }
+    actors.clear();
+}
+
+TEST_F(WorkStealingExecutorTest, Pipeline) {
+    const Label first = 2700;   // NOLINT
+    const Label second = 2701;  // NOLINT
+    constexpr int COUNT = 1000;
+    using SecondDispatcher = Dispatcher<Handler<second>>;
+
+    // A handler sending to another actor schedules it on the same worker, from which it may be stolen
+    std::atomic<int64_t> sum {0};
+    std::atomic<int> handled {0};
+    WorkStealingExecutor executor(2);
+    ActorMailbox stage1(executor, [&sum](ActorMailbox &mbox, Message &msg) {
+        sum += msg.as<Count>()->value;
+        mbox.SendSignal(second);
+    });
+    ActorMailbox stage2(executor, [&handled](ActorMailbox &mbox, Message &msg) {
+        SecondDispatcher::Dispatch(mbox, msg, [&handled](LabelConstant<second>) { handled++; });
+    });
+    EXPECT_TRUE(stage1.RegisterForLabel(first));
+    EXPECT_TRUE(stage2.RegisterForLabel(second));
+
+    // Keep only a few messages in flight so that no signals are dropped
+    Mailbox sender;
+    for (int i = 1; i <= COUNT; i++) {
+        while (i - handled.load() > 8 || !sender.SendMessage(first, Count {i})) {
+            std::this_thread::yield();
+        }
+    }
+    while (handled.load() < COUNT) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(static_cast<int64_t>(COUNT) * (COUNT + 1) / 2, sum.load());
+
+    stage1.UnregisterForLabel(first);
+    stage2.UnregisterForLabel(second);
+}
+
+TEST_F(WorkStealingExecutorTest, Capacity) {
+    WorkStealingExecutor executor(1, 1);
+    ActorMailbox actor(executor, [](ActorMailbox &, Message &) {});
+    EXPECT_THROW(ActorMailbox(executor, [](ActorMailbox &, Message &) {}), std::runtime_error);
+
+    // Messages still queued when the executor stops are released with the mailbox
+    executor.Stop();
+    EXPECT_TRUE(executor.Stopped());
+    const Label label = 2702;  // NOLINT
+    actor.RegisterForLabel(label);
+    Mailbox sender;
+    EXPECT_TRUE(sender.SendMessage(label, Count {1}));
+    EXPECT_EQ(1U, actor.Pending());
+    actor.UnregisterForLabel(label);
+}
@@ -0,0 +1,33 @@
+#include "msglib/TraceJson.h"
+#include <fstream>
+#include <iostream>
+
+/**
+ * @brief Convert a trace file written by msglib::Tracer::Write() to Chrome/Perfetto JSON, which
+ *        can be loaded in chrome://tracing or https://ui.perfetto.dev
+ */
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <trace file> [<json file>]\n";
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Unable to open " << argv[1] << "\n";
+        return 1;
+    }
+    std::ofstream file;
+    if (argc == 3) {
+        file.open(argv[2]);
+        if (!file) {
+            std::cerr << "Unable to create " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = (argc == 3) ? file : std::cout;
+    if (!msglib::TraceToJson(in, out)) {
+        std::cerr << argv[1] << " is not a valid trace file\n";
+        return 1;
+    }
+    return out ? 0 : 1;
+}